@@ -0,0 +1,371 @@
+// SPRITE BLITTERS
+// This file is part of Mighty Mike. https://github.com/jorio/mightymike
+//
+// Row kernels for the masked sprite draws in Shape.c.
+// The operations are pure bitwise AND/OR, so every variant below
+// produces byte-identical output regardless of the width it processes per step.
+
+#include <SDL.h>
+#include <string.h>
+#include <stdio.h>
+#include "blit.h"
+#include "simd.h"
+
+/****************************/
+/*    VARIABLES             */
+/****************************/
+
+BlitMaskedRowFunc			BlitMaskedRow			= NULL;
+BlitMaskedRowTileMaskFunc	BlitMaskedRowTileMask	= NULL;
+const char*					gBlitterName			= "none";
+
+#pragma mark - Scalar
+
+/****************** SCALAR: ONE BYTE AT A TIME ********************/
+//
+// Reference implementation. This is what Shape.c used to do inline.
+//
+
+static void BlitMaskedRow_Bytewise(uint8_t* dest, const uint8_t* src, const uint8_t* mask, int width)
+{
+	for (int i = 0; i < width; i++)
+		dest[i] = (dest[i] & mask[i]) | src[i];
+}
+
+static void BlitMaskedRowTileMask_Bytewise(uint8_t* dest, const uint8_t* src, const uint8_t* mask, const uint8_t* tileMask, int width)
+{
+	for (int i = 0; i < width; i++)
+		dest[i] = (dest[i] & (mask[i] | tileMask[i])) | (src[i] & (tileMask[i] ^ 0xff));
+}
+
+/****************** SCALAR: EIGHT BYTES AT A TIME ********************/
+//
+// Portable fallback. Sprite rows aren't aligned, so go through memcpy
+// (the compiler turns these into plain unaligned loads/stores).
+//
+
+static void BlitMaskedRow_Scalar(uint8_t* dest, const uint8_t* src, const uint8_t* mask, int width)
+{
+	int i = 0;
+
+	for (; i + 8 <= width; i += 8)
+	{
+		uint64_t d, s, m;
+		memcpy(&d, dest + i, 8);
+		memcpy(&s, src + i, 8);
+		memcpy(&m, mask + i, 8);
+		d = (d & m) | s;
+		memcpy(dest + i, &d, 8);
+	}
+
+	BlitMaskedRow_Bytewise(dest + i, src + i, mask + i, width - i);
+}
+
+static void BlitMaskedRowTileMask_Scalar(uint8_t* dest, const uint8_t* src, const uint8_t* mask, const uint8_t* tileMask, int width)
+{
+	int i = 0;
+
+	for (; i + 8 <= width; i += 8)
+	{
+		uint64_t d, s, m, t;
+		memcpy(&d, dest + i, 8);
+		memcpy(&s, src + i, 8);
+		memcpy(&m, mask + i, 8);
+		memcpy(&t, tileMask + i, 8);
+		d = (d & (m | t)) | (s & ~t);
+		memcpy(dest + i, &d, 8);
+	}
+
+	BlitMaskedRowTileMask_Bytewise(dest + i, src + i, mask + i, tileMask + i, width - i);
+}
+
+#pragma mark - x86
+
+#if SIMD_X86
+
+/****************** SSE2 ********************/
+
+SIMD_TARGET("sse2")
+static void BlitMaskedRow_SSE2(uint8_t* dest, const uint8_t* src, const uint8_t* mask, int width)
+{
+	int i = 0;
+
+	for (; i + 16 <= width; i += 16)
+	{
+		__m128i d = _mm_loadu_si128((const __m128i*) (dest + i));
+		__m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+		__m128i m = _mm_loadu_si128((const __m128i*) (mask + i));
+		d = _mm_or_si128(_mm_and_si128(d, m), s);
+		_mm_storeu_si128((__m128i*) (dest + i), d);
+	}
+
+	BlitMaskedRow_Scalar(dest + i, src + i, mask + i, width - i);
+}
+
+SIMD_TARGET("sse2")
+static void BlitMaskedRowTileMask_SSE2(uint8_t* dest, const uint8_t* src, const uint8_t* mask, const uint8_t* tileMask, int width)
+{
+	int i = 0;
+
+	for (; i + 16 <= width; i += 16)
+	{
+		__m128i d = _mm_loadu_si128((const __m128i*) (dest + i));
+		__m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+		__m128i m = _mm_loadu_si128((const __m128i*) (mask + i));
+		__m128i t = _mm_loadu_si128((const __m128i*) (tileMask + i));
+		d = _mm_or_si128(
+				_mm_and_si128(d, _mm_or_si128(m, t)),
+				_mm_andnot_si128(t, s));						// andnot computes (~t & s)
+		_mm_storeu_si128((__m128i*) (dest + i), d);
+	}
+
+	BlitMaskedRowTileMask_Scalar(dest + i, src + i, mask + i, tileMask + i, width - i);
+}
+
+/****************** AVX2 ********************/
+
+SIMD_TARGET("avx2")
+static void BlitMaskedRow_AVX2(uint8_t* dest, const uint8_t* src, const uint8_t* mask, int width)
+{
+	int i = 0;
+
+	for (; i + 32 <= width; i += 32)
+	{
+		__m256i d = _mm256_loadu_si256((const __m256i*) (dest + i));
+		__m256i s = _mm256_loadu_si256((const __m256i*) (src + i));
+		__m256i m = _mm256_loadu_si256((const __m256i*) (mask + i));
+		d = _mm256_or_si256(_mm256_and_si256(d, m), s);
+		_mm256_storeu_si256((__m256i*) (dest + i), d);
+	}
+
+	BlitMaskedRow_SSE2(dest + i, src + i, mask + i, width - i);
+}
+
+SIMD_TARGET("avx2")
+static void BlitMaskedRowTileMask_AVX2(uint8_t* dest, const uint8_t* src, const uint8_t* mask, const uint8_t* tileMask, int width)
+{
+	int i = 0;
+
+	for (; i + 32 <= width; i += 32)
+	{
+		__m256i d = _mm256_loadu_si256((const __m256i*) (dest + i));
+		__m256i s = _mm256_loadu_si256((const __m256i*) (src + i));
+		__m256i m = _mm256_loadu_si256((const __m256i*) (mask + i));
+		__m256i t = _mm256_loadu_si256((const __m256i*) (tileMask + i));
+		d = _mm256_or_si256(
+				_mm256_and_si256(d, _mm256_or_si256(m, t)),
+				_mm256_andnot_si256(t, s));
+		_mm256_storeu_si256((__m256i*) (dest + i), d);
+	}
+
+	BlitMaskedRowTileMask_SSE2(dest + i, src + i, mask + i, tileMask + i, width - i);
+}
+
+#endif // SIMD_X86
+
+#pragma mark - ARM
+
+#if SIMD_NEON
+
+/****************** NEON ********************/
+
+static void BlitMaskedRow_NEON(uint8_t* dest, const uint8_t* src, const uint8_t* mask, int width)
+{
+	int i = 0;
+
+	for (; i + 16 <= width; i += 16)
+	{
+		uint8x16_t d = vld1q_u8(dest + i);
+		uint8x16_t s = vld1q_u8(src + i);
+		uint8x16_t m = vld1q_u8(mask + i);
+		vst1q_u8(dest + i, vorrq_u8(vandq_u8(d, m), s));
+	}
+
+	BlitMaskedRow_Scalar(dest + i, src + i, mask + i, width - i);
+}
+
+static void BlitMaskedRowTileMask_NEON(uint8_t* dest, const uint8_t* src, const uint8_t* mask, const uint8_t* tileMask, int width)
+{
+	int i = 0;
+
+	for (; i + 16 <= width; i += 16)
+	{
+		uint8x16_t d = vld1q_u8(dest + i);
+		uint8x16_t s = vld1q_u8(src + i);
+		uint8x16_t m = vld1q_u8(mask + i);
+		uint8x16_t t = vld1q_u8(tileMask + i);
+		d = vorrq_u8(vandq_u8(d, vorrq_u8(m, t)), vbicq_u8(s, t));		// bic computes (s & ~t)
+		vst1q_u8(dest + i, d);
+	}
+
+	BlitMaskedRowTileMask_Scalar(dest + i, src + i, mask + i, tileMask + i, width - i);
+}
+
+#endif // SIMD_NEON
+
+#pragma mark -
+
+/****************** INIT BLITTERS ********************/
+//
+// Picks the fastest kernels that the host CPU supports.
+//
+
+void InitBlitters(void)
+{
+	BlitMaskedRow			= BlitMaskedRow_Scalar;
+	BlitMaskedRowTileMask	= BlitMaskedRowTileMask_Scalar;
+	gBlitterName			= "scalar";
+
+#if SIMD_X86
+	if (SDL_HasAVX2())
+	{
+		BlitMaskedRow			= BlitMaskedRow_AVX2;
+		BlitMaskedRowTileMask	= BlitMaskedRowTileMask_AVX2;
+		gBlitterName			= "avx2";
+	}
+	else if (SDL_HasSSE2())
+	{
+		BlitMaskedRow			= BlitMaskedRow_SSE2;
+		BlitMaskedRowTileMask	= BlitMaskedRowTileMask_SSE2;
+		gBlitterName			= "sse2";
+	}
+#elif SIMD_NEON
+	BlitMaskedRow			= BlitMaskedRow_NEON;
+	BlitMaskedRowTileMask	= BlitMaskedRowTileMask_NEON;
+	gBlitterName			= "neon";
+#endif
+
+	SDL_Log("Sprite blitter: %s\n", gBlitterName);
+}
+
+#pragma mark - Benchmark
+
+#if _DEBUG
+
+/****************** BENCHMARK BLITTERS ********************/
+//
+// Checks every kernel available on this CPU against the bytewise reference
+// at all widths up to 128, then times them on typical sprite row widths.
+// Results go to stdout.
+//
+
+typedef struct
+{
+	const char*					name;
+	BlitMaskedRowFunc			masked;
+	BlitMaskedRowTileMaskFunc	tileMasked;
+	int							supported;
+} BlitterBenchEntry;
+
+void BenchmarkBlitters(void)
+{
+	enum { kMaxWidth = 128, kNumRows = 256, kNumPasses = 200 };
+	static const int kBenchWidths[] = { 16, 32, 48, 64, 96, 128 };
+
+	BlitterBenchEntry entries[] =
+	{
+		{ "bytewise",	BlitMaskedRow_Bytewise,	BlitMaskedRowTileMask_Bytewise,	1 },
+		{ "scalar",		BlitMaskedRow_Scalar,	BlitMaskedRowTileMask_Scalar,	1 },
+#if SIMD_X86
+		{ "sse2",		BlitMaskedRow_SSE2,		BlitMaskedRowTileMask_SSE2,		SDL_HasSSE2() },
+		{ "avx2",		BlitMaskedRow_AVX2,		BlitMaskedRowTileMask_AVX2,		SDL_HasAVX2() },
+#elif SIMD_NEON
+		{ "neon",		BlitMaskedRow_NEON,		BlitMaskedRowTileMask_NEON,		1 },
+#endif
+	};
+	const int numEntries = (int) (sizeof(entries) / sizeof(entries[0]));
+
+	const size_t bufSize = kMaxWidth * kNumRows;
+	uint8_t* src		= SDL_malloc(bufSize);
+	uint8_t* mask		= SDL_malloc(bufSize);
+	uint8_t* tileMask	= SDL_malloc(bufSize);
+	uint8_t* destRef	= SDL_malloc(bufSize);
+	uint8_t* destTest	= SDL_malloc(bufSize);
+	uint8_t* destInit	= SDL_malloc(bufSize);
+
+			/* MAKE SPRITE-LIKE TEST DATA: MASK IS 00 OR FF, SRC IS 0 WHERE MASK IS FF */
+
+	uint32_t seed = 0x12345678;
+	for (size_t i = 0; i < bufSize; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		mask[i]		= (seed >> 24) & 1 ? 0xFF : 0x00;
+		src[i]		= mask[i] ? 0 : (uint8_t) (seed >> 8);
+		tileMask[i]	= (seed >> 25) & 1 ? 0xFF : 0x00;
+		destInit[i]	= (uint8_t) (seed >> 16);
+	}
+
+			/* VERIFY EXACT OUTPUT AT EVERY WIDTH AND MISALIGNMENT */
+
+	for (int e = 0; e < numEntries; e++)
+	{
+		if (!entries[e].supported)
+			continue;
+
+		for (int width = 0; width <= kMaxWidth - 3; width++)
+		{
+			for (int misalign = 0; misalign < 3; misalign++)
+			{
+				memcpy(destRef, destInit, kMaxWidth);
+				memcpy(destTest, destInit, kMaxWidth);
+				BlitMaskedRow_Bytewise(destRef + misalign, src, mask, width);
+				entries[e].masked(destTest + misalign, src, mask, width);
+				if (0 != memcmp(destRef, destTest, kMaxWidth))
+					printf("BLIT MISMATCH: %s masked, width %d, misalign %d\n", entries[e].name, width, misalign);
+
+				memcpy(destRef, destInit, kMaxWidth);
+				memcpy(destTest, destInit, kMaxWidth);
+				BlitMaskedRowTileMask_Bytewise(destRef + misalign, src, mask, tileMask, width);
+				entries[e].tileMasked(destTest + misalign, src, mask, tileMask, width);
+				if (0 != memcmp(destRef, destTest, kMaxWidth))
+					printf("BLIT MISMATCH: %s tilemasked, width %d, misalign %d\n", entries[e].name, width, misalign);
+			}
+		}
+	}
+
+			/* TIME IT */
+
+	double ticksToNs = 1e9 / (double) SDL_GetPerformanceFrequency();
+
+	printf("%-10s %6s %14s %14s\n", "blitter", "width", "masked ns/row", "tilemask ns/row");
+
+	for (int e = 0; e < numEntries; e++)
+	{
+		if (!entries[e].supported)
+			continue;
+
+		for (size_t w = 0; w < sizeof(kBenchWidths) / sizeof(kBenchWidths[0]); w++)
+		{
+			int width = kBenchWidths[w];
+
+			memcpy(destTest, destInit, bufSize);
+			for (int row = 0; row < kNumRows; row++)						// warm up
+				entries[e].masked(destTest + row*kMaxWidth, src + row*kMaxWidth, mask + row*kMaxWidth, width);
+
+			uint64_t t0 = SDL_GetPerformanceCounter();
+			for (int pass = 0; pass < kNumPasses; pass++)
+				for (int row = 0; row < kNumRows; row++)
+					entries[e].masked(destTest + row*kMaxWidth, src + row*kMaxWidth, mask + row*kMaxWidth, width);
+			uint64_t t1 = SDL_GetPerformanceCounter();
+			for (int pass = 0; pass < kNumPasses; pass++)
+				for (int row = 0; row < kNumRows; row++)
+					entries[e].tileMasked(destTest + row*kMaxWidth, src + row*kMaxWidth, mask + row*kMaxWidth, tileMask + row*kMaxWidth, width);
+			uint64_t t2 = SDL_GetPerformanceCounter();
+
+			double numRows = (double) kNumPasses * kNumRows;
+			printf("%-10s %6d %14.2f %14.2f\n",
+					entries[e].name, width,
+					(t1 - t0) * ticksToNs / numRows,
+					(t2 - t1) * ticksToNs / numRows);
+		}
+	}
+
+	SDL_free(src);
+	SDL_free(mask);
+	SDL_free(tileMask);
+	SDL_free(destRef);
+	SDL_free(destTest);
+	SDL_free(destInit);
+}
+
+#endif // _DEBUG
@@ -23,6 +23,8 @@
 #include "misc.h"
 #include "renderdrivers.h"
 #include "framebufferfilter.h"
+#include "profiler.h"
+#include "window.h"
 
 #if __APPLE__
 #include <OpenGL/gl.h>
@@ -68,6 +70,7 @@ PFNGLUNMAPBUFFERARBPROC glUnmapBufferARB;
 static SDL_GLContext gGLContext = NULL;
 static GLuint gFrameTexture = 0;
 static GLuint gFramePBO = 0;
+static Ptr gPipelinedFrameBuffer = nil;		// converter output for pipelined presents (can't stay mapped across frames like the PBO)
 static GLint gMaxTextureSize = 0;
 
 const char* gRendererName = "NULL";
@@ -166,10 +169,51 @@ static void InitTextureAndPBO(int pixelZoom)
 			NULL // need initial call with NULL so glTexSubImage2D works later on
 	);
 	CHECK_GL_ERROR();
+
+	// New texture is blank, so the whole screen must be converted again
+	MarkDirtyFramebuffer();
+}
+
+/****************** UPLOAD CONVERTED ROWS **********************/
+//
+// Uploads the rows that the converters produced to the texture, either from the bound PBO
+// (pixels == NULL: offsets into the PBO) or from client memory.
+// Rows that didn't change keep their contents from the previous frame in the texture,
+// which is why the source only needs to contain valid data for those rows.
+//
+
+static void UploadConvertedRows(int zoom, const void* pixels)
+{
+	uint64_t profileStart = gProfilerEnabled ? GetProfilerTime() : 0;
+	int zvw = zoom * VISIBLE_WIDTH;
+	int numRows = 0;
+
+	for (int row = GetNextConvertedRowRun(0, VISIBLE_HEIGHT, &numRows);
+		row >= 0;
+		row = GetNextConvertedRowRun(row + numRows, VISIBLE_HEIGHT, &numRows))
+	{
+		uintptr_t offset = (uintptr_t) zoom * row * zvw * kFrameBytesPerPixel;
+
+		glTexSubImage2D(GL_TEXTURE_2D, 0,
+				0, zoom * row, zvw, zoom * numRows,
+				kFramePixelFormat, kFramePixelType, (const void*) ((uintptr_t) pixels + offset));
+		CHECK_GL_ERROR();
+	}
+
+	if (gProfilerEnabled)
+		RecordProfilerSpan(kProfile_Upload, kProfileThread_Main, profileStart);
 }
 
 static void DeleteTextureAndPBO(void)
 {
+	CancelConvertFramebufferMT();			// converter threads may still be writing to gPipelinedFrameBuffer
+
+	if (gPipelinedFrameBuffer != nil)
+	{
+		DisposePtr(gPipelinedFrameBuffer);
+		gPipelinedFrameBuffer = nil;
+	}
+
 	if (gFrameTexture != 0)
 	{
 		glDeleteTextures(1, &gFrameTexture);
@@ -296,7 +340,7 @@ static SDL_Rect GetViewportSize(void)
 	};
 }
 
-void GLRender_PresentFramebuffer(void)
+void GLRender_PresentFramebuffer(Boolean pipelined)
 {
 	static SDL_Rect previousViewportRect = {0};
 	static int previousEffectiveScalingType = kScaling_Unspecified;
@@ -331,27 +375,60 @@ void GLRender_PresentFramebuffer(void)
 	int zvw = (isHQ ? 2 : 1) * vw;
 	int zvh = (isHQ ? 2 : 1) * vh;
 
-#ifndef __vita__
+	// If nothing changed on screen, keep the texture as is
+	bool needUpload = gNumDirtyFramebufferRows > 0;
+
+#ifdef __vita__
+	(void) pipelined;		// we convert straight into the texture's memory, so there's nothing to overlap
+#else
+	//-------------------------------------------------------------------------
+	// Upload the previous frame if it was converted in the background
+
+	if (FinishConvertFramebufferMT())
+	{
+		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+		glBindTexture(GL_TEXTURE_2D, gFrameTexture);
+		UploadConvertedRows(isHQ? 2: 1, gPipelinedFrameBuffer);
+	}
+
+	//-------------------------------------------------------------------------
+	// Start converting this frame in the background
+
+	if (pipelined && needUpload)
+	{
+		if (gPipelinedFrameBuffer == nil)
+		{
+			gPipelinedFrameBuffer = NewPtr(kFrameTextureWidth * kFrameTextureHeight * kFrameBytesPerPixel * 4);	// room for HQ stretch
+			GAME_ASSERT(gPipelinedFrameBuffer);
+		}
+
+		BeginConvertFramebufferMT((color_t*) gPipelinedFrameBuffer);
+		needUpload = false;			// it'll get uploaded on the next present
+	}
+
 	//-------------------------------------------------------------------------
 	// Update PBO
 
-	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, gFramePBO);
-	CHECK_GL_ERROR();
+	if (needUpload)
+	{
+		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, gFramePBO);
+		CHECK_GL_ERROR();
 
-	// get new PBO
-	int numBytes = zvw * zvh * kFrameBytesPerPixel;
-	glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, numBytes, NULL, GL_STREAM_DRAW);
-	CHECK_GL_ERROR();
+		// get new PBO
+		int numBytes = zvw * zvh * kFrameBytesPerPixel;
+		glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, numBytes, NULL, GL_STREAM_DRAW);
+		CHECK_GL_ERROR();
 
-	void* mappedBuffer = glMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY);
-	CHECK_GL_ERROR();
-	GAME_ASSERT(mappedBuffer);
+		void* mappedBuffer = glMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY);
+		CHECK_GL_ERROR();
+		GAME_ASSERT(mappedBuffer);
 
-	// now write data into the buffer, possibly in another thread
-	ConvertFramebufferMT(mappedBuffer);
+		// now write data into the buffer, possibly in another thread
+		ConvertFramebufferMT(mappedBuffer);
 
-	glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB);
-	CHECK_GL_ERROR();
+		glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB);
+		CHECK_GL_ERROR();
+	}
 #endif
 
 	//-------------------------------------------------------------------------
@@ -372,8 +449,11 @@ void GLRender_PresentFramebuffer(void)
 
 	glBindTexture(GL_TEXTURE_2D, gFrameTexture);
 #ifdef __vita__
-	void *mappedBuffer = vglGetTexDataPointer(GL_TEXTURE_2D);
-	ConvertFramebufferMT(mappedBuffer);
+	if (needUpload)
+	{
+		void *mappedBuffer = vglGetTexDataPointer(GL_TEXTURE_2D);
+		ConvertFramebufferMT(mappedBuffer);
+	}
 #endif
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
@@ -382,8 +462,8 @@ void GLRender_PresentFramebuffer(void)
 #ifndef __vita__
 #if !DEFERRED_TEX_UPDATE
 	// Update the texture
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, zvw, zvh, kFramePixelFormat, kFramePixelType, NULL);
-	CHECK_GL_ERROR();
+	if (needUpload)
+		UploadConvertedRows(isHQ? 2: 1, NULL);
 #endif
 #endif
 	const float umax = vw * (1.0f / kFrameTextureWidth);
@@ -405,8 +485,8 @@ void GLRender_PresentFramebuffer(void)
 	//-------------------------------------------------------------------------
 	// Update texture
 
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, zvw, zvh, kFramePixelFormat, kFramePixelType, NULL);
-	CHECK_GL_ERROR();
+	if (needUpload)
+		UploadConvertedRows(isHQ? 2: 1, NULL);
 #endif
 #endif
 }
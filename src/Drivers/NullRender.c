@@ -0,0 +1,81 @@
+// NULL RENDER DRIVER
+// Headless presentation backend: no window, no texture.
+// Used to run the full game loop on machines without a display server,
+// e.g. to measure CPU cost per frame or to run soak tests.
+
+#include <SDL.h>
+#include "myglobals.h"
+#include "externs.h"
+#include "misc.h"
+#include "renderdrivers.h"
+#include "framebufferfilter.h"
+#include "window.h"
+
+static color_t*			gNullFramebuffer		= NULL;
+static int				gNullFramebufferSize	= 0;
+static Boolean			gNullRenderConverts		= false;
+
+void NullRender_Init(Boolean convertFrames)
+{
+	gNullRenderConverts = convertFrames;
+	gRendererName = convertFrames ? "null-convert" : "null";
+	gCanDoHQStretch = false;
+}
+
+static void NullRender_NukeBuffers(void)
+{
+	CancelConvertFramebufferMT();		// converter threads may still be writing to gNullFramebuffer
+
+	if (gNullFramebuffer)
+	{
+		DisposePtr((Ptr) gNullFramebuffer);
+		gNullFramebuffer = NULL;
+	}
+
+	gNullFramebufferSize = 0;
+}
+
+void NullRender_Shutdown(void)
+{
+	ShutdownRenderThreads();
+
+	NullRender_NukeBuffers();
+}
+
+void NullRender_PresentFramebuffer(Boolean pipelined)
+{
+	if (!gNullRenderConverts)			// nothing to do, the frame just gets dropped
+	{
+		return;
+	}
+
+	//-------------------------------------------------------------------------
+	// Retire the previous frame if it was converted in the background (there's nothing to upload)
+
+	FinishConvertFramebufferMT();
+
+	//-------------------------------------------------------------------------
+	// (Re)allocate the color buffer if the playfield size changed
+
+	int numPixels = VISIBLE_WIDTH * VISIBLE_HEIGHT;
+
+	if (gNullFramebufferSize != numPixels)
+	{
+		NullRender_NukeBuffers();
+
+		gNullFramebuffer = (color_t*) NewPtrClear(numPixels * (int) sizeof(color_t));
+		GAME_ASSERT(gNullFramebuffer);
+		gNullFramebufferSize = numPixels;
+
+		// New buffer is blank, so the whole screen must be converted again
+		MarkDirtyFramebuffer();
+	}
+
+	//-------------------------------------------------------------------------
+	// Convert indexed to RGBA, with optional post-processing
+
+	if (!pipelined)
+		ConvertFramebufferMT(gNullFramebuffer);
+	else
+		BeginConvertFramebufferMT(gNullFramebuffer);
+}
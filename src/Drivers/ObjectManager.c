@@ -14,6 +14,7 @@
 #include "object.h"
 #include "misc.h"
 #include "shape.h"
+#include "collision.h"
 #include <string.h>
 #include "externs.h"
 
@@ -21,6 +22,24 @@
 /*    CONSTANTS             */
 /****************************/
 
+#define	Z_BUCKET_SH			8							// Z index buckets are 256 Z's wide
+#define	NUM_Z_BUCKETS		((0x10000 >> Z_BUCKET_SH) + 1)	// +1 for Z's past 16 bits
+#define	NUM_Z_BUCKET_WORDS	((NUM_Z_BUCKETS + 63) / 64)
+
+enum
+{
+	Z_INDEX_DIRTY,										// Z's changed since last RebuildZIndex
+	Z_INDEX_VALID,										// list is in non-increasing Z order & buckets are current
+	Z_INDEX_UNSORTED									// list isn't in Z order: MakeNewObject must scan it
+};
+
+/****************************/
+/*    PROTOTYPES            */
+/****************************/
+
+static ObjNode *FindZInsertionPoint(unsigned long z, ObjNode **prevNode);
+static void RemoveFromZIndex(ObjNode *theNode);
+
 /**********************/
 /*     VARIABLES      */
 /**********************/
@@ -40,6 +59,14 @@ long		NodeStackFront;
 
 ObjNode		*gThisNodePtr,*gMostRecentlyAddedNode;
 
+static	ObjNode		*gCTypeLists[NUM_CTYPE_BITS];		// 1st node in each per-CTYPE bit list (unordered)
+static	Boolean		gObjectListRanksValid = false;
+
+static	int			gZIndexState = Z_INDEX_DIRTY;
+static	ObjNode		*gZBucketFirstNode[NUM_Z_BUCKETS];			// 1st node of each Z bucket's run in the (Z-sorted) list
+static	uint64_t	gZBucketBits[NUM_Z_BUCKET_WORDS];			// set where gZBucketFirstNode != nil
+static	ObjNode		*gLastNodePtr;								// last node in the list, valid with the Z index
+
 long		gDX,gDY,gSumDX,gSumDY;		// global object stuff
 
 MikeFixed	gX;
@@ -90,6 +117,11 @@ void InitObjectManager(void)
 
 	FirstNodePtr = nil;									// no node yet
 	NumObjects = 0;
+	for (int i = 0; i < NUM_CTYPE_BITS; i++)
+		gCTypeLists[i] = nil;
+	ResetCollisionGrid();
+	InvalidateObjectListRanks();
+	gZIndexState = Z_INDEX_DIRTY;
 	for (int i = 0; i < MAX_OBJECTS; i++)
 	{
 		// No need to init most fields to 0 since we used NewHandleClear.
@@ -111,16 +143,185 @@ void InitObjectManager(void)
 }
 
 
+/*********************** GET Z BUCKET ******************/
+
+static inline int GetZBucket(unsigned long z)
+{
+	if (z >= 0x10000)									// SortObjectsByY can produce these from odd Y's
+		return NUM_Z_BUCKETS-1;
+	return (int) (z >> Z_BUCKET_SH);
+}
+
+
+/*********************** REBUILD Z INDEX ******************/
+//
+// Since the list is sorted from largest Z to smallest, each Z bucket is
+// a contiguous run of nodes. Remember where each run starts.
+//
+
+static void RebuildZIndex(void)
+{
+unsigned long	prevZ = ~0ul;
+int				prevBucket = -1;
+
+	memset(gZBucketFirstNode, 0, sizeof(gZBucketFirstNode));
+	memset(gZBucketBits, 0, sizeof(gZBucketBits));
+	gLastNodePtr = nil;
+
+	for (ObjNode* node = FirstNodePtr; node != nil; node = node->NextNode)
+	{
+		if (node->Z > prevZ)							// out of order (e.g. Z set directly by a move routine)
+		{
+			gZIndexState = Z_INDEX_UNSORTED;
+			return;
+		}
+
+		int bucket = GetZBucket(node->Z);
+		if (bucket != prevBucket)
+		{
+			gZBucketFirstNode[bucket] = node;
+			gZBucketBits[bucket >> 6] |= 1ull << (bucket & 63);
+			prevBucket = bucket;
+		}
+
+		prevZ = node->Z;
+		gLastNodePtr = node;
+	}
+
+	gZIndexState = Z_INDEX_VALID;
+}
+
+
+/*********************** FIND NONEMPTY Z BUCKET BELOW ******************/
+//
+// Returns the highest bucket # < bucket that has nodes in it, or -1.
+//
+
+static int FindNonemptyZBucketBelow(int bucket)
+{
+	for (int word = bucket >> 6; word >= 0; word--)
+	{
+		uint64_t bits = gZBucketBits[word];
+
+		if (word == (bucket >> 6))						// only look below bucket in its own word
+			bits &= (1ull << (bucket & 63)) - 1;
+
+		if (bits)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return word * 64 + 63 - __builtin_clzll(bits);
+#else
+			int bit = 63;
+			while (!(bits & (1ull << bit)))
+				bit--;
+			return word * 64 + bit;
+#endif
+		}
+	}
+
+	return -1;
+}
+
+
+/*********************** FIND Z INSERTION POINT ******************/
+//
+// Finds the 1st node in the list whose Z <= z (nil = end of list).
+// *prevNode gets the node right before it (nil = start of list).
+//
+
+static ObjNode *FindZInsertionPoint(unsigned long z, ObjNode **prevNode)
+{
+ObjNode		*scanNodePtr,*reNodePtr;
+
+	if (gZIndexState == Z_INDEX_DIRTY)
+		RebuildZIndex();
+
+	if (gZIndexState != Z_INDEX_VALID)					// no index, scan from the top
+	{
+		reNodePtr = nil;
+		scanNodePtr = FirstNodePtr;
+	}
+	else
+	{
+		int bucket = GetZBucket(z);
+
+		scanNodePtr = gZBucketFirstNode[bucket];		// every node before this run has a larger Z
+		if (scanNodePtr == nil)
+		{
+			int below = FindNonemptyZBucketBelow(bucket);
+			scanNodePtr = (below >= 0) ? gZBucketFirstNode[below] : nil;	// every node from here on has a smaller Z
+		}
+
+		reNodePtr = scanNodePtr ? scanNodePtr->PrevNode : gLastNodePtr;
+	}
+
+	while (scanNodePtr != nil && z < scanNodePtr->Z)
+	{
+		reNodePtr = scanNodePtr;
+		scanNodePtr = scanNodePtr->NextNode;
+	}
+
+	*prevNode = reNodePtr;
+	return scanNodePtr;
+}
+
+
+/*********************** REMOVE FROM Z INDEX ******************/
+
+static void RemoveFromZIndex(ObjNode *theNode)
+{
+	if (gZIndexState != Z_INDEX_VALID)
+		return;
+
+	int bucket = GetZBucket(theNode->Z);
+
+	if (gZBucketFirstNode[bucket] == theNode)
+	{
+		ObjNode* next = theNode->NextNode;
+
+		if (next != nil && GetZBucket(next->Z) == bucket)
+		{
+			gZBucketFirstNode[bucket] = next;
+		}
+		else
+		{
+			gZBucketFirstNode[bucket] = nil;
+			gZBucketBits[bucket >> 6] &= ~(1ull << (bucket & 63));
+		}
+	}
+
+	if (gLastNodePtr == theNode)
+		gLastNodePtr = theNode->PrevNode;
+}
+
+
+/*********************** SET OBJECT Z ******************/
+//
+// Changes a node's Z without moving it in the list (it will move on the next SortObjectsByY).
+// Always change Z through here so that MakeNewObject's Z index stays in sync.
+//
+
+void SetObjectZ(ObjNode *theNode, unsigned long z)
+{
+	theNode->Z = z;
+	gZIndexState = Z_INDEX_DIRTY;
+}
+
+
 /*********************** MAKE NEW OBJECT ******************/
 //
 // MAKE NEW OBJECT & RETURN PTR TO IT
 //
 // The linked list is sorted from LARGEST z to smallest!
 //
+// Source port note: the insertion point used to be found by walking the list from the top.
+// It's now looked up in a bucketed Z index (see FindZInsertionPoint), which gives the same
+// spot as long as the list really is in Z order, and falls back to the walk when it isn't.
+//
 
 ObjNode	*MakeNewObject(Byte genre, short x, short y, unsigned short z, void (*moveCall)(void))
 {
-register ObjNode	*newNodePtr,*scanNodePtr,*reNodePtr;
+ObjNode			*newNodePtr,*scanNodePtr,*reNodePtr;
 
 
 	if (NumObjects == (MAX_OBJECTS-1))			// check for overflow
@@ -152,46 +353,41 @@ register ObjNode	*newNodePtr,*scanNodePtr,*reNodePtr;
 		newNodePtr->OldX.Int = (long)x;
 		newNodePtr->OldY.Int = (long)y;
 
+		newNodePtr->CollisionCell = -1;
+		UpdateObjectCollisionCell(newNodePtr);	// file the (zero) collision box
+
 					/* FIND INSERTION PLACE FOR NODE */
 
-	if (FirstNodePtr == nil)							// special case only entry
-	{
-		FirstNodePtr = newNodePtr;
-		newNodePtr->PrevNode = nil;
-		newNodePtr->NextNode = nil;
-	}
-	else if (z >= FirstNodePtr->Z)						// INSERT AS FIRST NODE
-	{
-		newNodePtr->PrevNode = nil;						// no prev
-		newNodePtr->NextNode = FirstNodePtr; 		// next pts to old 1st
-		FirstNodePtr->PrevNode = newNodePtr; 		// old pts to new 1st
-		FirstNodePtr = newNodePtr;
-	}
+	scanNodePtr = FindZInsertionPoint(z, &reNodePtr);	// insert before 1st node whose Z <= z
+
+	newNodePtr->NextNode = scanNodePtr;
+	newNodePtr->PrevNode = reNodePtr;
+
+	if (reNodePtr)
+		reNodePtr->NextNode = newNodePtr;
 	else
+		FirstNodePtr = newNodePtr;						// INSERT AS FIRST NODE
+
+	if (scanNodePtr)
+		scanNodePtr->PrevNode = newNodePtr;
+
+					/* ADD TO Z INDEX */
+
+	if (gZIndexState == Z_INDEX_VALID)
 	{
-		reNodePtr = FirstNodePtr;
-		scanNodePtr = FirstNodePtr;
+		int bucket = GetZBucket(z);
 
-		while (scanNodePtr != nil)
+		if (reNodePtr == nil || GetZBucket(reNodePtr->Z) != bucket)		// starts its bucket's run
 		{
-			if (z >= scanNodePtr->Z)						// INSERT IN MIDDLE HERE
-			{
-				newNodePtr->NextNode = scanNodePtr;
-				newNodePtr->PrevNode = reNodePtr;
-				reNodePtr->NextNode = newNodePtr;
-				scanNodePtr->PrevNode = newNodePtr;
-				goto out;
-			}
-			reNodePtr = scanNodePtr;
-			scanNodePtr=(ObjNode *)scanNodePtr->NextNode;	// try next node
+			gZBucketFirstNode[bucket] = newNodePtr;
+			gZBucketBits[bucket >> 6] |= 1ull << (bucket & 63);
 		}
 
-		newNodePtr->NextNode = nil;							// TAG TO END
-		newNodePtr->PrevNode = reNodePtr;
-		reNodePtr->NextNode = newNodePtr;
+		if (scanNodePtr == nil)
+			gLastNodePtr = newNodePtr;
 	}
 
-out:
+	InvalidateObjectListRanks();							// list order changed
 	NumObjects++;											// its done
 	gMostRecentlyAddedNode = newNodePtr;					// remember this
 	return(newNodePtr);
@@ -263,6 +459,10 @@ void EraseObjects(void)
 {
 register	ObjNode		*thisNodePtr;
 
+	FlushPlayfieldCopy();					// sprites are about to be erased from the PF buffer
+
+	ClearPlayfieldSpriteCells();			// all playfield sprites are about to be erased
+
 	if (FirstNodePtr == nil)				// see if there are any objects
 		return;
 
@@ -377,6 +577,7 @@ void UpdateObject(void)
 	gThisNodePtr->BottomSide = gBottomSide;
 	gThisNodePtr->LeftSide = gLeftSide;
 	gThisNodePtr->RightSide = gRightSide;
+	UpdateObjectCollisionCell(gThisNodePtr);
 
 	if (gDiscreteMovementFlag)			// prevent movement interpolation
 	{
@@ -408,6 +609,7 @@ void CalcObjectBox2(ObjNode *theNode)
 	theNode->BottomSide = (theNode->Y.Int)+theNode->BottomOff;
 	theNode->LeftSide = (theNode->X.Int)+theNode->LeftOff;
 	theNode->RightSide = (theNode->X.Int)+theNode->RightOff;
+	UpdateObjectCollisionCell(theNode);
 }
 
 
@@ -458,6 +660,9 @@ Rect	box;
 		tempNode->PrevNode = theNode->PrevNode;
 	}
 
+	RemoveObjectCollisionCell(theNode);				// deleting doesn't change the order of the others
+	RemoveFromZIndex(theNode);						// (needs the node's links, so do it before unlinking)
+
 	NodeStackFront--;								// put node back on stack
 	FreeNodeStack[NodeStackFront] = &ObjectList[theNode->NodeNum];
 
@@ -479,6 +684,7 @@ Rect	box;
 		}
 	}
 
+	SetObjectCType(theNode, 0);						// leave the per-CTYPE lists
 	theNode->CType = INVALID_NODE_FLAG;				// INVALID_NODE_FLAG indicates its deleted
 
 
@@ -563,14 +769,27 @@ static	Rect	box;
 
 /****************** SORT OBJECTS BY Y *********************/
 //
-// Does a pseudo bubble sort based on an object's Y coord.
+// Sorts the objects based on their Y coord.
 // Remember that list is in LARGEST to SMALLEST order, so Y coord is
 // inversely related to Z coord.
 //
+// Source port note: the original did a single bubble pass per frame, so the draw order
+// could stay wrong for a few frames when several objects crossed each other.
+// Now the sortable band of the list is copied into an array and insertion-sorted,
+// which is fully sorted every frame and costs about one pass when the order
+// barely changed since last frame. Equal Y's keep their current order.
+//
 
 void SortObjectsByY(void)
 {
-register	ObjNode 	*nodePtr,*nextNode;
+static	struct
+{
+	long		y;
+	ObjNode		*node;
+} band[MAX_OBJECTS];
+ObjNode 	*nodePtr,*bandPrev,*bandNext;
+int			numInBand,i,j;
+Boolean		orderChanged = false;
 
 	if (NumObjects < 2)									// see if anything to sort
 		return;
@@ -586,42 +805,232 @@ register	ObjNode 	*nodePtr,*nextNode;
 			return;
 	}
 
+	bandPrev = nodePtr->PrevNode;
+
+				/* GATHER NODES UP TO THE "NEAREST" RANGE */
+
+	numInBand = 0;
+	for (; nodePtr != nil && nodePtr->Z > NEAREST_Z; nodePtr = nodePtr->NextNode)
+	{
+		GAME_ASSERT(numInBand < MAX_OBJECTS);
+		band[numInBand].y = nodePtr->Y.Int;
+		band[numInBand].node = nodePtr;
+		numInBand++;
+	}
+	bandNext = nodePtr;
+
+	if (numInBand < 2)
+		return;
 
 						/* SORT */
 
-	while ((nextNode = nodePtr->NextNode) != nil)		// scan until end
+	for (i = 1; i < numInBand; i++)
 	{
-		if (nextNode->Z <= NEAREST_Z)					// stop if gets to "Nearest" range
-			return;
+		if (band[i-1].y <= band[i].y)					// already in place (the usual case)
+			continue;
+
+		long		y = band[i].y;
+		ObjNode*	node = band[i].node;
+
+		for (j = i; j > 0 && band[j-1].y > y; j--)
+			band[j] = band[j-1];
+
+		band[j].y = y;
+		band[j].node = node;
+		orderChanged = true;
+	}
+
+				/* SET Z'S & RELINK */
+
+	gZIndexState = Z_INDEX_DIRTY;
+
+	for (i = 0; i < numInBand; i++)
+	{
+		nodePtr = band[i].node;
+		nodePtr->Z = (0x7FFF - band[i].y);				// Z = (MAXY - Y coord)
+
+		if (orderChanged)
+		{
+			nodePtr->PrevNode = (i > 0) ? band[i-1].node : bandPrev;
+			nodePtr->NextNode = (i < numInBand-1) ? band[i+1].node : bandNext;
+		}
+	}
+
+	if (orderChanged)
+	{
+		if (bandPrev)
+			bandPrev->NextNode = band[0].node;
+		else
+			FirstNodePtr = band[0].node;
+
+		if (bandNext)
+			bandNext->PrevNode = band[numInBand-1].node;
+
+		InvalidateObjectListRanks();
+	}
+}
+
+
+/******************** INVALIDATE OBJECT LIST RANKS *****************/
+//
+// Call whenever nodes are inserted into the linked list or swapped around.
+// (Deleting a node doesn't change the relative order of the others.)
+//
+
+void InvalidateObjectListRanks(void)
+{
+	gObjectListRanksValid = false;
+}
+
+
+/******************** UPDATE OBJECT LIST RANKS *****************/
+//
+// Numbers the nodes in linked list order, so that code which finds objects
+// some other way can still break ties the way a scan of the list would.
+//
+
+void UpdateObjectListRanks(void)
+{
+unsigned long	rank = 0;
+
+	if (gObjectListRanksValid)
+		return;
+
+	for (ObjNode* node = FirstNodePtr; node != nil; node = node->NextNode)
+		node->ListRank = rank++;
+
+	gObjectListRanksValid = true;
+}
+
+
+/******************** GET CTYPE BIT INDEX *****************/
+
+static int GetCTypeBitIndex(unsigned long cTypeBit)
+{
+int		bitIndex = 0;
 
-		nodePtr->Z = (0x7FFF - nodePtr->Y.Int);			// Z = (MAXY - Y coord)
+	GAME_ASSERT(cTypeBit != 0 && (cTypeBit & (cTypeBit-1)) == 0);		// must be exactly one CTYPE bit
 
-		if (nodePtr->Y.Int > nextNode->Y.Int)			// if this Y is below next, then must swap
+	while (!(cTypeBit & 1))
+	{
+		cTypeBit >>= 1;
+		bitIndex++;
+	}
+
+	GAME_ASSERT(bitIndex < NUM_CTYPE_BITS);
+	return bitIndex;
+}
+
+
+/******************** SET OBJECT CTYPE *****************/
+//
+// Always change an object's CType through here so that the per-CTYPE lists stay current.
+// Does nothing on a deleted node: it must keep INVALID_NODE_FLAG, and it isn't in any list.
+//
+
+void SetObjectCType(ObjNode *theNode, unsigned long cType)
+{
+unsigned long	oldBits,newBits,changedBits;
+ObjNode			*next,*prev;
+
+	if (theNode->CType == INVALID_NODE_FLAG)		// see if already deleted
+		return;
+
+	oldBits = theNode->CType & ((1L << NUM_CTYPE_BITS) - 1);
+	newBits = cType & ((1L << NUM_CTYPE_BITS) - 1);
+	changedBits = oldBits ^ newBits;
+
+	for (int i = 0; changedBits != 0; i++, changedBits >>= 1)
+	{
+		if (!(changedBits & 1))
+			continue;
+
+		if (oldBits & (1L << i))					// UNLINK FROM LIST
 		{
-			nextNode->Z = (0x7FFF - nextNode->Y.Int);	// set this Z since about to get swapped
-			if (nodePtr == FirstNodePtr)				// see if was 1st node
-			{
-				FirstNodePtr = nextNode;				// next is now the 1st node
-				nextNode->PrevNode = nil;
-				nodePtr->NextNode = nextNode->NextNode;
-				if (nextNode->NextNode)
-					nextNode->NextNode->PrevNode = nodePtr;	// next's next's prev now pts to current
-				nodePtr->PrevNode = nextNode;
-				nextNode->NextNode = nodePtr;
-			}
+			next = theNode->CTypeNextNode[i];
+			prev = theNode->CTypePrevNode[i];
+
+			if (prev)
+				prev->CTypeNextNode[i] = next;
 			else
-			{
-				nextNode->PrevNode = nodePtr->PrevNode;
-				nodePtr->PrevNode->NextNode	= nextNode;	// current's prev's next pts to next
-				nodePtr->NextNode = nextNode->NextNode;
-				if (nextNode->NextNode)
-					nextNode->NextNode->PrevNode = nodePtr;	// next's next's prev now pts to current
-
-				nodePtr->PrevNode = nextNode;
-				nextNode->NextNode = nodePtr;
-			}
+				gCTypeLists[i] = next;
+
+			if (next)
+				next->CTypePrevNode[i] = prev;
+
+			theNode->CTypeNextNode[i] = nil;
+			theNode->CTypePrevNode[i] = nil;
+		}
+		else										// LINK INTO LIST
+		{
+			next = gCTypeLists[i];
+			theNode->CTypeNextNode[i] = next;
+			theNode->CTypePrevNode[i] = nil;
+			if (next)
+				next->CTypePrevNode[i] = theNode;
+			gCTypeLists[i] = theNode;
+		}
+	}
+
+	theNode->CType = cType;
+}
+
+
+/******************** GET FIRST/NEXT OBJECT OF CTYPE *****************/
+//
+// Iterates over the objects whose CType has the given bit set, e.g.:
+//
+//	for (node = GetFirstObjectOfCType(CTYPE_ENEMYA); node; node = GetNextObjectOfCType(node, CTYPE_ENEMYA))
+//
+// The order is NOT the linked list order. Use ListRank (see UpdateObjectListRanks) if it matters.
+// Don't change the CType of the current node while iterating.
+//
+
+ObjNode *GetFirstObjectOfCType(unsigned long cTypeBit)
+{
+	return gCTypeLists[GetCTypeBitIndex(cTypeBit)];
+}
+
+ObjNode *GetNextObjectOfCType(ObjNode *theNode, unsigned long cTypeBit)
+{
+	return theNode->CTypeNextNode[GetCTypeBitIndex(cTypeBit)];
+}
+
+
+/******************** REBUILD OBJECT INDEXES *****************/
+//
+// Call after the node array and linked list were restored wholesale (see LoadCurrentPlayer),
+// since the per-CTYPE lists and the collision grid have their heads outside of the nodes.
+//
+
+void RebuildObjectIndexes(void)
+{
+unsigned long	cType;
+
+	for (int i = 0; i < NUM_CTYPE_BITS; i++)
+		gCTypeLists[i] = nil;
+	ResetCollisionGrid();
+	InvalidateObjectListRanks();
+	gZIndexState = Z_INDEX_DIRTY;
+
+	for (ObjNode* node = FirstNodePtr; node != nil; node = node->NextNode)
+	{
+		node->CollisionCell = -1;
+		node->CollisionPrevNode = nil;
+		node->CollisionNextNode = nil;
+		UpdateObjectCollisionCell(node);
+
+		for (int i = 0; i < NUM_CTYPE_BITS; i++)
+		{
+			node->CTypePrevNode[i] = nil;
+			node->CTypeNextNode[i] = nil;
 		}
-		nodePtr = nextNode;								// point to next node
+
+		cType = node->CType;
+		if (cType == INVALID_NODE_FLAG)				// deleted node stays out of the lists
+			continue;
+		node->CType = 0;
+		SetObjectCType(node, cType);
 	}
 }
 
@@ -671,6 +1080,8 @@ void DumpUpdateRegions_DontPresentFramebuffer(void)
 		if (!height)									// special check for 0 heights
 			height = 1;
 
+		MarkDirtyFramebufferRows(top-OFFSCREEN_WINDOW_TOP, height);
+
 		do
 		{
 			memcpy(destPtr, srcPtr, width);
@@ -77,6 +77,7 @@ static void MakeBackUpPalette(void)
 static void RestoreBackUpPalette(void)
 {
 	memcpy(&gGamePalette, &gBackUpPalette, sizeof(GamePalette));
+	MarkDirtyFramebuffer();
 }
 
 
@@ -140,6 +141,7 @@ void EraseCLUT(void)
 		gGamePalette.finalColors16[i] = color16;
 	}
 
+	MarkDirtyFramebuffer();
 	gScreenBlankedFlag = true;
 }
 
@@ -251,4 +253,7 @@ void SetPaletteColor(struct GamePalette_s *palette, int index, const RGBColor *c
 	palette->baseColors[index] = *color;
 	palette->finalColors32[index] = color32;
 	palette->finalColors16[index] = color16;
+
+	if (palette == &gGamePalette)					// every pixel may use this color
+		MarkDirtyFramebuffer();
 }
@@ -7,6 +7,8 @@
 #include "misc.h"
 #include "renderdrivers.h"
 #include "framebufferfilter.h"
+#include "profiler.h"
+#include "window.h"
 
 #if _DEBUG
 #define CHECK_SDL_ERROR(err)											\
@@ -57,6 +59,8 @@ Boolean SDLRender_Init(void)
 
 static void SDLRender_NukeTextureAndBuffers(void)
 {
+	CancelConvertFramebufferMT();		// converter threads may still be writing to gFinalFramebuffer
+
 	if (gFinalFramebuffer)
 	{
 		DisposePtr((Ptr) gFinalFramebuffer);
@@ -114,31 +118,64 @@ void SDLRender_InitTexture(void)
 	// Set logical size
 	SDL_RenderSetLogicalSize(gSDLRenderer, VISIBLE_WIDTH, VISIBLE_HEIGHT);
 
+	// New texture is blank, so the whole screen must be converted again
+	MarkDirtyFramebuffer();
+
 	// Set integer scaling setting
 #if SDL_VERSION_ATLEAST(2,0,5)
 	SDL_RenderSetIntegerScale(gSDLRenderer, crisp);
 #endif
 }
 
-void SDLRender_PresentFramebuffer(void)
+static void UpdateTextureFromConvertedRows(void)
 {
-	int err = 0;
+	uint64_t profileStart = gProfilerEnabled ? GetProfilerTime() : 0;
+	int zoom = (gEffectiveScalingType == kScaling_HQStretch) ? 2 : 1;
+	int pitch = zoom * VISIBLE_WIDTH * (int) sizeof(color_t);
+	int numRows = 0;
+
+	for (int row = GetNextConvertedRowRun(0, VISIBLE_HEIGHT, &numRows);
+		row >= 0;
+		row = GetNextConvertedRowRun(row + numRows, VISIBLE_HEIGHT, &numRows))
+	{
+		SDL_Rect rect = { 0, zoom * row, zoom * VISIBLE_WIDTH, zoom * numRows };
+		const uint8_t* pixels = (const uint8_t*) gFinalFramebuffer + rect.y * pitch;
 
-	//-------------------------------------------------------------------------
-	// Convert indexed to RGBA, with optional post-processing
+		int err = SDL_UpdateTexture(gSDLTexture, &rect, pixels, pitch);
+		CHECK_SDL_ERROR(err);
+	}
+
+	if (gProfilerEnabled)
+		RecordProfilerSpan(kProfile_Upload, kProfileThread_Main, profileStart);
+}
 
-	ConvertFramebufferMT(gFinalFramebuffer);
+void SDLRender_PresentFramebuffer(Boolean pipelined)
+{
+	int err = 0;
 
 	//-------------------------------------------------------------------------
-	// Update SDL texture
+	// Upload the previous frame if it was converted in the background
 
-	int pitch = VISIBLE_WIDTH * (int) sizeof(color_t);
+	if (FinishConvertFramebufferMT())
+	{
+		UpdateTextureFromConvertedRows();
+	}
 
-	if (gEffectiveScalingType == kScaling_HQStretch)
-		pitch *= 2;
+	//-------------------------------------------------------------------------
+	// Convert indexed to RGBA, with optional post-processing,
+	// and update SDL texture (only the rows that changed)
 
-	err = SDL_UpdateTexture(gSDLTexture, NULL, gFinalFramebuffer, pitch);
-	CHECK_SDL_ERROR(err);
+	if (!pipelined)
+	{
+		ConvertFramebufferMT(gFinalFramebuffer);
+		UpdateTextureFromConvertedRows();
+	}
+	else
+	{
+		// The texture has its own copy now, so this frame can go into gFinalFramebuffer
+		// while the GPU presents the previous one and the game draws the next one.
+		BeginConvertFramebufferMT(gFinalFramebuffer);
+	}
 
 	//-------------------------------------------------------------------------
 	// Present it
@@ -14,6 +14,8 @@
 #include "object.h"
 #include "misc.h"
 #include "shape.h"
+#include "blit.h"
+#include "assetcache.h"
 #include <string.h>
 #include "externs.h"
 
@@ -23,11 +25,14 @@
 
 static void DrawPFSprite(ObjNode *theNodePtr);
 static void ErasePFSprite(ObjNode *theNodePtr);
+static void CompileShapeSpans(long groupNum);
 
 /****************************/
 /*    CONSTANTS             */
 /****************************/
 
+#define	COMPILE_SHAPE_SPANS		1				// precompile opaque pixel runs so that sprites can be drawn without their masks
+
 /**********************/
 /*     VARIABLES      */
 /**********************/
@@ -38,6 +43,9 @@ Ptr		gSHAPE_HEADER_Ptrs[MAX_SHAPE_GROUPS][MAX_SHAPES_IN_FILE];			// holds ptr to
 
 static	short		gNumShapesInFile[MAX_SHAPE_GROUPS];
 
+static	Ptr			gShapeSpansPtr[MAX_SHAPE_GROUPS];							// span tables for every frame in group, preceded by offset to each table
+static	int32_t		gFirstFrameInShape[MAX_SHAPE_GROUPS][MAX_SHAPES_IN_FILE];	// index of shape's 1st frame in span offset list
+
 ObjNode	*gMostRecentShape = nil;
 
 
@@ -126,13 +134,16 @@ void LoadShapeTable(const char* fileName, long groupNum)
 		memset(gSHAPE_HEADER_Ptrs[groupNum], 0, sizeof(gSHAPE_HEADER_Ptrs[groupNum]));
 	}
 
-	gShapeTableHandle[groupNum] = LoadPackedFile(fileName);
+	CHECKED_DISPOSEPTR(gShapeSpansPtr[groupNum]);
+
+	Boolean isNative;
+	gShapeTableHandle[groupNum] = LoadPackedFile(fileName, &isNative);
 
 	Ptr shapeTablePtr = *gShapeTableHandle[groupNum];						// get ptr to shape table
 
-	int32_t offsetToColorTable = UnpackI32BEInPlace(shapeTablePtr);			// get Color Table offset
+	int32_t offsetToColorTable = UnpackI32InPlaceUnlessNative(shapeTablePtr, isNative);	// get Color Table offset
 
-	int16_t colorListSize = UnpackI16BEInPlace(shapeTablePtr + offsetToColorTable);	// # entries in color list
+	int16_t colorListSize = UnpackI16InPlaceUnlessNative(shapeTablePtr + offsetToColorTable, isNative);	// # entries in color list
 	GAME_ASSERT(colorListSize >= 0 && colorListSize <= 256);
 
 #if 0
@@ -170,15 +181,16 @@ void LoadShapeTable(const char* fileName, long groupNum)
 	// This is called whenever a shape table is moved in memory or loaded
 	//
 
-	int32_t offsetToShapeList = UnpackI32BEInPlace(shapeTablePtr + SF_HEADER__SHAPE_LIST);		// get ptr to offset to SHAPE_LIST
+	int32_t offsetToShapeList = UnpackI32InPlaceUnlessNative(shapeTablePtr + SF_HEADER__SHAPE_LIST, isNative);	// get ptr to offset to SHAPE_LIST
 
 	Ptr shapeList = shapeTablePtr + offsetToShapeList;				// get ptr to SHAPE_LIST
 
-	gNumShapesInFile[groupNum] = UnpackI16BEInPlace(shapeList);		// get # shapes in the file
+	gNumShapesInFile[groupNum] = UnpackI16InPlaceUnlessNative(shapeList, isNative);	// get # shapes in the file
 	shapeList += 2;
 
 	int32_t* offsetsToShapeHeaders = (int32_t*) shapeList;			// get offset to SHAPE_HEADER_n
-	UnpackIntsBE(4, gNumShapesInFile[groupNum], offsetsToShapeHeaders);
+	if (!isNative)
+		UnpackIntsBE(4, gNumShapesInFile[groupNum], offsetsToShapeHeaders);
 
 	for (int i = 0; i < gNumShapesInFile[groupNum]; i++)
 	{
@@ -186,6 +198,9 @@ void LoadShapeTable(const char* fileName, long groupNum)
 
 		gSHAPE_HEADER_Ptrs[groupNum][i] = shapeBase;	// save ptr to SHAPE_HEADER
 
+		if (isNative)									// nothing else to do for this shape
+			continue;
+
 		int32_t offsetToFrameList	= UnpackI32BEInPlace(shapeBase + 2);
 		int16_t numFrames			= UnpackI16BEInPlace(shapeBase + offsetToFrameList);
 		int32_t* offsetsToFrameData	= (int32_t*) (shapeBase + offsetToFrameList + 2);
@@ -222,6 +237,149 @@ void LoadShapeTable(const char* fileName, long groupNum)
 
 //		printf("Num Anims: %d    Num Frames: %d\n", numAnims, numFrames);
 	}
+
+	if (!isNative)
+		SaveNativeAsset(fileName, gShapeTableHandle[groupNum]);	// skip all of the above next time
+
+#if COMPILE_SHAPE_SPANS
+	CompileShapeSpans(groupNum);
+#endif
+}
+
+/************************ COMPILE FRAME SPANS *****************/
+//
+// Converts a frame's pixel/mask rectangles to a list of opaque runs per row.
+// A pixel is opaque if the mask blend always yields the source pixel, and transparent if
+// the blend always leaves the destination untouched. If any pixel is neither
+// (i.e. it would need the actual mask blend), the frame can't be compiled.
+//
+// If outTable is nil, just measures the frame.
+// Returns size of span table in bytes, or -1 if the frame can't be compiled.
+//
+
+static int32_t CompileFrameSpans(const FrameHeader* fh, const uint8_t* pixels, const uint8_t* mask, FrameSpanTable* outTable)
+{
+	int32_t		numSpans = 0;
+	FrameSpan*	spans = nil;
+
+	if (fh->width <= 0 || fh->height <= 0)
+		return -1;
+
+	if (outTable)
+	{
+		outTable->numRows = fh->height;
+		spans = (FrameSpan*) GetFrameSpans(outTable);
+	}
+
+	for (int row = 0; row < fh->height; row++)
+	{
+		if (outTable)
+			outTable->rowSpans[row] = numSpans;
+
+		int x = 0;
+		while (x < fh->width)
+		{
+			while (x < fh->width && mask[x] == 0xFF && pixels[x] == 0x00)		// skip transparent pixels
+				x++;
+
+			int start = x;
+			while (x < fh->width && (mask[x] & ~pixels[x]) == 0)				// gather opaque pixels
+				x++;
+
+			if (x > start)
+			{
+				if (spans)
+					spans[numSpans] = (FrameSpan) { .x = start, .length = x - start };
+				numSpans++;
+			}
+			else if (x < fh->width)												// neither opaque nor transparent
+				return -1;
+		}
+
+		pixels += fh->width;
+		mask += fh->width;
+	}
+
+	if (outTable)
+		outTable->rowSpans[fh->height] = numSpans;
+
+	return (int32_t) (sizeof(FrameSpanTable) + (fh->height + 1) * sizeof(int32_t) + numSpans * sizeof(FrameSpan));
+}
+
+/************************ COMPILE SHAPE SPANS *****************/
+//
+// Builds span tables for every frame in a shape group.
+// Layout: int32 offset to each frame's table (-1 if not compiled), then the tables themselves.
+//
+
+static void CompileShapeSpans(long groupNum)
+{
+	int32_t	numFramesInGroup = 0;
+	int32_t	tableBytes = 0;
+
+	GAME_ASSERT(gShapeSpansPtr[groupNum] == nil);
+
+				/* PASS 1: MEASURE */
+
+	for (int i = 0; i < gNumShapesInFile[groupNum]; i++)
+	{
+		const uint8_t* shapePtr = (const uint8_t*) gSHAPE_HEADER_Ptrs[groupNum][i];
+		const FrameList* fl = (const FrameList*) (shapePtr + *(const int32_t*) (shapePtr + 2));
+
+		gFirstFrameInShape[groupNum][i] = numFramesInGroup;
+
+		for (int f = 0; f < fl->numFrames; f++)
+		{
+			const uint8_t*	pixels;
+			const uint8_t*	mask;
+			const FrameHeader* fh = GetFrameHeader(groupNum, i, f, &pixels, &mask);
+
+			int32_t size = CompileFrameSpans(fh, pixels, mask, nil);
+			if (size > 0)
+				tableBytes += size;
+			numFramesInGroup++;
+		}
+	}
+
+	if (numFramesInGroup == 0)
+		return;
+
+				/* PASS 2: BUILD */
+
+	int32_t offset = numFramesInGroup * (int32_t) sizeof(int32_t);
+
+	gShapeSpansPtr[groupNum] = NewPtr(offset + tableBytes);
+	GAME_ASSERT(gShapeSpansPtr[groupNum]);
+
+	int32_t* offsets = (int32_t*) gShapeSpansPtr[groupNum];
+
+	for (int i = 0; i < gNumShapesInFile[groupNum]; i++)
+	{
+		const uint8_t* shapePtr = (const uint8_t*) gSHAPE_HEADER_Ptrs[groupNum][i];
+		const FrameList* fl = (const FrameList*) (shapePtr + *(const int32_t*) (shapePtr + 2));
+
+		for (int f = 0; f < fl->numFrames; f++)
+		{
+			const uint8_t*	pixels;
+			const uint8_t*	mask;
+			const FrameHeader* fh = GetFrameHeader(groupNum, i, f, &pixels, &mask);
+
+			FrameSpanTable* table = (FrameSpanTable*) (gShapeSpansPtr[groupNum] + offset);
+			int32_t size = CompileFrameSpans(fh, pixels, mask, table);
+
+			if (size > 0)
+			{
+				*offsets++ = offset;
+				offset += size;
+			}
+			else
+			{
+				*offsets++ = -1;
+			}
+		}
+	}
+
+	GAME_ASSERT(offset == numFramesInGroup * (int32_t) sizeof(int32_t) + tableBytes);
 }
 
 /************************ GET FRAME HEADER ********************/
@@ -274,6 +432,61 @@ const FrameHeader* GetFrameHeader(
 	return fh;
 }
 
+/************************ GET FRAME SPAN TABLE ********************/
+//
+// Returns the span-compiled form of a frame, or nil if that frame
+// must be drawn with its mask.
+//
+
+const FrameSpanTable* GetFrameSpanTable(long groupNum, long shapeNum, long frameNum)
+{
+	GAME_ASSERT_MESSAGE(groupNum < MAX_SHAPE_GROUPS, "Illegal Group #");
+	GAME_ASSERT_MESSAGE(shapeNum < gNumShapesInFile[groupNum], "Illegal Shape #");
+
+	if (!gShapeSpansPtr[groupNum])
+		return nil;
+
+	const int32_t* offsets = (const int32_t*) gShapeSpansPtr[groupNum];
+	int32_t offset = offsets[gFirstFrameInShape[groupNum][shapeNum] + frameNum];
+
+	if (offset < 0)
+		return nil;
+
+	return (const FrameSpanTable*) (gShapeSpansPtr[groupNum] + offset);
+}
+
+/************************ DRAW SPAN ROW ********************/
+//
+// Copies the opaque runs of one sprite row that fall within columns [clipLeft, clipRight).
+// destPtr is where column clipLeft goes; srcRow is the start of the sprite row.
+//
+
+static inline void DrawSpanRow(
+		uint8_t* destPtr,
+		const uint8_t* srcRow,
+		const FrameSpanTable* table,
+		int row,
+		int clipLeft,
+		int clipRight)
+{
+	const FrameSpan* span		= GetFrameSpans(table) + table->rowSpans[row];
+	const FrameSpan* spanEnd	= GetFrameSpans(table) + table->rowSpans[row+1];
+
+	for ( ; span < spanEnd; span++)
+	{
+		int left = span->x;
+		int right = left + span->length;
+
+		if (left < clipLeft)
+			left = clipLeft;
+		if (right > clipRight)
+			right = clipRight;
+
+		if (left < right)
+			memcpy(destPtr + left - clipLeft, srcRow + left, right - left);
+	}
+}
+
 /************************ DRAW FRAME TO GENERIC BUFFER ********************/
 
 static void DrawFrameToBuffer(
@@ -301,6 +514,8 @@ static void DrawFrameToBuffer(
 			mask? &maskData: nil
 	);
 
+	const FrameSpanTable* spanTable = mask? GetFrameSpanTable(groupNum, shapeNum, frameNum): nil;
+
 	x += fh->x;										// use position offsets
 	y += fh->y;
 
@@ -313,6 +528,9 @@ static void DrawFrameToBuffer(
 
 	uint8_t* destPtr = destBuffer + y*destBufferWidth + x;
 
+	if (destBuffer == gIndexedFramebuffer)
+		MarkDirtyFramebufferRows(y, fh->height);
+
 						/* DO THE DRAW */
 
 	if (!mask)
@@ -325,6 +543,16 @@ static void DrawFrameToBuffer(
 			pixelData += fh->width;
 		}
 	}
+	else if (spanTable)
+	{
+		for (int row = 0; row < fh->height; row++)
+		{
+			DrawSpanRow(destPtr, pixelData, spanTable, row, 0, fh->width);
+
+			destPtr += destBufferWidth;				// next row
+			pixelData += fh->width;
+		}
+	}
 	else
 	{
 		const uint8_t* srcPtr	= pixelData;
@@ -332,17 +560,11 @@ static void DrawFrameToBuffer(
 
 		for (int row = fh->height; row; row--)
 		{
-			uint8_t* destPtr2 = destPtr;			// get line start ptr
-
-			for (int col = fh->width; col; col--)
-			{
-				*destPtr2 = (*destPtr2 & *maskPtr) | (*srcPtr);
-				destPtr2++;
-				maskPtr++;
-				srcPtr++;
-			}
+			BlitMaskedRow(destPtr, srcPtr, maskPtr, fh->width);
 
 			destPtr += destBufferWidth;			// next row
+			maskPtr += fh->width;
+			srcPtr += fh->width;
 		}
 	}
 }
@@ -434,6 +656,7 @@ long	i,i2;
 		{
 			DisposeHandle(gShapeTableHandle[i]);
 			gShapeTableHandle[i] = nil;
+			CHECKED_DISPOSEPTR(gShapeSpansPtr[i]);		// spans describe the frames of that table
 
 			// Clear pointers to shapes so the game will segfault if inadvertantly reusing zombie shapes
 			memset(gSHAPE_HEADER_Ptrs[i], 0, sizeof(gSHAPE_HEADER_Ptrs[i]));
@@ -481,7 +704,6 @@ int32_t	frameNum;
 int32_t	x,y,offset;
 Rect	oldBox;
 int32_t	shapeNum,groupNum;
-uint8_t*		destPtr;
 uint8_t*		destStartPtr;
 const uint8_t*	maskPtr;
 const uint8_t*	srcPtr;
@@ -508,6 +730,9 @@ const uint8_t*	srcPtr;
 			&maskPtr
 	);
 
+	const FrameSpanTable* spanTable = GetFrameSpanTable(groupNum, shapeNum, frameNum);
+	int32_t firstRow = 0;
+
 	width = fh->width;								// get width
 	height = fh->height;							// get height
 
@@ -535,6 +760,7 @@ const uint8_t*	srcPtr;
 		height -= offset;
 		srcPtr += offset*width;
 		maskPtr += offset*width;
+		firstRow = offset;
 	}
 
 	if (theNodePtr->UpdateBoxFlag)						// see if using update regions
@@ -551,20 +777,27 @@ const uint8_t*	srcPtr;
 	if (height <= 0)										// special check for illegal heights
 		height = 1;
 
-	do
+	if (spanTable && firstRow + height <= spanTable->numRows)	// draw opaque runs only
 	{
-		destPtr = destStartPtr;								// get line start ptr
-
-		for (int i = width; i; i--)
+		for (int row = firstRow; row < firstRow + height; row++)
 		{
-			*destPtr = (*destPtr & *maskPtr) | (*srcPtr);
-			destPtr++;
-			srcPtr++;
-			maskPtr++;
+			DrawSpanRow(destStartPtr, srcPtr, spanTable, row, 0, width);
+
+			srcPtr += width;
+			destStartPtr += OFFSCREEN_WIDTH;				// next row
 		}
+	}
+	else
+	{
+		do
+		{
+			BlitMaskedRow(destStartPtr, srcPtr, maskPtr, width);
 
-		destStartPtr += OFFSCREEN_WIDTH;					// next row
-	} while(--height);
+			srcPtr += width;
+			maskPtr += width;
+			destStartPtr += OFFSCREEN_WIDTH;				// next row
+		} while(--height);
+	}
 
 
 					/* MAKE AN UPDATE REGION */
@@ -644,6 +877,7 @@ const uint8_t*		originalMaskStartPtr;
 long	frameNum;
 long	realWidth,originalY,topToClip,leftToClip;
 long	drawWidth,shapeNum,groupNum,numHSegs;
+long	firstCol;
 Boolean	priorityFlag;
 int32_t	x, y;
 
@@ -665,6 +899,8 @@ int32_t	x, y;
 			(const uint8_t**) &maskStartPtr
 	);
 
+	const FrameSpanTable* spanTable = GetFrameSpanTable(groupNum, shapeNum, frameNum);
+
 	drawWidth = realWidth = width = fh->width;		// get pixel width
 	height = fh->height;							// get height
 	x += fh->x;										// use position offsets (still global coords)
@@ -732,6 +968,8 @@ int32_t	x, y;
 	theNodePtr->drawBox.right = width;							// right actually = width
 	theNodePtr->drawBox.bottom = height;
 
+	MarkPlayfieldSpriteCells(x, y, width, height);				// tile dither strides don't apply there anymore
+
 	if ((x+width) > PF_BUFFER_WIDTH)							// check horiz buffer clipping
 	{
 		width -= ((x+width)-PF_BUFFER_WIDTH);
@@ -740,6 +978,7 @@ int32_t	x, y;
 	else
 		numHSegs = 1;
 
+	firstCol = leftToClip;										// 1st sprite column to draw in current segment
 	leftToClip += (topToClip*realWidth);
 	srcStartPtr += leftToClip;
 	maskStartPtr += leftToClip;
@@ -751,22 +990,19 @@ int32_t	x, y;
 						/* DO THE DRAW */
 
 
+	if (spanTable && topToClip + height > spanTable->numRows)
+		spanTable = nil;
+
 	if (!priorityFlag)
 	{
 		for (; numHSegs > 0; numHSegs--)
 		{
 			for (int drawHeight = 0; drawHeight < height; drawHeight++)
 			{
-				uint8_t*		destPtr		= destStartPtr;		// get line start ptr
-				const uint8_t*	srcPtr		= srcStartPtr;
-				const uint8_t*	maskPtr		= maskStartPtr;
-				for (int i = width; i; i--)
-				{
-					*destPtr = (*destPtr & *maskPtr) | *srcPtr;
-					destPtr++;
-					maskPtr++;
-					srcPtr++;
-				}
+				if (spanTable)									// draw opaque runs only
+					DrawSpanRow(destStartPtr, srcStartPtr - firstCol, spanTable, topToClip + drawHeight, firstCol, firstCol + width);
+				else
+					BlitMaskedRow(destStartPtr, srcStartPtr, maskStartPtr, width);
 
 				srcStartPtr += realWidth;						// next sprite line
 				maskStartPtr += realWidth;						// next mask line
@@ -786,6 +1022,7 @@ int32_t	x, y;
 				x = 0;
 				srcStartPtr = originalSrcStartPtr+width;
 				maskStartPtr = originalMaskStartPtr+width;
+				firstCol += width;
 				width = drawWidth-width;
 			}
 		}
@@ -802,20 +1039,7 @@ int32_t	x, y;
 		{
 			for (int drawHeight = 0; drawHeight < height; drawHeight++)
 			{
-				uint8_t* destPtr			= destStartPtr;		// get line start ptr
-				const uint8_t* srcPtr		= srcStartPtr;
-				const uint8_t* maskPtr		= maskStartPtr;
-				const uint8_t* tileMaskPtr	= tileMaskStartPtr;
-
-				for (int i = width; i; i--)						// draw remaining pixels
-				{
-					*destPtr =  (*destPtr & (*maskPtr | *tileMaskPtr)) |
-								 (*srcPtr & (*tileMaskPtr ^ 0xff));
-					destPtr++;
-					maskPtr++;
-					srcPtr++;
-					tileMaskPtr++;
-				}
+				BlitMaskedRowTileMask(destStartPtr, srcStartPtr, maskStartPtr, tileMaskStartPtr, width);
 
 				srcStartPtr += realWidth;						// next sprite line
 				maskStartPtr += realWidth;						// next mask line
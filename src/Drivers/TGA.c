@@ -2,37 +2,21 @@
 // (C) 2020 Iliyas Jorio
 // This file is part of Bugdom. https://github.com/jorio/bugdom
 
+#include <string.h>
 #include "tga.h"
 #include "misc.h"
 #include "externs.h"
 #include "myglobals.h"
 
-static void DecompressRLE(short refNum, TGAHeader* header, Handle handle)
+// Source port note: decompresses straight from the mapped file (see MapMikeFile)
+// instead of reading the rest of the file into a temporary buffer first.
+static void DecompressRLE(const uint8_t* compressedData, long compressedLength, TGAHeader* header, Handle handle)
 {
-	OSErr err = noErr;
-
-	// Get number of bytes until EOF
-	long pos = 0;
-	long eof = 0;
-	long compressedLength = 0;
-	GetFPos(refNum, &pos);
-	GetEOF(refNum, &eof);
-	compressedLength = eof - pos;
-
-	// Prep compressed data buffer
-	Ptr compressedData = NewPtr(compressedLength);
-
-	// Read rest of file into compressed data buffer
-	err = FSRead(refNum, &compressedLength, compressedData);
-
-	GAME_ASSERT(err == noErr);
-	GAME_ASSERT(compressedLength == eof-pos);	// Ensure we got as many bytes as we asked for
-
 	const long bytesPerPixel	= header->bpp / 8;
 	const long pixelCount		= header->width * header->height;
 	long pixelsProcessed		= 0;
 
-	const uint8_t*			in  = (uint8_t*) compressedData;
+	const uint8_t*			in  = compressedData;
 	uint8_t*				out = (uint8_t*) *handle;
 	const uint8_t* const	eod = in + compressedLength;
 
@@ -66,8 +50,6 @@ static void DecompressRLE(short refNum, TGAHeader* header, Handle handle)
 			pixelsProcessed += packetLength;
 		}
 	}
-
-	DisposePtr(compressedData);
 }
 
 static void FlipPixelData(Handle handle, TGAHeader* header)
@@ -94,27 +76,25 @@ Handle LoadTGA(
 		int* outWidth,
 		int* outHeight)
 {
-	short		refNum;
-	OSErr		err;
-	long		readCount;
+	MappedFile	file;
 	TGAHeader	header;
 	Handle		pixelDataHandle;
 
-	// Open data fork
-	FSSpec spec;
-	FSMakeFSSpec(gDataSpec.vRefNum, gDataSpec.parID, path, &spec);
-	err = FSpOpenDF(&spec, fsRdPerm, &refNum);
-	if (err != noErr)
+	// Map the whole file -- we only read from it
+	if (!MapMikeFile(path, &file))
 		return nil;
 
+	const uint8_t*			in  = file.data;
+	const uint8_t* const	eof = file.data + file.size;
+
 	// Read header
-	readCount = sizeof(TGAHeader);
-	err = FSRead(refNum, &readCount, (Ptr) &header);
-	if (err != noErr || readCount != sizeof(TGAHeader))
+	if (file.size < (long) sizeof(TGAHeader))
 	{
-		FSClose(refNum);
+		UnmapMikeFile(&file);
 		return nil;
 	}
+	memcpy(&header, in, sizeof(TGAHeader));
+	in += sizeof(TGAHeader);
 
 	// Byteswap the header (effective for big-endian systems only,
 	// it's a no-op on little-endian machines)
@@ -127,7 +107,7 @@ Handle LoadTGA(
 		case TGA_IMAGETYPE_RLE_CMAP:
 			break;
 		default:
-			FSClose(refNum);
+			UnmapMikeFile(&file);
 			DoFatalAlert2("TGA files must be colormapped!", path);
 			return nil;
 	}
@@ -150,17 +130,11 @@ Handle LoadTGA(
 		GAME_ASSERT(header.paletteOriginLo == 0 && header.paletteOriginHi == 0);
 		GAME_ASSERT(paletteColorCount <= 256);
 
-		if (!loadPalette)
-		{
-			SetFPos(refNum, fsFromMark, paletteBytes);
-		}
-		else
-		{
-			Ptr palette = NewPtr(paletteBytes);
+		GAME_ASSERT(in + paletteBytes <= eof);
 
-			readCount = paletteBytes;
-			FSRead(refNum, &readCount, palette);
-			GAME_ASSERT(readCount == paletteBytes);
+		if (loadPalette)
+		{
+			const uint8_t* palette = in;
 
 			for (int i = 0; i < paletteColorCount; i++)
 			{
@@ -176,9 +150,9 @@ Handle LoadTGA(
 				RGBColor rgbColor = U32ToRGBColor(combined);
 				SetPaletteColor(&gGamePalette, i, &rgbColor);
 			}
-
-			DisposePtr(palette);
 		}
+
+		in += paletteBytes;
 	}
 
 	// Allocate pixel data
@@ -187,19 +161,17 @@ Handle LoadTGA(
 	// Read pixel data; decompress it if needed
 	if (compressed)
 	{
-		DecompressRLE(refNum, &header, pixelDataHandle);
+		DecompressRLE(in, eof - in, &header, pixelDataHandle);
 		header.imageType &= ~8;		// flip compressed bit
 	}
 	else
 	{
-		readCount = pixelDataLength;
-		err = FSRead(refNum, &readCount, *pixelDataHandle);
-		GAME_ASSERT(readCount == pixelDataLength);
-		GAME_ASSERT(err == noErr);
+		GAME_ASSERT(in + pixelDataLength <= eof);
+		memcpy(*pixelDataHandle, in, pixelDataLength);
 	}
 
-	// Close file -- we don't need it anymore
-	FSClose(refNum);
+	// Unmap file -- we don't need it anymore
+	UnmapMikeFile(&file);
 
 	// If pixel data is stored bottom-up, flip it vertically.
 	if (needFlip)
@@ -50,7 +50,7 @@ register	ObjNode		*newObj;
 		return(false);
 
 	newObj->ItemIndex = itemPtr;				// remember where this came from
-	newObj->CType = CTYPE_ENEMYA;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = x8BALL_HEALTH;				// set health
 	newObj->TopOff = -16;						// set box
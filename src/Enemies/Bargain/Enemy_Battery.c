@@ -67,7 +67,7 @@ static	long dyList[] = {-BATTERY_SPEED,-BATTERY_SPEED,0,BATTERY_SPEED,
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_ENEMYA;					// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);			// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = BATTERY_HEALTH;				// set health
 
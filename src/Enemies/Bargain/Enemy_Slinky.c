@@ -61,7 +61,7 @@ short			animNum;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_ENEMYA;					// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);			// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = SLINKY_HEALTH;					// set health
 
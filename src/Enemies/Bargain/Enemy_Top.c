@@ -54,7 +54,7 @@ register	ObjNode		*newObj;
 	CalcEnemyScatterOffset(newObj);
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
-	newObj->CType = CTYPE_ENEMYA;					// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);			// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = TOP_HEALTH;					// set health
 	newObj->TopOff = -22;							// set box
@@ -468,7 +468,7 @@ const TileAttribType	*newTile;
 
 	newObj->ItemIndex = itemPtr;							// remember where this came from
 
-	newObj->CType = CTYPE_ENEMYC;
+	SetObjectCType(newObj, CTYPE_ENEMYC);
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -8;									// set box
@@ -82,7 +82,7 @@ short		anim;
 			return(false);
 
 		newObj->ItemIndex = itemPtr;				// remember where this came from
-		newObj->CType = 0;							// set collision info
+		SetObjectCType(newObj, 0);					// set collision info
 		newObj->CBits = CBITS_TOUCHABLE;
 		newObj->Health = CARMEL_HEALTH;				// set health
 		newObj->TopOff = -30;						// set box
@@ -113,7 +113,7 @@ short		anim;
 			return(false);
 
 		newObj->ItemIndex = itemPtr;				// remember where this came from
-		newObj->CType = 0;							// set collision info
+		SetObjectCType(newObj, 0);					// set collision info
 		newObj->CBits = CBITS_TOUCHABLE;
 		newObj->Health = CARMEL_HEALTH;				// set health
 		newObj->TopOff = -30;						// set box
@@ -183,7 +183,7 @@ void MoveCarmel_Appear(void)
 			gThisNodePtr->DrawFlag =
 			gThisNodePtr->EraseFlag =
 			gThisNodePtr->AnimFlag = true;
-			gThisNodePtr->CType = CTYPE_ENEMYA;
+			SetObjectCType(gThisNodePtr, CTYPE_ENEMYA);
 		}
 	}
 }
@@ -263,7 +263,7 @@ ObjNode	*newObj;
 			gThisNodePtr->DrawFlag =
 			gThisNodePtr->EraseFlag =
 			gThisNodePtr->AnimFlag = true;
-			gThisNodePtr->CType = CTYPE_ENEMYA;
+			SetObjectCType(gThisNodePtr, CTYPE_ENEMYA);
 		}
 	}
 	else
@@ -278,7 +278,7 @@ ObjNode	*newObj;
 								gThisNodePtr->Z,MoveCarmelDrop,PLAYFIELD_RELATIVE);
 			if (newObj != nil)
 			{
-				newObj->CType = CTYPE_ENEMYB;				// set collision info
+				SetObjectCType(newObj, CTYPE_ENEMYB);		// set collision info
 				newObj->CBits = CBITS_TOUCHABLE;
 				newObj->TopOff = -8;						// set box
 				newObj->BottomOff = 0;
@@ -66,7 +66,7 @@ register	ObjNode		*newObj;
 		return(false);
 
 	newObj->ItemIndex = itemPtr;				// remember where this came from
-	newObj->CType = CTYPE_ENEMYA;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = GBREAD_HEALTH;				// set health
 	newObj->TopOff = -22;						// set box
@@ -279,7 +279,7 @@ long		dx;
 	newObj->DX = dx;
 	newObj->DY = (long)(gMyY - gY.Int) * 3000L;
 
-	newObj->CType = CTYPE_ENEMYB;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYB);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->TopOff = -8;						// set box
 	newObj->BottomOff = 0;
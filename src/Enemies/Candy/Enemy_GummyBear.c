@@ -65,7 +65,7 @@ register	ObjNode		*newObj;
 		return(false);
 
 	newObj->ItemIndex = itemPtr;				// remember where this came from
-	newObj->CType = CTYPE_ENEMYA;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = GBEAR_HEALTH;				// set health
 	newObj->TopOff = -25;						// set box
@@ -203,7 +203,7 @@ short			i;
 		if (newObj == nil)
 			return;
 
-		newObj->CType = CTYPE_ENEMYA;				// set collision info
+		SetObjectCType(newObj, CTYPE_ENEMYA);		// set collision info
 		newObj->CBits = CBITS_TOUCHABLE;
 		newObj->Health = 1;							// set health
 		newObj->TopOff = -10;						// set box
@@ -55,7 +55,7 @@ register	ObjNode		*newObj;
 		return(false);
 
 	newObj->ItemIndex = itemPtr;				// remember where this came from
-	newObj->CType = CTYPE_ENEMYA;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->TopOff = -8;						// set box
 	newObj->BottomOff = 0;
@@ -141,7 +141,7 @@ register	ObjNode	*newObj;
 		if (newObj == nil)
 			return;
 
-		newObj->CType = CTYPE_ENEMYB;				// set collision info
+		SetObjectCType(newObj, CTYPE_ENEMYB);		// set collision info
 		newObj->CBits = CBITS_TOUCHABLE;
 		newObj->TopOff = -8;						// set box
 		newObj->BottomOff = 0;
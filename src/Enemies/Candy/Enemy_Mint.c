@@ -49,7 +49,7 @@ register	ObjNode		*newObj;
 		return(false);
 
 	newObj->ItemIndex = itemPtr;				// remember where this came from
-	newObj->CType = CTYPE_ENEMYA;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = MINT_HEALTH;				// set health
 	newObj->TopOff = -8;						// set box
@@ -79,7 +79,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_ENEMYA;		// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);	// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TopOff = -10;							// set box
@@ -206,7 +206,7 @@ register	ObjNode		*newObj;
 	if (newObj == nil)
 		return;
 
-	newObj->CType = CTYPE_ENEMYA;					// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);			// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -8;							// set box
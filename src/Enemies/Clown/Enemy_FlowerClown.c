@@ -68,7 +68,7 @@ register	ObjNode		*newObj;
 		return(false);
 
 	newObj->ItemIndex = itemPtr;				// remember where this came from
-	newObj->CType = CTYPE_ENEMYA;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = FLOWERCLOWN_HEALTH;		// set health
 	newObj->TopOff = -22;						// set box
@@ -285,7 +285,7 @@ long		dx;
 	newObj->DX = dx;
 	newObj->DY = (long)(gMyY - gY.Int) * 3000L;
 
-	newObj->CType = CTYPE_ENEMYB;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYB);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->TopOff = -15;						// set box
 	newObj->BottomOff = 0;
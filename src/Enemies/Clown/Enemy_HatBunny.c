@@ -62,7 +62,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_MISC;						// set collision info
+	SetObjectCType(newObj, CTYPE_MISC);				// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TopOff = -16;							// set box
@@ -130,7 +130,7 @@ register	ObjNode		*newObj;
 
 	CalcEnemyScatterOffset(newObj);
 
-	newObj->CType = CTYPE_ENEMYA;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);		// set collision info
 	newObj->CBits = 0;
 //	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = HATBUNNY_HEALTH;			// set health
@@ -62,7 +62,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_ENEMYA;					// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);			// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = GIANT_HEALTH;				// set health
 
@@ -176,12 +176,12 @@ long		ctype;
 
 	if (theNode->YOffset.Int >= -40)				// see if close enough for collision
 	{
-		theNode->CType = CTYPE_ENEMYA;
+		SetObjectCType(theNode, CTYPE_ENEMYA);
 		ctype = FULL_ENEMY_COLLISION;
 	}
 	else
 	{
-		theNode->CType = 0;
+		SetObjectCType(theNode, 0);
 		ctype = ENEMY_NO_BULLET_COLLISION;
 	}
 
@@ -247,7 +247,7 @@ static	float	cosTbl[16] =	{-1,-0.92387,-0.7071,-0.38268,
 		if (newNode == nil)
 			return;
 
-		newNode->CType = CTYPE_ENEMYC;
+		SetObjectCType(newNode, CTYPE_ENEMYC);
 		newNode->CBits = CBITS_TOUCHABLE;
 
 		newNode->TopOff = -10;						// set collision box
@@ -58,7 +58,7 @@ register	ObjNode		*newObj;
 
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = SPIDER_HEALTH;					// set health
-	newObj->CType = CTYPE_ENEMYA;					// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);			// set collision info
 
 	newObj->TopOff = -20;							// set box
 	newObj->BottomOff = 0;
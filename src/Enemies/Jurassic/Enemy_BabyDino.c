@@ -60,7 +60,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_ENEMYA;					// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);			// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = BABYDINO_HEALTH;				// set health
 
@@ -180,12 +180,12 @@ long		ctype;
 
 	if (theNode->YOffset.Int >= -40)				// see if close enough for collision
 	{
-		theNode->CType = CTYPE_ENEMYA;
+		SetObjectCType(theNode, CTYPE_ENEMYA);
 		ctype = FULL_ENEMY_COLLISION;
 	}
 	else
 	{
-		theNode->CType = 0;
+		SetObjectCType(theNode, 0);
 		ctype = ENEMY_NO_BULLET_COLLISION;
 	}
 
@@ -135,7 +135,7 @@ Byte		animNum;
 				/* SET STANDARD STUFF */
 
 	newObj->ItemIndex = itemPtr;				// remember where this came from
-	newObj->CType = CTYPE_ENEMYA;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = CAVEMAN_HEALTH;			// set health
 	newObj->TopOff = -22;						// set box
@@ -401,7 +401,7 @@ long		dx;
 
 	newObj->DX = dx + ((RandomRange(0,10000) << 3) - 40000L);
 
-	newObj->CType = CTYPE_ENEMYC;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYC);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->TopOff = -14;						// set box
 	newObj->BottomOff = 0;
@@ -488,7 +488,7 @@ unsigned short	bits;
 	newObj->DX = dx + ((MyRandomLong()&0x7f) - 0x40);
 	newObj->DY = (long)(gMyY - gY.Int + fudgeX) * 3000L;
 
-	newObj->CType = CTYPE_ENEMYB;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYB);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->TopOff = -25;						// set box
 	newObj->BottomOff = 0;
@@ -66,7 +66,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_MISC;						// set collision info
+	SetObjectCType(newObj, CTYPE_MISC);				// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TopOff = -14;						// set box
@@ -141,7 +141,7 @@ register	ObjNode		*newObj;
 	if (newObj == nil)
 		return;
 
-	newObj->CType = CTYPE_ENEMYA;				// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYA);		// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 	newObj->Health = HATCHLING_HEALTH;			// set health
 	newObj->TopOff = -8;						// set box
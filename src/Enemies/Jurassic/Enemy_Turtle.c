@@ -57,7 +57,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_MISC;						// set collision info
+	SetObjectCType(newObj, CTYPE_MISC);				// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TopOff = -35;							// set box
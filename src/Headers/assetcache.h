@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string.h>
+
+Boolean	LoadNativeAsset(const char* fileName, long sourceSize, long unpackedSize, int32_t packType, Handle dataHand);
+void	SaveNativeAsset(const char* fileName, Handle dataHand);
+
+// Reads a big-endian field of a freshly unpacked file and byteswaps it in place.
+// If the file came from the native asset cache, it's already byteswapped: just read it.
+
+static inline int32_t UnpackI32InPlaceUnlessNative(Ptr p, Boolean isNative)
+{
+	if (!isNative)
+		return UnpackI32BEInPlace(p);
+	int32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline int16_t UnpackI16InPlaceUnlessNative(Ptr p, Boolean isNative)
+{
+	if (!isNative)
+		return UnpackI16BEInPlace(p);
+	int16_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
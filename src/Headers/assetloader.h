@@ -0,0 +1,8 @@
+#pragma once
+
+void	PrefetchPackedFile(const char* fileName);
+Boolean	IsPrefetchPending(const char* fileName);
+void	WaitForPrefetchProgress(int timeoutMS);
+Handle	TakePrefetchedFile(const char* fileName, Boolean* outIsNative);
+void	FlushPrefetchedFiles(void);
+void	ShutdownAssetLoader(void);
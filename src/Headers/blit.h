@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+// Masked sprite row: dest = (dest & mask) | src
+typedef void (*BlitMaskedRowFunc)(uint8_t* dest, const uint8_t* src, const uint8_t* mask, int width);
+
+// Masked sprite row behind priority tiles: dest = (dest & (mask | tileMask)) | (src & ~tileMask)
+typedef void (*BlitMaskedRowTileMaskFunc)(uint8_t* dest, const uint8_t* src, const uint8_t* mask, const uint8_t* tileMask, int width);
+
+extern BlitMaskedRowFunc			BlitMaskedRow;
+extern BlitMaskedRowTileMaskFunc	BlitMaskedRowTileMask;
+extern const char*					gBlitterName;
+
+void InitBlitters(void);
+
+#if _DEBUG
+void BenchmarkBlitters(void);
+#endif
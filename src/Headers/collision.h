@@ -9,4 +9,7 @@ Byte	HandleCollisions(unsigned long);
 void	DoSimpleCollision(unsigned long);
 Boolean	DoPointCollision(unsigned short, unsigned short, unsigned long);
 void	AddBGCollisions(ObjNode *);
+void	ResetCollisionGrid(void);
+void	UpdateObjectCollisionCell(ObjNode *);
+void	RemoveObjectCollisionCell(ObjNode *);
 
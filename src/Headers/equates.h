@@ -80,6 +80,8 @@ enum
 	CTYPE_HURTENEMY = 	(1L<<14)		// &0100000000000000	Misc hurt Enemy item
 };
 
+#define	NUM_CTYPE_BITS	15				// # of CTYPE bits above, one object list per bit
+
 #define INVALID_NODE_FLAG 0xffffffffL	// put into CType when node is deleted
 
 
@@ -53,6 +53,7 @@ extern SDL_GameController*		gSDLController;
 extern	short					gHtab;
 extern	short					gVtab;
 extern	short					gDemoMode;
+extern	Byte					gDemoDifficulty;
 extern	Boolean					gAbortDemoFlag;
 extern	Boolean					gGameIsDemoFlag;
 
@@ -88,6 +89,7 @@ extern	Boolean					gIsInGame;
 extern	struct SDL_Window		*gSDLWindow;
 extern	FSSpec					gDataSpec;
 extern	int						gNumThreads;
+extern	Boolean					gHeadless;
 
 #pragma mark - MyGuy
 
@@ -229,5 +231,10 @@ extern	Handle					gBackgroundHandle;
 extern	Handle					gOffScreenHandle;
 extern	Handle					gPFBufferHandle;
 extern	uint8_t					*gRowDitherStrides;			// for dithering filter
+extern	uint8_t					*gDirtyFramebufferRows;		// VISIBLE_HEIGHT elements
+extern	int						gNumDirtyFramebufferRows;
+extern	uint8_t					*gPlayfieldFramebufferRows;	// VISIBLE_HEIGHT elements
+extern	int16_t					*gPFTileCells;				// PF_TILE_HEIGHT*PF_TILE_WIDTH elements
+extern	uint8_t					*gPFSpriteCells;			// PF_TILE_HEIGHT*PF_TILE_WIDTH elements
 extern	const char				*gRendererName;
 extern	Boolean					gCanDoHQStretch;
@@ -20,9 +20,28 @@
 	_Static_assert(false, "unsupported framebuffer color depth!");
 #endif
 
+// Smear flags of one row of a 32x32 tile, for the pixels whose flags don't depend on the tile's surroundings
+typedef struct
+{
+	uint32_t	known;		// bit x set if pixel x's flag is known
+	uint32_t	smear;		// bit x set if pixel x gets smeared
+} TileDitherRow;
+
+void FindTileDitherStrides(const uint8_t* tilePixels, TileDitherRow* rows);
+
+void PrepareColorConversion(const uint8_t* indexedFramebuffer);
 void IndexedFramebufferToColor_NoFilter(color_t* color, int firstRow, int numRows);
 void IndexedFramebufferToColor_FilterDithering(color_t* color, int threadNum, int firstRow, int numRows);
 void DoublePixels(const color_t* colorx1, color_t* colorx2, int firstRow, int numRows);
 
 void ConvertFramebufferMT(color_t* colorBuffer);
+void BeginConvertFramebufferMT(color_t* colorBuffer);
+Boolean FinishConvertFramebufferMT(void);
+void CancelConvertFramebufferMT(void);
+int GetNextConvertedRowRun(int fromRow, int endRow, int* outNumRows);
 void ShutdownRenderThreads(void);
+
+#if _DEBUG
+void BenchmarkColorConversion(void);
+void ReportRenderThreadStats(void);
+#endif
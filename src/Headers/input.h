@@ -4,6 +4,14 @@
 
 #include <SDL.h>
 
+typedef struct
+{
+	uint32_t	needsActive;			// bit N: GetNeedState(N)
+	uint32_t	needsChanged;			// bit N: need N was pressed or released this tick
+	int32_t		leftStickMagnitude;
+	short		rightStickAim;
+} InputSnapshot;
+
 void InitInput(void);
 void UpdateInput(void);
 void ClearInput(void);
@@ -18,3 +26,5 @@ bool GetNeedState(int needID);
 SDL_GameController* TryOpenController(bool showMessage);
 int32_t GetLeftStickMagnitude_Fix32(void);
 short GetRightStick8WayAim(void);
+void GetInputSnapshot(InputSnapshot* snapshot);
+void ApplyInputSnapshot(const InputSnapshot* snapshot);
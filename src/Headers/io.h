@@ -15,6 +15,10 @@ enum
 void	StartRecordingDemo(void);
 void	SaveDemoData(void);
 void	InitDemoPlayback(void);
+void	QueueDemoPlayback(const char* hostPath, Boolean unthrottled);
+Boolean	IsDemoPlaybackQueued(void);
+Boolean	IsDemoUnthrottled(void);
+void	SeedDemoRandomForArea(void);
 void	ReadKeyboard(void);
 void	StopDemo(void);
 void	PrintNum(long, short, short, short);
@@ -7,6 +7,7 @@ void	ToolBoxInit(void);
 void	InitGame(void);
 void	InitArea(void);
 void	LoadAreaArt(void);
+void	PrefetchNextAreaArt(void);
 void	PlayArea(void);
 void	SwitchPlayer(void);
 void	SaveCurrentPlayer(void);
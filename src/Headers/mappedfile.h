@@ -0,0 +1,13 @@
+#pragma once
+
+// Host-side file mapping. Use MapMikeFile (misc.h) rather than calling these directly:
+// it falls back to reading the file if it can't be mapped.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void		InitMappedFiles(const char* dataHostPath);
+const void*	MapDataFile(const char* fileName, long* outSize);
+void		UnmapDataFile(const void* data, long size);
+int			ListDataFolder(const char* folderName, char (*outNames)[64], int maxNames);
+bool		GetDataFileModTime(const char* fileName, int64_t* outModTime);
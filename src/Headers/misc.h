@@ -10,6 +10,23 @@
 	#define _Static_assert static_assert
 #endif
 
+typedef struct
+{
+	Handle		dataHand;			// receives the unpacked data
+	long		unpackedSize;
+	Ptr			packedData;			// whole payload as read from the file; nil if it was stored uncompressed
+	long		packedSize;
+	int32_t		packType;
+	Boolean		isNative;			// dataHand came from the native asset cache (see assetcache.h)
+} PackedFile;
+
+typedef struct
+{
+	const uint8_t*	data;				// whole file contents, read-only
+	long			size;
+	Boolean			isMapped;			// data is mapped from the file; otherwise it's a copy in a Ptr
+} MappedFile;
+
 void	ClearGlobalFlags(void);
 void	ShowSystemErr(OSErr);
 void	DoAlert(const char*);
@@ -21,10 +38,14 @@ Boolean	Wait(long);
 void	Wait2(long);
 void	Wait4(long);
 void	WaitWhileMusic(void);
-Handle	LoadRawFile(const char* file);
-Handle	LoadPackedFile(const char* file);
-void	DecompressRLBFile(short, Ptr, long);
-void	RLW_Expand(short, unsigned short *, long);
+Boolean	MapMikeFile(const char* fileName, MappedFile* mappedFile);
+void	UnmapMikeFile(MappedFile* mappedFile);
+Handle	LoadPackedFile(const char* file, Boolean* outIsNative);
+void	ReadPackedFile(const char* fileName, PackedFile* packedFile, Boolean allowNative);
+void	UnpackPackedFile(const PackedFile* packedFile);
+void	DisposePackedData(PackedFile* packedFile);
+void	DecompressRLB(const uint8_t* src, long srcSize, Ptr destPtr, long decompSize);
+void	RLW_Expand(const uint8_t* src, long srcSize, uint8_t* output, long outputSize);
 void	RegulateSpeed(long);
 void	RegulateSpeed2(short);
 unsigned short	RandomRange(unsigned short, unsigned short);
@@ -38,6 +59,10 @@ unsigned long	MyRandomLong(void);
 unsigned short	MyRandomShort(void);
 void	SetMyRandomSeed(unsigned long);
 
+#if _DEBUG
+void	BenchmarkPackedFiles(void);
+#endif
+
 
 static inline Boolean HandleBoundsCheck(Handle h, Ptr p)
 {
@@ -31,6 +31,13 @@ void	MoveObject(void);
 void	StopObjectMovement(ObjNode *);
 void	DeactivateObjectDraw(ObjNode *);
 void	SortObjectsByY(void);
+void	SetObjectZ(ObjNode *theNode, unsigned long z);
+void	InvalidateObjectListRanks(void);
+void	UpdateObjectListRanks(void);
+void	SetObjectCType(ObjNode *theNode, unsigned long cType);
+ObjNode	*GetFirstObjectOfCType(unsigned long cTypeBit);
+ObjNode	*GetNextObjectOfCType(ObjNode *theNode, unsigned long cTypeBit);
+void	RebuildObjectIndexes(void);
 void	SimpleObjectMove(void);
 void	InitYOffset(ObjNode* node, long yOffset);
 void	TweenObjectPosition(ObjNode* node, int32_t* x, int32_t* y);
@@ -106,6 +106,11 @@ void	UpdateViewWindow(void);
 Boolean	TestCoordinateRange(void);
 Boolean	TrackItem(void);
 void	DisplayPlayfield(void);
+void	DisplayPlayfieldFused(void);
+Boolean	IsPlayfieldCopyPending(void);
+void	CopyPendingPlayfieldRows(int firstRow, int numRows);
+void	MarkPlayfieldCopyDone(void);
+void	FlushPlayfieldCopy(void);
 void	DisplayPlayfieldInterlaced(void);
 Byte	GetAlternateTileInfo(uint16_t x, uint16_t y);
 uint16_t	GetMapTileAttribs(uint16_t x, uint16_t y);
@@ -114,6 +119,9 @@ void	StartShakeyScreen(short);
 void	UpdateShakeyScreen(void);
 short	MoveOnPath(long, Boolean);
 Boolean	NilAdd(ObjectEntryType *);
-void	CreatePlayfieldPermanentMemory(void);
 void	UpdateTileAnimation(void);
+void	MarkPlayfieldSpriteCells(long x, long y, long width, long height);
+void	ClearPlayfieldSpriteCells(void);
+void	LatchPlayfieldDitherCache(void);
+Boolean	GetPlayfieldRowDitherCache(int y, uint64_t* knownBits, uint64_t* knownSmearBits);
 
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+// Stages of the core loop that get a span in the profile.
+// Keep in sync with kProfileStageNames in Profiler.c.
+enum
+{
+	kProfile_ReadKeyboard,
+	kProfile_MoveObjects,
+	kProfile_SortObjectsByY,
+	kProfile_ScrollPlayfield,
+	kProfile_UpdateTileAnimation,
+	kProfile_DrawObjects,
+	kProfile_DisplayPlayfield,
+	kProfile_UpdateInfoBar,
+	kProfile_EraseObjects,
+	kProfile_Present,			// whole present, including conversion and upload
+	kProfile_Convert,			// main thread: synchronous conversion (start workers + wait)
+	kProfile_LatchFrame,		// main thread: copy dirty rows for a pipelined conversion
+	kProfile_WaitForConvert,	// main thread: wait for a pipelined conversion to finish
+	kProfile_ConvertTiles,		// converter thread: one frame's worth of tiles
+	kProfile_Upload,			// texture upload from the color buffer
+	kProfile_Frame,				// present to present, recorded by AdvanceProfilerFrame
+	kProfile_COUNT
+};
+
+// Thread IDs in the profile. Converter thread N records as kProfileThread_FirstConverter + N.
+enum
+{
+	kProfileThread_Main				= 0,
+	kProfileThread_FirstConverter	= 1,
+};
+
+extern Boolean gProfilerEnabled;
+
+void InitProfiler(void);
+uint64_t GetProfilerTime(void);
+void RecordProfilerSpan(int stage, int thread, uint64_t startTime);
+void AdvanceProfilerFrame(void);
+void DumpProfile(void);
+
+// Times one statement on the main thread. When the profiler is off, this costs a single branch.
+#define PROFILE_STAGE(stage, statement)											\
+	do																			\
+	{																			\
+		if (gProfilerEnabled)													\
+		{																		\
+			uint64_t profileStart_ = GetProfilerTime();							\
+			statement;															\
+			RecordProfilerSpan((stage), kProfileThread_Main, profileStart_);	\
+		}																		\
+		else																	\
+		{																		\
+			statement;															\
+		}																		\
+	} while (0)
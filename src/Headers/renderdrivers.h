@@ -2,9 +2,13 @@
 
 void GLRender_Init(void);
 void GLRender_Shutdown(void);
-void GLRender_PresentFramebuffer(void);
+void GLRender_PresentFramebuffer(Boolean pipelined);
 
 Boolean SDLRender_Init(void);
 void SDLRender_Shutdown(void);
 void SDLRender_InitTexture(void);
-void SDLRender_PresentFramebuffer(void);
+void SDLRender_PresentFramebuffer(Boolean pipelined);
+
+void NullRender_Init(Boolean convertFrames);
+void NullRender_Shutdown(void);
+void NullRender_PresentFramebuffer(Boolean pipelined);
@@ -23,9 +23,30 @@ typedef struct FrameList
 } FrameList;
 #pragma pack(pop)
 
+// Opaque run within one row of a frame. Pixels outside of runs are fully transparent.
+typedef struct FrameSpan
+{
+	uint16_t	x;				// first pixel of run, relative to start of row
+	uint16_t	length;			// # of pixels to copy as-is
+} FrameSpan;
+
+// Span-compiled form of a frame, built by LoadShapeTable.
+// The spans of row r are [rowSpans[r], rowSpans[r+1]) in the FrameSpan array that follows rowSpans.
+typedef struct FrameSpanTable
+{
+	int32_t		numRows;
+	int32_t		rowSpans[];		// numRows+1 entries
+} FrameSpanTable;
+
+static inline const FrameSpan* GetFrameSpans(const FrameSpanTable* table)
+{
+	return (const FrameSpan*) &table->rowSpans[table->numRows + 1];
+}
+
 ObjNode	*MakeNewShape(long groupNum, long type, long subType, short x, short y, short z, void (*moveCall)(void), Boolean pfRelativeFlag);
 void LoadShapeTable(const char* filename, long groupNum);
 const FrameHeader* GetFrameHeader(long groupNum, long shapeNum, long frameNum, const uint8_t** outPixelPtr, const uint8_t** outMaskPtr);
+const FrameSpanTable* GetFrameSpanTable(long groupNum, long shapeNum, long frameNum);
 void	DrawFrameToScreen(long, long, long, long, long);
 void	DrawFrameToScreen_NoMask(long, long, long, long, long);
 void DrawFrameToBackground(long x, long y, long groupNum, long shapeNum, long frameNum);
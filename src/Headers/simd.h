@@ -0,0 +1,23 @@
+#pragma once
+
+// Compile-time SIMD availability for the hand-vectorized kernels
+// (sprite blitters, framebuffer conversion).
+// x86 kernels beyond the baseline must still be selected at runtime with SDL_HasXXX().
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define SIMD_X86 1
+	#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+	#define SIMD_NEON 1
+	#include <arm_neon.h>
+	#if defined(__aarch64__) || defined(_M_ARM64)
+		#define SIMD_NEON_A64 1			// 64-entry table lookups (vqtbl4q)
+	#endif
+#endif
+
+// Lets a function use instructions that the rest of the file isn't compiled for.
+#if defined(__GNUC__) || defined(__clang__)
+	#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+	#define SIMD_TARGET(isa)
+#endif
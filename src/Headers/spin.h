@@ -12,12 +12,8 @@ enum
 	SPIN_COMMAND_EXTENDEDHEADER
 };
 
-#define	DEFAULT_SPIN_PRELOAD_SIZE	1000000L
-
-
 void	PlaySpinFile(short);
-void PreLoadSpinFile(const char* filename, long preLoadSize);
-Boolean	ContinueSpinLoad(void);
+void	PreLoadSpinFile(const char* filename);
 void	GetSpinHeader(void);
 void	GetSpinPalette(void);
 void	DoSpinFrame(void);
@@ -6,6 +6,7 @@
 
 
 #include <Pomme.h>
+#include "equates.h"
 
 
 #define	SF_HEADER__SHAPE_LIST	4
@@ -136,6 +137,13 @@ struct ObjNode
 	long			Worth;				// "worth" of object / # coins to give
 	long		InjuryThreshold;	// threshold for weapon to do damage to enemy
 
+	short			CollisionCell;		// bucket in the collision grid, -1 if not in it (for internal use)
+	struct ObjNode	*CollisionPrevNode;	// neighbors in the collision grid bucket (for internal use)
+	struct ObjNode	*CollisionNextNode;
+	unsigned long	ListRank;			// position in linked list, see UpdateObjectListRanks (for internal use)
+	struct ObjNode	*CTypePrevNode[NUM_CTYPE_BITS];	// neighbors in the per-CTYPE lists (for internal use)
+	struct ObjNode	*CTypeNextNode[NUM_CTYPE_BITS];
+
 	long			NodeNum;			// node # in array (for internal use)
 	struct ObjNode	*PrevNode;		// address of previous node in linked list
 	struct ObjNode	*NextNode;		// address of next node in linked list
@@ -303,9 +311,11 @@ struct PrefsType
 	Boolean		thermometerScreen;
 	Boolean		debugInfoInTitleBar;
 	Boolean		colorCorrection;
+	Boolean		pipelinedPresent;
+	Boolean		fusedPlayfieldCopy;
 	KeyBinding	keys[NUM_CONTROL_NEEDS];
 };
 typedef struct PrefsType PrefsType;
 
-#define PREFS_MAGIC "Mighty Mike Prefs v5"
+#define PREFS_MAGIC "Mighty Mike Prefs v7"
 
@@ -34,7 +34,13 @@ void	BlankEntireScreenArea(void);
 void	SetScreenOffsetForArea(void);
 void	SetScreenOffsetFor640x480(void);
 
+void MarkDirtyFramebufferRows(int firstRow, int numRows);
+void MarkDirtyFramebuffer(void);
+void ClearDirtyFramebufferRows(void);
+int GetNextDirtyRowRun(const uint8_t* dirtyRows, int fromRow, int endRow, int* outNumRows);
+int GetNextDirtyFramebufferRun(int fromRow, int endRow, int* outNumRows);
 void PresentIndexedFramebuffer(void);
+void PresentIndexedFramebufferPipelined(void);
 void DumpIndexedTGA(const char* hostPath, int width, int height, const char* data);
 void SetFullscreenMode(bool enforceDisplayPref);
 int GetMaxIntegerZoom(int displayWidth, int displayHeight);
@@ -0,0 +1,172 @@
+// NATIVE ASSET CACHE
+// This file is part of Mighty Mike. https://github.com/jorio/mightymike
+//
+// Tilesets, shape tables and maps are stored big-endian and packed. Every time one is loaded,
+// it gets unpacked and then byteswapped field by field. Since the data files never change,
+// the unpacked and byteswapped image of each file is kept in the prefs folder the first time
+// it's loaded. Afterwards, ReadPackedFile loads that image instead, in a single read, and
+// the loaders skip their byteswapping.
+//
+// A cache file is only used if the source file's size & modification time, its unpacked size &
+// its compression type, the game version and the byte order of the machine all match what the
+// cache file was made from.
+
+#include <string.h>
+#include <stdio.h>
+#include "myglobals.h"
+#include "externs.h"
+#include "misc.h"
+#include "version.h"
+#include "assetcache.h"
+#include "mappedfile.h"
+
+/****************************/
+/*    CONSTANTS             */
+/****************************/
+
+#define	CACHE_MAGIC			"MMNATIV2"
+#define	CACHE_BYTE_ORDER	0x01020304
+
+typedef struct
+{
+	char		magic[8];
+	char		gameVersion[16];
+	uint32_t	byteOrder;
+	int32_t		sourceSize;				// size of the packed file, header included
+	int32_t		unpackedSize;
+	int32_t		packType;
+	int64_t		sourceModTime;			// see GetDataFileModTime
+} NativeCacheHeader;
+
+/****************** MAKE CACHE HEADER ********************/
+//
+// Returns false if the source file's modification time can't be read,
+// in which case the file can't be cached.
+//
+
+static Boolean MakeCacheHeader(NativeCacheHeader* header, const char* fileName, long sourceSize, long unpackedSize, int32_t packType)
+{
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+	snprintf(header->gameVersion, sizeof(header->gameVersion), "%s", PROJECT_VERSION);
+	header->byteOrder		= CACHE_BYTE_ORDER;
+	header->sourceSize		= (int32_t) sourceSize;
+	header->unpackedSize	= (int32_t) unpackedSize;
+	header->packType		= packType;
+	return GetDataFileModTime(fileName, &header->sourceModTime);
+}
+
+/****************** MAKE CACHE SPEC ********************/
+//
+// ":maps:fairy.tileset" is cached as ":MightyMike:Cache-maps-fairy.tileset"
+//
+
+static void MakeCacheSpec(const char* fileName, FSSpec* spec)
+{
+	char path[256];
+	snprintf(path, sizeof(path), ":MightyMike:Cache%s", fileName);
+
+	for (char* c = path + sizeof(":MightyMike:") - 1; *c; c++)		// flatten the source path
+		if (*c == ':')
+			*c = '-';
+
+	FSMakeFSSpec(gPrefsFolderVRefNum, gPrefsFolderDirID, path, spec);
+}
+
+/****************** LOAD NATIVE ASSET ********************/
+//
+// Fills dataHand with the cached image of a packed file, if there's a valid one.
+// The key is what ReadPackedFile found in the packed file.
+// Returns false if there's no usable cache file.
+//
+
+Boolean LoadNativeAsset(const char* fileName, long sourceSize, long unpackedSize, int32_t packType, Handle dataHand)
+{
+FSSpec				spec;
+short				refNum;
+long				fileSize;
+long				count;
+NativeCacheHeader	expected;
+NativeCacheHeader	header;
+Boolean				success = false;
+
+	if (!MakeCacheHeader(&expected, fileName, sourceSize, unpackedSize, packType))
+		return false;
+
+	MakeCacheSpec(fileName, &spec);
+	if (FSpOpenDF(&spec, fsRdPerm, &refNum) != noErr)
+		return false;
+
+	count = sizeof(header);
+	if (GetEOF(refNum, &fileSize) == noErr
+		&& fileSize == (long) sizeof(header) + unpackedSize						// not truncated
+		&& FSRead(refNum, &count, (Ptr) &header) == noErr
+		&& count == (long) sizeof(header)
+		&& 0 == memcmp(&header, &expected, sizeof(header)))
+	{
+		count = unpackedSize;
+		success = FSRead(refNum, &count, *dataHand) == noErr && count == unpackedSize;
+	}
+
+	FSClose(refNum);
+	return success;
+}
+
+/****************** SAVE NATIVE ASSET ********************/
+//
+// Call this once a loader is done byteswapping a file that wasn't loaded from the cache,
+// before anything else modifies the data.
+//
+
+void SaveNativeAsset(const char* fileName, Handle dataHand)
+{
+FSSpec				spec;
+OSErr				iErr;
+short				refNum;
+long				count;
+long				sourceSize;
+int32_t				packHeader[2];				// unpacked size, pack type
+NativeCacheHeader	header;
+
+			/* GET KEY FROM SOURCE FILE */
+
+	refNum = OpenMikeFile(fileName);
+	iErr = GetEOF(refNum, &sourceSize);
+	count = sizeof(packHeader);
+	if (iErr == noErr)
+		iErr = FSRead(refNum, &count, (Ptr) packHeader);
+	FSClose(refNum);
+	if (iErr != noErr || count != (long) sizeof(packHeader))
+		return;
+
+	UnpackIntsBE(4, 2, packHeader);
+	GAME_ASSERT(packHeader[0] == GetHandleSize(dataHand));
+
+	if (!MakeCacheHeader(&header, fileName, sourceSize, packHeader[0], packHeader[1]))
+		return;
+
+			/* WRITE CACHE FILE */
+
+	MakeCacheSpec(fileName, &spec);
+	FSpDelete(&spec);															// delete any existing file
+	if (FSpCreate(&spec, 'MMik', 'Cach', smSystemScript) != noErr)
+		return;
+
+	if (FSpOpenDF(&spec, fsRdWrPerm, &refNum) != noErr)
+	{
+		FSpDelete(&spec);
+		return;
+	}
+
+	count = sizeof(header);
+	iErr = FSWrite(refNum, &count, (Ptr) &header);
+	if (iErr == noErr)
+	{
+		count = packHeader[0];
+		iErr = FSWrite(refNum, &count, *dataHand);
+	}
+	FSClose(refNum);
+
+	if (iErr != noErr)															// don't leave a bad file behind
+		FSpDelete(&spec);
+}
@@ -0,0 +1,270 @@
+// ASSET LOADER
+// This file is part of Mighty Mike. https://github.com/jorio/mightymike
+//
+// Unpacks packed files on a small pool of background threads, so that the next area's art
+// is ready by the time the player gets there, and so that the files of an area that wasn't
+// prefetched get unpacked side by side. LoadPackedFile picks up prefetched files by name.
+//
+// The file and memory managers aren't thread-safe, so the packed data is read and the
+// handles are allocated on the main thread (see ReadPackedFile). Only the expansion
+// itself (UnpackPackedFile) runs on the loader threads.
+
+#include <Pomme.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#if !_WIN32
+	#include <pthread.h>
+#endif
+
+extern "C"
+{
+	#include "externs.h"
+	#include "misc.h"
+	#include "assetloader.h"
+}
+
+// More than this doesn't help: an area only has a handful of files
+#define MAX_LOADER_THREADS		4
+
+struct PrefetchJob
+{
+	std::string		fileName;
+	PackedFile		packedFile;
+	bool			done = false;			// guarded by gMutex
+};
+
+// Files that were prefetched and not taken yet (main thread only)
+static std::vector<std::unique_ptr<PrefetchJob>> gPrefetchedFiles;
+
+// Jobs that no loader thread has started yet
+static std::deque<PrefetchJob*> gPendingJobs;
+
+static std::vector<std::thread> gLoaderThreadPool;
+static std::mutex gMutex;
+static std::condition_variable gJobQueued;
+static std::condition_variable gJobDone;
+static bool gQuitLoaderThread = false;
+
+// ----------------------------------------------------------------------------
+
+static void LoaderThreadLoop(int threadNum)
+{
+#if !_WIN32 && _GNU_SOURCE
+	char name[32];
+	snprintf(name, sizeof(name), "Loader %02d", threadNum);
+	pthread_setname_np(pthread_self(), name);
+#else
+	(void) threadNum;
+#endif
+
+	std::unique_lock lock(gMutex);
+
+	while (true)
+	{
+		gJobQueued.wait(lock, [] { return gQuitLoaderThread || !gPendingJobs.empty(); });
+
+		if (gQuitLoaderThread)
+			break;
+
+		PrefetchJob* job = gPendingJobs.front();
+		gPendingJobs.pop_front();
+
+		lock.unlock();
+		UnpackPackedFile(&job->packedFile);
+		lock.lock();
+
+		job->done = true;
+		gJobDone.notify_all();
+	}
+}
+
+// Makes sure the loader threads are done with a job.
+// If the job hasn't started yet, it is taken off the queue, and unpacked right here if needUnpack is set.
+// Returns false if the job never got unpacked.
+static bool RetireJob(PrefetchJob* job, bool needUnpack)
+{
+	std::unique_lock lock(gMutex);
+
+	auto pending = std::find(gPendingJobs.begin(), gPendingJobs.end(), job);
+	if (pending != gPendingJobs.end())
+	{
+		gPendingJobs.erase(pending);
+		lock.unlock();
+
+		if (needUnpack)
+			UnpackPackedFile(&job->packedFile);		// quicker than waiting for the jobs ahead of it
+
+		return needUnpack;
+	}
+
+	gJobDone.wait(lock, [job] { return job->done; });
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+/******************** PREFETCH PACKED FILE *****************/
+//
+// Reads a packed file now and unpacks it in the background.
+// Main thread only.
+//
+
+void PrefetchPackedFile(const char* fileName)
+{
+	if (gNumThreads <= 1)							// nothing to gain from loader threads
+	{
+		return;
+	}
+
+	for (auto& job : gPrefetchedFiles)				// already coming
+	{
+		if (job->fileName == fileName)
+			return;
+	}
+
+	if (gLoaderThreadPool.empty())
+	{
+		int numLoaderThreads = std::min(gNumThreads - 1, MAX_LOADER_THREADS);
+		numLoaderThreads = std::max(numLoaderThreads, 1);
+
+		gQuitLoaderThread = false;
+		for (int i = 0; i < numLoaderThreads; i++)
+			gLoaderThreadPool.emplace_back(LoaderThreadLoop, i);
+	}
+
+	auto job = std::make_unique<PrefetchJob>();
+	job->fileName = fileName;
+	ReadPackedFile(fileName, &job->packedFile, true);		// only the loaders that handle native data get prefetched
+
+	{
+		std::scoped_lock lock(gMutex);
+		gPendingJobs.push_back(job.get());
+		gJobQueued.notify_one();
+	}
+
+	gPrefetchedFiles.push_back(std::move(job));
+}
+
+/******************** IS PREFETCH PENDING *****************/
+//
+// Returns true if the file was prefetched but isn't unpacked yet.
+//
+
+Boolean IsPrefetchPending(const char* fileName)
+{
+	std::scoped_lock lock(gMutex);
+
+	for (auto& job : gPrefetchedFiles)
+	{
+		if (job->fileName == fileName)
+			return !job->done;
+	}
+
+	return false;
+}
+
+/******************** WAIT FOR PREFETCH PROGRESS *****************/
+//
+// Sleeps until a loader thread finishes a file, or until the timeout runs out.
+//
+
+void WaitForPrefetchProgress(int timeoutMS)
+{
+	std::unique_lock lock(gMutex);
+
+	if (gPendingJobs.empty() && std::all_of(gPrefetchedFiles.begin(), gPrefetchedFiles.end(),
+			[](const auto& job) { return job->done; }))
+	{
+		return;
+	}
+
+	gJobDone.wait_for(lock, std::chrono::milliseconds(timeoutMS));
+}
+
+/******************** TAKE PREFETCHED FILE *****************/
+//
+// Returns the unpacked data of a prefetched file (waiting for it if needed)
+// and forgets about it. The caller owns the handle.
+// Returns nil if the file wasn't prefetched, or if it came from the native asset cache
+// but the caller can't take native data (outIsNative is nil).
+//
+
+Handle TakePrefetchedFile(const char* fileName, Boolean* outIsNative)
+{
+	auto it = std::find_if(gPrefetchedFiles.begin(), gPrefetchedFiles.end(),
+			[fileName](const auto& job) { return job->fileName == fileName; });
+
+	if (it == gPrefetchedFiles.end())
+	{
+		return nil;
+	}
+
+	PrefetchJob* job = it->get();
+	RetireJob(job, true);
+	DisposePackedData(&job->packedFile);
+
+	Handle dataHand = job->packedFile.dataHand;
+	if (outIsNative)
+	{
+		*outIsNative = job->packedFile.isNative;
+	}
+	else if (job->packedFile.isNative)
+	{
+		DisposeHandle(dataHand);
+		dataHand = nil;
+	}
+
+	gPrefetchedFiles.erase(it);
+	return dataHand;
+}
+
+/******************** FLUSH PREFETCHED FILES *****************/
+//
+// Throws away the prefetched files that nobody took.
+//
+
+void FlushPrefetchedFiles(void)
+{
+	for (auto& job : gPrefetchedFiles)
+	{
+		RetireJob(job.get(), false);
+		DisposePackedData(&job->packedFile);
+		DisposeHandle(job->packedFile.dataHand);
+	}
+
+	gPrefetchedFiles.clear();
+}
+
+/******************** SHUTDOWN ASSET LOADER *****************/
+
+void ShutdownAssetLoader(void)
+{
+	FlushPrefetchedFiles();
+
+	if (gLoaderThreadPool.empty())
+	{
+		return;
+	}
+
+	{
+		std::scoped_lock lock(gMutex);
+		gQuitLoaderThread = true;
+		gJobQueued.notify_all();
+	}
+
+	for (auto& t : gLoaderThreadPool)
+	{
+		t.join();
+	}
+
+	gLoaderThreadPool.clear();
+}
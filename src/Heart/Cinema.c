@@ -161,6 +161,15 @@ re_enter:
 		ReadKeyboard();
 		DoSoundMaintenance(true);							// (must be after readkeyboard)
 
+		if (IsDemoPlaybackQueued())						// see if demo given on command line
+		{
+			gPlayerMode = ONE_PLAYER;
+			FadeOutGameCLUT();
+			ZapShapeTable(GROUP_MAIN);
+			InitDemoPlayback();
+			return;
+		}
+
 //		if ((--gDemoTimeout < 0) || (GetKeyState(KEY_P)&&GetKeyState(KEY_L)))	// see if do demo
 //		{
 //			gPlayerMode = ONE_PLAYER;
@@ -752,7 +761,7 @@ corrupt:
 void DoPangeaLogo(void)
 {
 	EraseCLUT();
-	PreLoadSpinFile(":movies:pangea.spin",DEFAULT_SPIN_PRELOAD_SIZE);	// load the file
+	PreLoadSpinFile(":movies:pangea.spin");						// load the file
 	PlaySong(SONG_ID_PANGEA);
 
 	PlaySpinFile(60*5);
@@ -1037,7 +1046,7 @@ static void DoScrollingTextScreen(
 		int letterBaseScrollSpeed,
 		int letterVanishAtY)
 {
-Handle	textRez = nil;
+MappedFile	textFile;
 int		textPos;
 int		textLength;
 short	lineCount;
@@ -1060,10 +1069,10 @@ short	lineCount;
 
 				/* LET'S DO IT */
 
-	textRez = LoadRawFile(textFilePath);						// load credits file
-	GAME_ASSERT(textRez);
+	if (!MapMikeFile(textFilePath, &textFile))					// load credits file
+		DoFatalAlert2("Cannot open data file", textFilePath);
 
-	textLength = GetHandleSize(textRez);
+	textLength = textFile.size;
 	textPos = 0;
 	lineCount = 100;
 
@@ -1083,7 +1092,7 @@ short	lineCount;
 		if (textPos < textLength && ++lineCount > 50)		// see if ready for next line
 		{
 			lineCount = 0;
-			textPos = LayOutScrollingTextLine(*textRez, textLength, textPos, letterBaseScrollSpeed, letterVanishAtY);
+			textPos = LayOutScrollingTextLine((const char*) textFile.data, textLength, textPos, letterBaseScrollSpeed, letterVanishAtY);
 		}
 
 		DrawObjects();
@@ -1096,7 +1105,7 @@ short	lineCount;
 
 				/* CLEAN UP */
 
-	DisposeHandle(textRez);							// zap the text rez
+	UnmapMikeFile(&textFile);						// zap the text rez
 	ZapShapeTable(GROUP_WIN);
 
 	FadeOutGameCLUT();
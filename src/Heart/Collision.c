@@ -19,6 +19,18 @@
 /*    CONSTANTS             */
 /****************************/
 
+#define	COLLISION_CELL_SH		6							// collision grid cells are 64x64 pixels
+#define	COLLISION_GRID_SIZE		32							// grid wraps around every 32 cells in each direction
+#define	COLLISION_GRID_MASK		(COLLISION_GRID_SIZE-1)
+
+
+/****************************/
+/*    PROTOTYPES            */
+/****************************/
+
+static int GatherCollisionCandidates(long left, long right, long top, long bottom);
+static void SortCollisionsByListOrder(void);
+
 /****************************/
 /*    VARIABLES             */
 /****************************/
@@ -28,6 +40,15 @@ CollisionRec	gCollisionList[MAX_COLLISIONS];
 short			gNumCollisions = 0;
 Byte			gTotalSides;
 
+			// Broadphase: every live ObjNode sits in the grid bucket of its collision box's top-left corner.
+			// A query visits the buckets that can hold a box overlapping the query box, then
+			// sorts the hits back into linked list order so results match a full list scan.
+
+static	ObjNode			*gCollisionGrid[COLLISION_GRID_SIZE*COLLISION_GRID_SIZE];
+static	long			gMaxCollisionBoxWidth = 0;			// largest RightSide-LeftSide filed since ResetCollisionGrid
+static	long			gMaxCollisionBoxHeight = 0;
+static	ObjNode			*gCollisionCandidates[MAX_OBJECTS];
+
 
 /******************* COLLISION DETECT *********************/
 
@@ -36,6 +57,7 @@ void CollisionDetect(ObjNode *baseNode,unsigned long CType)
 register	ObjNode 	*thisNode;
 register	long		sideBits,cBits;
 register	long		relDX,relDY;
+int			numCandidates,i;
 
 	gNumCollisions = 0;							// clear list
 	gTotalSides = 0;
@@ -51,111 +73,116 @@ register	long		relDX,relDY;
 				/*******************************/
 
 
-	thisNode = FirstNodePtr;						// start on 1st node
+	numCandidates = GatherCollisionCandidates(gLeftSide, gRightSide, gTopSide, gBottomSide);
 
-loop:
-	if (!(thisNode->CType & CType))					// see if we want to check this Type
-		goto next;
+	for (i = 0; i < numCandidates; i++)
+	{
+		thisNode = gCollisionCandidates[i];
 
-	if (!thisNode->CBits)							// see if this obj doesn't need collisioning
-		goto next;
+		if (!(thisNode->CType & CType))					// see if we want to check this Type
+			goto next;
 
-	if (thisNode == baseNode)						// dont collide against itself
-		goto next;
+		if (!thisNode->CBits)							// see if this obj doesn't need collisioning
+			goto next;
 
+		if (thisNode == baseNode)						// dont collide against itself
+			goto next;
 
 
-					/* DO RECTANGLE INTERSECTION */
 
-	if (gRightSide < thisNode->LeftSide)
-		goto next;
+						/* DO RECTANGLE INTERSECTION */
 
-	if	(gLeftSide > thisNode->RightSide)
-		goto next;
+		if (gRightSide < thisNode->LeftSide)
+			goto next;
 
-	if	(gTopSide > thisNode->BottomSide)
-		goto next;
+		if	(gLeftSide > thisNode->RightSide)
+			goto next;
 
-	if (gBottomSide < thisNode->TopSide)
-		goto next;
+		if	(gTopSide > thisNode->BottomSide)
+			goto next;
 
+		if (gBottomSide < thisNode->TopSide)
+			goto next;
 
-			/* THERE HAS BEEN A COLLISION SO CHECK WHICH SIDE PASSED THRU */
 
-	sideBits = 0;
-	cBits = thisNode->CBits;					// get collision info bits
+				/* THERE HAS BEEN A COLLISION SO CHECK WHICH SIDE PASSED THRU */
 
-	if (cBits & CBITS_TOUCHABLE)				// if it's generically touchable, then add it without side info
-		goto	got_sides;
+		sideBits = 0;
+		cBits = thisNode->CBits;					// get collision info bits
 
-	relDX = gSumDX - thisNode->DX;				// calc relative deltas
-	relDY = gSumDY - thisNode->DY;
+		if (cBits & CBITS_TOUCHABLE)				// if it's generically touchable, then add it without side info
+			goto	got_sides;
 
+		relDX = gSumDX - thisNode->DX;				// calc relative deltas
+		relDY = gSumDY - thisNode->DY;
 
-					/* CHECK BOTTOM COLLISION */
 
+						/* CHECK BOTTOM COLLISION */
 
-	if ((cBits & SIDE_BITS_TOP) && (relDY > 0))			// see if target has solid top & we are going relatively down
-	{
-		if (baseNode->BottomSide < thisNode->OldTopSide)		// get old source bottom & see if already was in target
-			if ((gBottomSide >= thisNode->TopSide) &&			// see if currently in target
-				(gBottomSide <= thisNode->BottomSide))
-				sideBits = SIDE_BITS_BOTTOM;
-		goto check_sides;
-	}
 
-						/* CHECK TOP COLLISION */
+		if ((cBits & SIDE_BITS_TOP) && (relDY > 0))			// see if target has solid top & we are going relatively down
+		{
+			if (baseNode->BottomSide < thisNode->OldTopSide)		// get old source bottom & see if already was in target
+				if ((gBottomSide >= thisNode->TopSide) &&			// see if currently in target
+					(gBottomSide <= thisNode->BottomSide))
+					sideBits = SIDE_BITS_BOTTOM;
+			goto check_sides;
+		}
 
-	if ((cBits & SIDE_BITS_BOTTOM) && (relDY < 0))			// see if target has solid bottom & we are going relatively up
-	{
-		if (baseNode->TopSide > thisNode->OldBottomSide)	// get old source top & see if already was in target
-			if ((gTopSide <= thisNode->BottomSide) &&		// see if currently in target
-				(gTopSide >= thisNode->TopSide))
-				sideBits = SIDE_BITS_TOP;
-	}
+							/* CHECK TOP COLLISION */
+
+		if ((cBits & SIDE_BITS_BOTTOM) && (relDY < 0))			// see if target has solid bottom & we are going relatively up
+		{
+			if (baseNode->TopSide > thisNode->OldBottomSide)	// get old source top & see if already was in target
+				if ((gTopSide <= thisNode->BottomSide) &&		// see if currently in target
+					(gTopSide >= thisNode->TopSide))
+					sideBits = SIDE_BITS_TOP;
+		}
 
 
 check_sides:
 
-					/* CHECK RIGHT COLLISION */
+						/* CHECK RIGHT COLLISION */
 
 
-	if ((cBits & SIDE_BITS_LEFT) && (relDX > 0))			// see if target has solid left & we are going relatively right
-	{
-		if (baseNode->RightSide < thisNode->OldLeftSide)	// get old source right & see if already was in target
-			if ((gRightSide >= thisNode->LeftSide) &&		// see if currently in target
-				(gRightSide <= thisNode->RightSide))
-				sideBits |= SIDE_BITS_RIGHT;
-		goto end_sides;
-	}
+		if ((cBits & SIDE_BITS_LEFT) && (relDX > 0))			// see if target has solid left & we are going relatively right
+		{
+			if (baseNode->RightSide < thisNode->OldLeftSide)	// get old source right & see if already was in target
+				if ((gRightSide >= thisNode->LeftSide) &&		// see if currently in target
+					(gRightSide <= thisNode->RightSide))
+					sideBits |= SIDE_BITS_RIGHT;
+			goto end_sides;
+		}
 
-						/* CHECK COLLISION ON LEFT */
+							/* CHECK COLLISION ON LEFT */
 
-	if ((cBits & SIDE_BITS_RIGHT) && (relDX < 0))			// see if target has solid right & we are going relatively left
-	{
-		if (baseNode->LeftSide > thisNode->OldRightSide)	// get old source left & see if already was in target
-			if ((gLeftSide <= thisNode->RightSide) &&		// see if currently in target
-				(gLeftSide >= thisNode->LeftSide))
-				sideBits |= SIDE_BITS_LEFT;
-	}
+		if ((cBits & SIDE_BITS_RIGHT) && (relDX < 0))			// see if target has solid right & we are going relatively left
+		{
+			if (baseNode->LeftSide > thisNode->OldRightSide)	// get old source left & see if already was in target
+				if ((gLeftSide <= thisNode->RightSide) &&		// see if currently in target
+					(gLeftSide >= thisNode->LeftSide))
+					sideBits |= SIDE_BITS_LEFT;
+		}
 
 
-					 /* SEE IF ANYTHING TO ADD */
+						 /* SEE IF ANYTHING TO ADD */
 
 end_sides:
-	if (!sideBits)											// see if anything actually happened
-		goto next;
+		if (!sideBits)											// see if anything actually happened
+			goto next;
 
 got_sides:
-	gCollisionList[gNumCollisions].sides = sideBits;		// add to collision list
-	gCollisionList[gNumCollisions].type = COLLISION_TYPE_OBJ;
-	gCollisionList[gNumCollisions].objectPtr = thisNode;
-	gNumCollisions++;
-	gTotalSides |= sideBits;								// remember total of this
+		gCollisionList[gNumCollisions].sides = sideBits;		// add to collision list
+		gCollisionList[gNumCollisions].type = COLLISION_TYPE_OBJ;
+		gCollisionList[gNumCollisions].objectPtr = thisNode;
+		gNumCollisions++;
+		gTotalSides |= sideBits;								// remember total of this
 
 next:
-	if ((thisNode = thisNode->NextNode) != nil)				// next target node
-		goto loop;
+		;
+	}
+
+	SortCollisionsByListOrder();							// same order as a scan of the whole list
 
 
 				/*******************************/
@@ -480,18 +507,21 @@ short			originalX,originalY,offset;
 void DoSimpleCollision(unsigned long cTypes)
 {
 register	ObjNode		*targetNodePtr;
+int			numCandidates,i;
 
 	gNumCollisions = 0;										// assume no collisions
 
 	if (FirstNodePtr == nil)								// see if there are any objects
 		return;
 
-	targetNodePtr = FirstNodePtr;							// start on 1st node
+	numCandidates = GatherCollisionCandidates(gLeftSide, gRightSide, gTopSide, gBottomSide);
 
 					/* SCAN LOOP */
 
-	do
+	for (i = 0; i < numCandidates; i++)
 	{
+		targetNodePtr = gCollisionCandidates[i];
+
 		if ((targetNodePtr->CType & cTypes) &&				// check for matching ctype
 			(targetNodePtr != gThisNodePtr))				// cant collide against itself
 		{
@@ -513,9 +543,10 @@ register	ObjNode		*targetNodePtr;
 		}
 
 next:
-		targetNodePtr = (ObjNode *)targetNodePtr->NextNode;	// next node
+		;
 	}
-	while (targetNodePtr != nil);
+
+	SortCollisionsByListOrder();
 }
 
 
@@ -532,6 +563,7 @@ Boolean DoPointCollision(unsigned short x, unsigned short y, unsigned long cType
 register	ObjNode		*targetNodePtr;
 register	unsigned	short			tileNum;
 register	Byte		bits;								// only care about 8 bits worth of collision info
+int			numCandidates,i;
 
 	if ((y >= gPlayfieldHeight) || (x >= gPlayfieldWidth))	// check for bounds error
 		return(false);
@@ -541,13 +573,14 @@ register	Byte		bits;								// only care about 8 bits worth of collision info
 	if (FirstNodePtr == nil)								// see if there are any objects
 		return(false);
 
-	targetNodePtr = FirstNodePtr;							// start on 1st node
-
+	numCandidates = GatherCollisionCandidates(x, x, y, y);
 
 					/* OBJECT SCAN LOOP */
 
-	do
+	for (i = 0; i < numCandidates; i++)
 	{
+		targetNodePtr = gCollisionCandidates[i];
+
 		if (targetNodePtr->CType & cTypes)					// check for matching ctype
 		{
 			if  (x > targetNodePtr->RightSide)				// see if point within object box
@@ -566,9 +599,10 @@ register	Byte		bits;								// only care about 8 bits worth of collision info
 		}
 
 next:
-		targetNodePtr = (ObjNode *)targetNodePtr->NextNode;	// next node
+		;
 	}
-	while (targetNodePtr != nil);
+
+	SortCollisionsByListOrder();
 
 					/* CHECK BACKGROUND */
 
@@ -586,3 +620,157 @@ next:
 	return (gNumCollisions>0);
 }
 
+
+
+/******************** RESET COLLISION GRID *****************/
+//
+// Call when the object list is wiped out.
+//
+
+void ResetCollisionGrid(void)
+{
+	for (int i = 0; i < COLLISION_GRID_SIZE*COLLISION_GRID_SIZE; i++)
+		gCollisionGrid[i] = nil;
+
+	gMaxCollisionBoxWidth = 0;
+	gMaxCollisionBoxHeight = 0;
+}
+
+
+/******************** GET COLLISION CELL *****************/
+
+static inline int GetCollisionCell(long x, long y)
+{
+	return	(((y >> COLLISION_CELL_SH) & COLLISION_GRID_MASK) * COLLISION_GRID_SIZE)
+			+ ((x >> COLLISION_CELL_SH) & COLLISION_GRID_MASK);
+}
+
+
+/******************** REMOVE OBJECT COLLISION CELL *****************/
+
+void RemoveObjectCollisionCell(ObjNode *theNode)
+{
+	if (theNode->CollisionCell < 0)
+		return;
+
+	if (theNode->CollisionPrevNode)
+		theNode->CollisionPrevNode->CollisionNextNode = theNode->CollisionNextNode;
+	else
+		gCollisionGrid[theNode->CollisionCell] = theNode->CollisionNextNode;
+
+	if (theNode->CollisionNextNode)
+		theNode->CollisionNextNode->CollisionPrevNode = theNode->CollisionPrevNode;
+
+	theNode->CollisionPrevNode = nil;
+	theNode->CollisionNextNode = nil;
+	theNode->CollisionCell = -1;
+}
+
+
+/******************** UPDATE OBJECT COLLISION CELL *****************/
+//
+// Call whenever the node's collision box sides change.
+//
+
+void UpdateObjectCollisionCell(ObjNode *theNode)
+{
+long	width,height;
+int		cell;
+
+	width = theNode->RightSide - theNode->LeftSide;
+	height = theNode->BottomSide - theNode->TopSide;
+
+	if (width > gMaxCollisionBoxWidth)
+		gMaxCollisionBoxWidth = width;
+	if (height > gMaxCollisionBoxHeight)
+		gMaxCollisionBoxHeight = height;
+
+	cell = GetCollisionCell(theNode->LeftSide, theNode->TopSide);
+	if (cell == theNode->CollisionCell)						// still in the same bucket
+		return;
+
+	RemoveObjectCollisionCell(theNode);
+
+	theNode->CollisionCell = cell;
+	theNode->CollisionPrevNode = nil;
+	theNode->CollisionNextNode = gCollisionGrid[cell];
+	if (gCollisionGrid[cell])
+		gCollisionGrid[cell]->CollisionPrevNode = theNode;
+	gCollisionGrid[cell] = theNode;
+}
+
+
+/******************** GATHER COLLISION CANDIDATES *****************/
+//
+// Puts every node whose box could overlap the given box into gCollisionCandidates.
+// Callers still do the exact test. Returns # of candidates.
+//
+
+static int GatherCollisionCandidates(long left, long right, long top, long bottom)
+{
+long	col0,col1,row0,row1,row,col;
+int		numCandidates = 0;
+
+	col0 = (left - gMaxCollisionBoxWidth) >> COLLISION_CELL_SH;	// a box's left side is at most this far left of its right side
+	col1 = right >> COLLISION_CELL_SH;
+	row0 = (top - gMaxCollisionBoxHeight) >> COLLISION_CELL_SH;
+	row1 = bottom >> COLLISION_CELL_SH;
+
+	if (col1 < col0 || row1 < row0)								// nothing can overlap an inside-out box this far
+		return 0;
+
+	if (col1 - col0 >= COLLISION_GRID_SIZE)						// wider than the grid: visit each column once
+	{
+		col0 = 0;
+		col1 = COLLISION_GRID_SIZE-1;
+	}
+	if (row1 - row0 >= COLLISION_GRID_SIZE)
+	{
+		row0 = 0;
+		row1 = COLLISION_GRID_SIZE-1;
+	}
+
+	for (row = row0; row <= row1; row++)
+	{
+		for (col = col0; col <= col1; col++)
+		{
+			ObjNode* node = gCollisionGrid[(row & COLLISION_GRID_MASK) * COLLISION_GRID_SIZE + (col & COLLISION_GRID_MASK)];
+
+			for (; node != nil; node = node->CollisionNextNode)
+			{
+				GAME_ASSERT(numCandidates < MAX_OBJECTS);
+				gCollisionCandidates[numCandidates++] = node;
+			}
+		}
+	}
+
+	return numCandidates;
+}
+
+
+/******************** SORT COLLISIONS BY LIST ORDER *****************/
+//
+// Puts the object collisions found so far in the order the linked list would have found them.
+//
+
+static void SortCollisionsByListOrder(void)
+{
+	if (gNumCollisions < 2)
+		return;
+
+	UpdateObjectListRanks();
+
+	for (int i = 1; i < gNumCollisions; i++)					// insertion sort, there are only ever a few hits
+	{
+		CollisionRec hit = gCollisionList[i];
+		int j = i;
+
+		while (j > 0 && gCollisionList[j-1].objectPtr->ListRank > hit.objectPtr->ListRank)
+		{
+			gCollisionList[j] = gCollisionList[j-1];
+			j--;
+		}
+
+		gCollisionList[j] = hit;
+	}
+}
@@ -5,7 +5,10 @@
 #include <Pomme.h>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <vector>
+#include <cstring>
 #include <condition_variable>
 
 #if !_WIN32
@@ -15,106 +18,318 @@
 extern "C"
 {
 	#include "externs.h"
+	#include "misc.h"
 	#include "window.h"
 	#include "framebufferfilter.h"
+	#include "playfield.h"
+	#include "profiler.h"
+	#include "simd.h"
 }
 
+// The frame is cut into tiles of a few rows. Each worker starts out owning an even share of the tiles
+// and eats them front to back. A worker that runs out steals tiles from the back of another worker's share,
+// so a few heavily-dithered rows don't leave the other threads idle.
+#define ROWS_PER_TILE			8
+
+// How long a thread busy-waits for the next frame (or for the workers to finish) before going to sleep
+// on a condition variable. Frames come in every few ms, so the workers usually park between frames,
+// but the main thread's wait for the workers to finish is normally short enough to stay in the spin.
+#define SPIN_BEFORE_PARK_NS		50000
+
+typedef std::chrono::steady_clock Clock;
+
+// A worker's share of the tiles: [next, end) packed in one word so that the owner (taking from the front)
+// and thieves (taking from the back) can race with a single compare-exchange.
+struct alignas(64) TileSpan
+{
+	std::atomic<uint32_t>	nextAndEnd;
+
+	// Stats, only touched by the owning thread while it works (read by the main thread between frames)
+	uint64_t				busyNanos;
+	uint32_t				numTiles;
+	uint32_t				numStolen;
+	uint32_t				numParks;
+};
+
 static std::vector<std::thread> gRenderThreadPool;
+static TileSpan gTileSpans[MAX_RENDER_THREADS];
+
+// Main to renderers: bumped to start a frame
+static std::atomic<uint32_t> gFrameGeneration{0};
+static std::atomic<bool> gQuitRenderThreads{false};
+
+// Renderers to main: number of workers that haven't finished the current frame
+static std::atomic<int> gNumBusyRenderers{0};
+
+// Parking lot for threads that gave up spinning
 static std::mutex gMutex;
 static std::condition_variable gMainToRenderers;
 static std::condition_variable gRenderersToMain;
-static bool gQuitRenderThreads = false;
-static uint32_t gLatchMask;
+static std::atomic<int> gNumParkedRenderers{0};
+static std::atomic<bool> gMainParked{false};
+
+static uint32_t gNumFramesSinceReport = 0;
+static uint64_t gMainWaitNanos = 0;
 
 static color_t gScratch[1024*512];  // todo: actual size
 static color_t* gFinalColor = NULL;
 
-// ----------------------------------------------------------------------------
+// What the converters work on, set on the main thread before the workers start.
+// A synchronous present converts the live framebuffer. A pipelined present converts a copy
+// of the frame's dirty rows, so the main thread can draw the next frame in the meantime.
+static const uint8_t* gConvertDirtyRows = NULL;
+static int gConvertHeight = 0;
+static bool gConvertX2 = false;
+static bool gConvertFilterDithering = false;
+static bool gConvertCopiesPlayfield = false;		// copy each row from the PF buffer before converting it (see DisplayPlayfieldFused)
 
-static void RaiseLatches()
-{
-	static_assert(MAX_RENDER_THREADS <= 32, "Review this if MAX_RENDER_THREADS exceeds 32!");
+static std::vector<uint8_t> gLatchedFramebuffer;
+static std::vector<uint8_t> gLatchedDirtyRows;
 
-	gLatchMask = (uint32_t) (((uint64_t)1 << gRenderThreadPool.size()) - 1);
-}
+// Pipelined present state (main thread only)
+static bool gFrameInFlight = false;			// workers started by BeginConvertFramebufferMT, not waited on yet
+static bool gFramePending = false;			// frame started by BeginConvertFramebufferMT, not handed to the renderer yet
+static Clock::time_point gFrameBeganAt;
 
-static bool IsLatchRaised(int threadNum)
+static uint32_t gNumPipelinedFramesSinceReport = 0;
+static uint64_t gLatchNanos = 0;
+static uint64_t gPipelineLatencyNanos = 0;
+
+// ----------------------------------------------------------------------------
+
+static inline void CpuRelax()
 {
-	return (gLatchMask >> threadNum) & 1;
+#if SIMD_X86
+	_mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__aarch64__) || defined(__arm__))
+	__asm__ __volatile__("yield");
+#else
+	std::this_thread::yield();
+#endif
 }
 
-static void LowerLatch(int threadNum)
+static inline uint32_t PackSpan(int next, int end)
 {
-	gLatchMask &= ~(1 << threadNum);
+	return (uint32_t) next | ((uint32_t) end << 16);
 }
 
-static void TellMainThreadImReady(int threadNum)
-{
-	LowerLatch(threadNum);
+static inline int SpanNext(uint32_t span) { return span & 0xFFFF; }
+static inline int SpanEnd(uint32_t span) { return span >> 16; }
 
-	if (gLatchMask == 0)
-	{
-		gRenderersToMain.notify_one();
-	}
+static uint64_t NanosSince(Clock::time_point t)
+{
+	return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t).count();
 }
 
-static void Convert(int threadNum, int firstRow, int numRows)
+// ----------------------------------------------------------------------------
+
+static void ConvertRows(int threadNum, int firstRow, int numRows)
 {
-	bool doX2 = gEffectiveScalingType == kScaling_HQStretch;
+	color_t* scratch = gConvertX2 ? gScratch: gFinalColor;
 
-	color_t* scratch = doX2 ? gScratch: gFinalColor;
+	if (gConvertCopiesPlayfield)
+		CopyPendingPlayfieldRows(firstRow, numRows);
 
-	if (gGamePrefs.filterDithering)
+	if (gConvertFilterDithering)
 		IndexedFramebufferToColor_FilterDithering(scratch, threadNum, firstRow, numRows);
 	else
 		IndexedFramebufferToColor_NoFilter(scratch, firstRow, numRows);
 
-	if (gEffectiveScalingType == kScaling_HQStretch)
+	if (gConvertX2)
 		DoublePixels(scratch, gFinalColor, firstRow, numRows);
 }
 
-static void ConverterThread(int threadNum, int firstRow, int numRows)
+// Converts the rows in the given range that changed since the last present
+static void Convert(int threadNum, int firstRow, int numRows)
 {
-#if !_WIN32 && _GNU_SOURCE
-	char name[32];
-	snprintf(name, sizeof(name), "Rows %03d-%03d", firstRow, firstRow+numRows-1);
-	pthread_setname_np(pthread_self(), name);
-#endif
+	int endRow = firstRow + numRows;
+	int runRows = 0;
 
-	// Initial condition: tell main thread we're ready
+	for (int row = GetNextDirtyRowRun(gConvertDirtyRows, firstRow, endRow, &runRows);
+		row >= 0;
+		row = GetNextDirtyRowRun(gConvertDirtyRows, row + runRows, endRow, &runRows))
 	{
-		std::scoped_lock lock(gMutex);
-		TellMainThreadImReady(threadNum);
+		ConvertRows(threadNum, row, runRows);
 	}
+}
 
-	while (true)
+// Takes the first tile of our own share. Returns -1 if there's none left.
+static int TakeOwnTile(TileSpan* span)
+{
+	uint32_t s = span->nextAndEnd.load(std::memory_order_relaxed);
+
+	while (SpanNext(s) < SpanEnd(s))
 	{
-		// Wait on main to raise latch
+		if (span->nextAndEnd.compare_exchange_weak(s, PackSpan(SpanNext(s) + 1, SpanEnd(s)), std::memory_order_relaxed))
+			return SpanNext(s);
+	}
+
+	return -1;
+}
+
+// Takes the last tile of another worker's share. Returns -1 if everyone's done.
+static int StealTile(int threadNum)
+{
+	int numThreads = (int) gRenderThreadPool.size();
+
+	for (int i = 1; i < numThreads; i++)
+	{
+		TileSpan* victim = &gTileSpans[(threadNum + i) % numThreads];
+		uint32_t s = victim->nextAndEnd.load(std::memory_order_relaxed);
+
+		while (SpanNext(s) < SpanEnd(s))
 		{
-			std::unique_lock lock(gMutex);
+			if (victim->nextAndEnd.compare_exchange_weak(s, PackSpan(SpanNext(s), SpanEnd(s) - 1), std::memory_order_relaxed))
+				return SpanEnd(s) - 1;
+		}
+	}
+
+	return -1;
+}
+
+static void ConvertTiles(int threadNum)
+{
+	TileSpan* span = &gTileSpans[threadNum];
+	auto startTime = Clock::now();
+	uint64_t profileStart = gProfilerEnabled ? GetProfilerTime() : 0;
 
-			gMainToRenderers.wait(lock, [=] { return IsLatchRaised(threadNum); });
+	while (true)
+	{
+		int tile = TakeOwnTile(span);
 
-			if (gQuitRenderThreads)
+		if (tile < 0)
+		{
+			tile = StealTile(threadNum);
+			if (tile < 0)
 				break;
+			span->numStolen++;
 		}
 
-		// Do the work
+		int firstRow = tile * ROWS_PER_TILE;
+		int numRows = VISIBLE_HEIGHT - firstRow;
+		if (numRows > ROWS_PER_TILE)
+			numRows = ROWS_PER_TILE;
+
 		Convert(threadNum, firstRow, numRows);
+		span->numTiles++;
+	}
+
+	span->busyNanos += NanosSince(startTime);
+
+	if (gProfilerEnabled)
+		RecordProfilerSpan(kProfile_ConvertTiles, kProfileThread_FirstConverter + threadNum, profileStart);
+}
+
+// Spins, then parks until the main thread starts a new frame. Returns the new generation.
+static uint32_t WaitForNextFrame(int threadNum, uint32_t seenGeneration)
+{
+	auto spinStart = Clock::now();
 
-		// Tell main thread we're ready (lower latch)
+	while (gFrameGeneration.load(std::memory_order_acquire) == seenGeneration)
+	{
+		if (NanosSince(spinStart) < SPIN_BEFORE_PARK_NS)
+		{
+			CpuRelax();
+			continue;
+		}
+
+		// Announce that we're parked *before* checking the generation one last time (both seq_cst),
+		// so the main thread either sees us parked or we see its new generation.
+		std::unique_lock lock(gMutex);
+		gNumParkedRenderers++;
+		gTileSpans[threadNum].numParks++;
+		gMainToRenderers.wait(lock, [=] { return gFrameGeneration.load() != seenGeneration; });
+		gNumParkedRenderers--;
+	}
+
+	return gFrameGeneration.load(std::memory_order_acquire);
+}
+
+static void TellMainThreadImDone()
+{
+	// seq_cst: see WaitForAllRenderThreadsDone
+	if (1 == gNumBusyRenderers.fetch_sub(1))	// we were the last one
+	{
+		if (gMainParked.load())
 		{
 			std::scoped_lock lock(gMutex);
-			TellMainThreadImReady(threadNum);
+			gRenderersToMain.notify_one();
+		}
+	}
+}
+
+static void ConverterThread(int threadNum)
+{
+#if !_WIN32 && _GNU_SOURCE
+	char name[32];
+	snprintf(name, sizeof(name), "Renderer %02d", threadNum);
+	pthread_setname_np(pthread_self(), name);
+#endif
+
+	uint32_t generation = 0;
+
+	while (true)
+	{
+		generation = WaitForNextFrame(threadNum, generation);
+
+		if (gQuitRenderThreads.load(std::memory_order_acquire))
+			break;
+
+		ConvertTiles(threadNum);
+
+		TellMainThreadImDone();
+	}
+}
+
+static void WaitForAllRenderThreadsDone()
+{
+	auto spinStart = Clock::now();
+
+	while (gNumBusyRenderers.load(std::memory_order_acquire) != 0)
+	{
+		if (NanosSince(spinStart) < SPIN_BEFORE_PARK_NS)
+		{
+			CpuRelax();
+			continue;
 		}
+
+		// Same handshake as WaitForNextFrame, the other way around
+		std::unique_lock lock(gMutex);
+		gMainParked = true;
+		gRenderersToMain.wait(lock, [] { return gNumBusyRenderers.load() == 0; });
+		gMainParked = false;
 	}
+
+	gMainWaitNanos += NanosSince(spinStart);
 }
 
-static void WaitForAllRenderThreadsReady()
+static void StartRenderThreads()
 {
-	std::unique_lock lock(gMutex);
-	gRenderersToMain.wait(lock, [] { return gLatchMask == 0; });
-	lock.unlock();
+	gNumBusyRenderers.store((int) gRenderThreadPool.size(), std::memory_order_relaxed);
+	gFrameGeneration.fetch_add(1);		// seq_cst: see WaitForNextFrame
+
+	if (gNumParkedRenderers.load() > 0)
+	{
+		std::scoped_lock lock(gMutex);
+		gMainToRenderers.notify_all();
+	}
+}
+
+// Hands out an even share of the frame's tiles to each worker
+static void DealTiles()
+{
+	int numThreads = (int) gRenderThreadPool.size();
+	int numTiles = (VISIBLE_HEIGHT + ROWS_PER_TILE - 1) / ROWS_PER_TILE;
+	int tile = 0;
+
+	GAME_ASSERT(numTiles <= 0xFFFF);
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		int tilesThisThread = numTiles / numThreads + (i < numTiles % numThreads ? 1 : 0);
+		gTileSpans[i].nextAndEnd.store(PackSpan(tile, tile + tilesThisThread), std::memory_order_relaxed);
+		tile += tilesThisThread;
+	}
 }
 
 static void InitRenderThreadPool()
@@ -125,36 +340,41 @@ static void InitRenderThreadPool()
 	}
 
 	gQuitRenderThreads = false;
-	RaiseLatches();
-
-	int rowsPerThread = VISIBLE_HEIGHT / gNumThreads;
-	int remainder = VISIBLE_HEIGHT - rowsPerThread * gNumThreads;
-	int y = 0;
+	gFrameGeneration = 0;
 
 	for (int i = 0; i < gNumThreads; i++)
 	{
-		// Distribute number of rows as evenly as possible
-		int rowsThisThread = rowsPerThread;
-		if (remainder > 0)
-		{
-			rowsThisThread++;
-			remainder--;
-		}
+		gTileSpans[i].nextAndEnd = 0;
+		gTileSpans[i].busyNanos = 0;
+		gTileSpans[i].numTiles = 0;
+		gTileSpans[i].numStolen = 0;
+		gTileSpans[i].numParks = 0;
+	}
 
-		// Create thread
-		gRenderThreadPool.emplace_back(ConverterThread, i, y, rowsThisThread);
+	gNumFramesSinceReport = 0;
+	gMainWaitNanos = 0;
 
-		y += rowsThisThread;
+	for (int i = 0; i < gNumThreads; i++)
+	{
+		gRenderThreadPool.emplace_back(ConverterThread, i);
 	}
-
-	// Wait for all threads to be ready so they don't miss the condition when we start rendering
-	WaitForAllRenderThreadsReady();
 }
 
-void ConvertFramebufferMT(color_t* colorBuffer)
+// Snapshots everything the workers need from the main thread (see PrepareColorConversion)
+static void PrepareConversion(color_t* colorBuffer, const uint8_t* indexed, const uint8_t* dirtyRows)
 {
 	gFinalColor = colorBuffer;
+	gConvertDirtyRows = dirtyRows;
+	gConvertHeight = VISIBLE_HEIGHT;
+	gConvertX2 = gEffectiveScalingType == kScaling_HQStretch;
+	gConvertFilterDithering = gGamePrefs.filterDithering;
+	gConvertCopiesPlayfield = false;
 
+	PrepareColorConversion(indexed);
+}
+
+static void StartConversion()
+{
 	if (gNumThreads <= 1)	// single-threaded: do rendering on main thread
 	{
 		Convert(0, 0, VISIBLE_HEIGHT);
@@ -166,29 +386,158 @@ void ConvertFramebufferMT(color_t* colorBuffer)
 		InitRenderThreadPool();
 	}
 
+	DealTiles();
+	StartRenderThreads();
+	gFrameInFlight = true;
+}
+
+static void WaitForFrameInFlight()
+{
+	if (!gFrameInFlight)
 	{
-		std::scoped_lock lock(gMutex);
-		RaiseLatches();
-		gMainToRenderers.notify_all();
+		return;
+	}
+
+	WaitForAllRenderThreadsDone();
+	gFrameInFlight = false;
+	gNumFramesSinceReport++;
+}
+
+void ConvertFramebufferMT(color_t* colorBuffer)
+{
+	GAME_ASSERT_MESSAGE(!gFramePending, "Finish the pipelined frame before converting another one");
+
+	PrepareConversion(colorBuffer, gIndexedFramebuffer, gDirtyFramebufferRows);
+
+	if (gNumDirtyFramebufferRows == 0)	// nothing changed since last time
+	{
+		return;
+	}
+
+	gConvertCopiesPlayfield = IsPlayfieldCopyPending();
+
+	PROFILE_STAGE(kProfile_Convert, StartConversion(); WaitForFrameInFlight());
+
+	if (gConvertCopiesPlayfield)
+	{
+		MarkPlayfieldCopyDone();
+		gConvertCopiesPlayfield = false;
+	}
+}
+
+/****************** BEGIN CONVERT FRAMEBUFFER (PIPELINED) ********************/
+//
+// Copies the rows that changed since the last present, along with the palette,
+// and starts converting them into colorBuffer in the background.
+// The main thread may draw the next frame right away.
+// The renderer must call FinishConvertFramebufferMT before touching colorBuffer again.
+//
+
+void BeginConvertFramebufferMT(color_t* colorBuffer)
+{
+	GAME_ASSERT_MESSAGE(!gFramePending, "Finish the pipelined frame before starting another one");
+
+	if (gNumDirtyFramebufferRows == 0)	// nothing changed since last time
+	{
+		return;
+	}
+
+	auto latchStart = Clock::now();
+	uint64_t profileStart = gProfilerEnabled ? GetProfilerTime() : 0;
+
+	gLatchedFramebuffer.resize(VISIBLE_WIDTH * VISIBLE_HEIGHT);
+	gLatchedDirtyRows.assign(gDirtyFramebufferRows, gDirtyFramebufferRows + VISIBLE_HEIGHT);
+
+	int numRows = 0;
+	for (int row = GetNextDirtyFramebufferRun(0, VISIBLE_HEIGHT, &numRows);
+		row >= 0;
+		row = GetNextDirtyFramebufferRun(row + numRows, VISIBLE_HEIGHT, &numRows))
+	{
+		size_t offset = (size_t) row * VISIBLE_WIDTH;
+		memcpy(gLatchedFramebuffer.data() + offset, gIndexedFramebuffer + offset, (size_t) numRows * VISIBLE_WIDTH);
+	}
+
+	gFrameBeganAt = Clock::now();
+	gLatchNanos += NanosSince(latchStart);
+
+	if (gProfilerEnabled)
+		RecordProfilerSpan(kProfile_LatchFrame, kProfileThread_Main, profileStart);
+
+	PrepareConversion(colorBuffer, gLatchedFramebuffer.data(), gLatchedDirtyRows.data());
+	StartConversion();
+
+	gFramePending = true;
+}
+
+/****************** FINISH CONVERT FRAMEBUFFER (PIPELINED) ********************/
+//
+// Waits for the frame started by BeginConvertFramebufferMT.
+// Returns true if there was one; its rows can then be walked with GetNextConvertedRowRun.
+//
+
+Boolean FinishConvertFramebufferMT(void)
+{
+	if (!gFramePending)
+	{
+		return false;
 	}
 
-	WaitForAllRenderThreadsReady();
+	PROFILE_STAGE(kProfile_WaitForConvert, WaitForFrameInFlight());
+	gFramePending = false;
+
+	gPipelineLatencyNanos += NanosSince(gFrameBeganAt);
+	gNumPipelinedFramesSinceReport++;
+
+	return true;
+}
+
+/****************** CANCEL CONVERT FRAMEBUFFER (PIPELINED) ********************/
+//
+// Waits for the frame started by BeginConvertFramebufferMT and drops it.
+// Call this before freeing or resizing anything the converters read or write.
+// The whole screen gets converted again on the next present.
+//
+
+void CancelConvertFramebufferMT(void)
+{
+	if (FinishConvertFramebufferMT())
+	{
+		MarkDirtyFramebuffer();
+	}
+}
+
+/****************** GET NEXT CONVERTED ROW RUN ********************/
+//
+// Like GetNextDirtyFramebufferRun, but walks the rows that the last call to
+// ConvertFramebufferMT or FinishConvertFramebufferMT produced, for the renderer to upload.
+//
+
+int GetNextConvertedRowRun(int fromRow, int endRow, int* outNumRows)
+{
+	if (!gConvertDirtyRows)
+	{
+		*outNumRows = 0;
+		return -1;
+	}
+
+	if (endRow > gConvertHeight)
+		endRow = gConvertHeight;
+
+	return GetNextDirtyRowRun(gConvertDirtyRows, fromRow, endRow, outNumRows);
 }
 
 void ShutdownRenderThreads(void)
 {
+	CancelConvertFramebufferMT();
+
 	if (gRenderThreadPool.empty())
 	{
 		return;
 	}
 
 	// Tell all threads they need to quit
-	{
-		std::scoped_lock lock(gMutex);
-		gQuitRenderThreads = true;
-		RaiseLatches();
-		gMainToRenderers.notify_all();
-	}
+	gQuitRenderThreads = true;
+	StartRenderThreads();
 
 	// Wait on all threads
 	for (auto& t : gRenderThreadPool)
@@ -198,3 +547,60 @@ void ShutdownRenderThreads(void)
 
 	gRenderThreadPool.clear();
 }
+
+#if _DEBUG
+// Prints how busy each render thread has been since the last report, then resets the counters.
+// Must be called from the main thread.
+void ReportRenderThreadStats(void)
+{
+	int numThreads = (int) gRenderThreadPool.size();
+
+	WaitForFrameInFlight();		// the workers update their stats while they run
+
+	if (gNumPipelinedFramesSinceReport != 0)
+	{
+		double pipelinedFrames = gNumPipelinedFramesSinceReport;
+
+		printf("Pipelined present: %u frames, latch %.0f us/frame, conversion latency %.0f us/frame\n",
+				gNumPipelinedFramesSinceReport,
+				gLatchNanos / pipelinedFrames / 1000.0,
+				gPipelineLatencyNanos / pipelinedFrames / 1000.0);
+
+		gNumPipelinedFramesSinceReport = 0;
+		gLatchNanos = 0;
+		gPipelineLatencyNanos = 0;
+	}
+
+	if (numThreads == 0 || gNumFramesSinceReport == 0)
+	{
+		printf("Render threads: no multithreaded frames since last report\n");
+		return;
+	}
+
+	double frames = gNumFramesSinceReport;
+
+	printf("Render threads: %d threads, %u frames, %d rows per tile, main waited %.0f us/frame\n",
+			numThreads, gNumFramesSinceReport, ROWS_PER_TILE, gMainWaitNanos / frames / 1000.0);
+	printf("thread  busy us/frame  tiles/frame  stolen/frame  parks\n");
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		TileSpan* span = &gTileSpans[i];
+
+		printf("%6d  %13.1f  %11.2f  %12.2f  %5u\n",
+				i,
+				span->busyNanos / frames / 1000.0,
+				span->numTiles / frames,
+				span->numStolen / frames,
+				span->numParks);
+
+		span->busyNanos = 0;
+		span->numTiles = 0;
+		span->numStolen = 0;
+		span->numParks = 0;
+	}
+
+	gNumFramesSinceReport = 0;
+	gMainWaitNanos = 0;
+}
+#endif
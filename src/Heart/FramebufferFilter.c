@@ -4,93 +4,515 @@
 
 #include "externs.h"
 #include "framebufferfilter.h"
+#include "misc.h"
+#include "playfield.h"
+#include "simd.h"
 #include <string.h>
+#include <stdio.h>
 
-static inline void FilterDithering_Row(const uint8_t* indexedRow, uint8_t* rowSmearFlags);
+#if _MSC_VER
+	#include <intrin.h>
+#endif
 
-void IndexedFramebufferToColor_NoFilter(color_t* color, int firstRow, int numRows)
+#define MAX_DITHER_ROW_WORDS	32		// 64 pixels per word: rows up to 2048 pixels wide
+
+#pragma mark - Palette lookup kernels
+
+// Snapshot of the palette's final colors, taken on the main thread before the converter threads start.
+typedef struct
 {
-#ifndef __vita__
-	color						= color + firstRow * VISIBLE_WIDTH;
-#else	
-	color_t *start = color;
+	uint32_t		wide[256];			// final colors zero-extended to 32 bits (gather source)
+	uint8_t			planes[4][256];		// byte k of each final color (table-lookup source)
+	uint32_t		colors32[256];		// RGBA 8-8-8-8 colors, for dither smearing at any color depth
+	uint8_t			planes32[4][256];	// byte k (LSB first) of each RGBA color
+} ConversionLUT;
+
+typedef void (*ConvertRowFunc)(color_t* color, const uint8_t* indexed, int width, const ConversionLUT* lut);
+
+// Sets bit x of solidBits if pixel x has the same color as one of its neighbors,
+// and bit x of ditherBits if it doesn't but its two neighbors match each other.
+// Classifies pixels [from, to), where 'to' may be at most width-1. The bits must be cleared beforehand.
+typedef void (*ClassifyDitherPixelsFunc)(const uint8_t* row, int from, int to, uint64_t* solidBits, uint64_t* ditherBits);
+
+// Replaces flagged pixels 0..width-2 with the average of their color and their right neighbor's,
+// and clears the flags.
+typedef void (*SmearRowFunc)(color_t* color, const uint8_t* indexed, uint8_t* smearFlags, int width, const ConversionLUT* lut);
+
+static _Alignas(64) ConversionLUT gConversionLUT;
+static const uint8_t* gConversionSource = NULL;		// indexed pixels being converted (see PrepareColorConversion)
+
+static ConvertRowFunc gConvertRow = NULL;
+static ClassifyDitherPixelsFunc gClassifyDitherPixels = NULL;
+static SmearRowFunc gSmearRow = NULL;
+static const char* gConvertRowName = "";
+static const char* gClassifyDitherPixelsName = "";
+static const char* gSmearRowName = "";
+
+static void ConvertRow_Scalar(color_t* color, const uint8_t* indexed, int width, const ConversionLUT* lut)
+{
+	int x = 0;
+
+	for (; x + 4 <= width; x += 4)
+	{
+		color[x+0] = (color_t) lut->wide[indexed[x+0]];
+		color[x+1] = (color_t) lut->wide[indexed[x+1]];
+		color[x+2] = (color_t) lut->wide[indexed[x+2]];
+		color[x+3] = (color_t) lut->wide[indexed[x+3]];
+	}
+
+	for (; x < width; x++)
+	{
+		color[x] = (color_t) lut->wide[indexed[x]];
+	}
+}
+
+#if SIMD_X86
+SIMD_TARGET("avx2")
+static void ConvertRow_AVX2(color_t* color, const uint8_t* indexed, int width, const ConversionLUT* lut)
+{
+	const int* table = (const int*) lut->wide;
+	int x = 0;
+
+#if FRAMEBUFFER_COLOR_DEPTH == 32
+	for (; x + 8 <= width; x += 8)
+	{
+		__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (indexed + x)));
+		__m256i c = _mm256_i32gather_epi32(table, idx, 4);
+		_mm256_storeu_si256((__m256i*) (color + x), c);
+	}
+#else
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i idx16 = _mm_loadu_si128((const __m128i*) (indexed + x));
+		__m256i lo = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(idx16), 4);
+		__m256i hi = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(idx16, 8)), 4);
+		__m256i c = _mm256_packus_epi32(lo, hi);					// per-lane pack: lo0-3 hi0-3 | lo4-7 hi4-7
+		c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(3, 1, 2, 0));	// restore pixel order
+		_mm256_storeu_si256((__m256i*) (color + x), c);
+	}
 #endif
-	const uint8_t* indexed		= gIndexedFramebuffer + firstRow * VISIBLE_WIDTH;
 
-	for (int y = 0; y < numRows; y++)
+	ConvertRow_Scalar(color + x, indexed + x, width - x, lut);
+}
+#endif
+
+#if SIMD_NEON_A64
+static inline uint8x16_t Lookup256_NEON(const uint8_t* plane, uint8x16_t idx)
+{
+	// TBL zeroes out-of-range lanes and TBX leaves them alone,
+	// so four 64-byte lookups on rebased indices cover the whole palette.
+	const uint8x16_t k64 = vdupq_n_u8(64);
+	uint8x16_t r = vqtbl4q_u8(vld1q_u8_x4(plane), idx);
+	idx = vsubq_u8(idx, k64);
+	r = vqtbx4q_u8(r, vld1q_u8_x4(plane + 64), idx);
+	idx = vsubq_u8(idx, k64);
+	r = vqtbx4q_u8(r, vld1q_u8_x4(plane + 128), idx);
+	idx = vsubq_u8(idx, k64);
+	r = vqtbx4q_u8(r, vld1q_u8_x4(plane + 192), idx);
+	return r;
+}
+
+static void ConvertRow_NEON(color_t* color, const uint8_t* indexed, int width, const ConversionLUT* lut)
+{
+	int x = 0;
+
+	for (; x + 16 <= width; x += 16)
 	{
-#ifdef __vita__
-		color						= start + (firstRow + y) * 1024;
+		uint8x16_t idx = vld1q_u8(indexed + x);
+#if FRAMEBUFFER_COLOR_DEPTH == 32
+		uint8x16x4_t c;
+		c.val[0] = Lookup256_NEON(lut->planes[0], idx);
+		c.val[1] = Lookup256_NEON(lut->planes[1], idx);
+		c.val[2] = Lookup256_NEON(lut->planes[2], idx);
+		c.val[3] = Lookup256_NEON(lut->planes[3], idx);
+		vst4q_u8((uint8_t*) (color + x), c);
+#else
+		uint8x16x2_t c;
+		c.val[0] = Lookup256_NEON(lut->planes[0], idx);
+		c.val[1] = Lookup256_NEON(lut->planes[1], idx);
+		vst2q_u8((uint8_t*) (color + x), c);
 #endif
-		for (int x = 0; x < VISIBLE_WIDTH; x++)
+	}
+
+	ConvertRow_Scalar(color + x, indexed + x, width - x, lut);
+}
+#endif
+
+static void FillConversionLUT(ConversionLUT* lut, const GamePalette* palette)
+{
+	for (int i = 0; i < 256; i++)
+	{
+		color_t c = palette->finalColorsXX[i];
+		lut->wide[i] = c;
+
+		for (int k = 0; k < (int) sizeof(color_t); k++)
 		{
-			*(color++) = gGamePalette.finalColorsXX[*(indexed++)];
+			lut->planes[k][i] = ((const uint8_t*) &c)[k];
+		}
+
+		uint32_t c32 = palette->finalColors32[i];
+		lut->colors32[i] = c32;
+
+		for (int k = 0; k < 4; k++)
+		{
+			lut->planes32[k][i] = (uint8_t) (c32 >> (8 * k));
 		}
 	}
 }
 
-void IndexedFramebufferToColor_FilterDithering(color_t* color, int threadNum, int firstRow, int numRows)
+#pragma mark - Dither detection kernels
+
+static inline int LowestSetBit(uint64_t v)
 {
-#ifndef __vita__
-	color						= color + firstRow * VISIBLE_WIDTH;
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(v);
+#elif _MSC_VER && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long i;
+	_BitScanForward64(&i, v);
+	return (int) i;
 #else
-	color_t *start = color;
+	int i = 0;
+	while (!(v & 1)) { v >>= 1; i++; }
+	return i;
 #endif
-	const uint8_t* indexed		= gIndexedFramebuffer + firstRow * VISIBLE_WIDTH;
-	uint8_t* smearFlags			= gRowDitherStrides + threadNum * VISIBLE_WIDTH;
+}
 
-#if __BIG_ENDIAN__
-	static const int RI = 0, GI = 1, BI = 2;
+static inline int HighestSetBit(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return 63 - __builtin_clzll(v);
+#elif _MSC_VER && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long i;
+	_BitScanReverse64(&i, v);
+	return (int) i;
 #else
-	static const int RI = 3, GI = 2, BI = 1;
+	int i = 63;
+	while (!(v >> 63)) { v <<= 1; i--; }
+	return i;
 #endif
+}
 
-	for (int y = 0; y < numRows; y++)
+// Index of the first set bit in [from, end), or end if there is none
+static inline int NextSetBit(const uint64_t* words, int from, int end)
+{
+	while (from < end)
 	{
-#ifdef __vita__
-		color						= start + (firstRow + y) * 1024;
-#endif
-		FilterDithering_Row(indexed, smearFlags);
+		uint64_t bits = words[from >> 6] >> (from & 63);
+		if (bits)
+		{
+			int x = from + LowestSetBit(bits);
+			return x < end ? x : end;
+		}
+		from = (from | 63) + 1;
+	}
+	return end;
+}
 
-		for (int x = 0; x < VISIBLE_WIDTH-1; x++)
+// Index of the first clear bit in [from, end), or end if there is none
+static inline int NextClearBit(const uint64_t* words, int from, int end)
+{
+	while (from < end)
+	{
+		uint64_t bits = ~words[from >> 6] >> (from & 63);
+		if (bits)
 		{
-			if (smearFlags[x])
-			{
-				uint8_t* left32		= (uint8_t*) &gGamePalette.finalColors32[indexed[0]];
-				uint8_t* right32	= (uint8_t*) &gGamePalette.finalColors32[indexed[1]];
+			int x = from + LowestSetBit(bits);
+			return x < end ? x : end;
+		}
+		from = (from | 63) + 1;
+	}
+	return end;
+}
 
-				uint16_t rmix8 = (left32[RI] + right32[RI]) >> 1;
-				uint16_t gmix8 = (left32[GI] + right32[GI]) >> 1;
-				uint16_t bmix8 = (left32[BI] + right32[BI]) >> 1;
+// Index of the last set bit at or before 'from' (there must be one)
+static inline int PrevSetBit(const uint64_t* words, int from)
+{
+	int w = from >> 6;
+	uint64_t bits = words[w] & (~0ull >> (63 - (from & 63)));
+	while (!bits)
+	{
+		bits = words[--w];
+	}
+	return (w << 6) + HighestSetBit(bits);
+}
 
-#if FRAMEBUFFER_COLOR_DEPTH == 16
-				*color = (bmix8 >> 3) | ((gmix8 >> 2) << 5) | ((rmix8 >> 3) << 11);
-#elif FRAMEBUFFER_COLOR_DEPTH == 32
-				((uint8_t*)color)[RI] = rmix8;
-				((uint8_t*)color)[GI] = gmix8;
-				((uint8_t*)color)[BI] = bmix8;
-#else
-				_Static_assert(false, "unsupported framebuffer color depth");
+static void ClassifyDitherPixelRange(const uint8_t* row, int from, int to, uint64_t* solidBits, uint64_t* ditherBits)
+{
+	int prev	= from > 0 ? row[from-1] : -1;
+	int me		= row[from];
+
+	for (int x = from; x < to; x++)
+	{
+		int next = row[x+1];
+
+		uint64_t solid	= (me == next) | (me == prev);
+		uint64_t dither	= (prev == next) & !solid;
+
+		solidBits[x >> 6]	|= solid << (x & 63);
+		ditherBits[x >> 6]	|= dither << (x & 63);
+
+		prev = me;
+		me = next;
+	}
+}
+
+static void ClassifyDitherPixels_Scalar(const uint8_t* row, int from, int to, uint64_t* solidBits, uint64_t* ditherBits)
+{
+	ClassifyDitherPixelRange(row, from, to, solidBits, ditherBits);
+}
+
+// First pixel of the vectorized part of [from, to): chunk-aligned so that no chunk straddles
+// two words, and past pixel 0, which has no left neighbor.
+static inline int GetFirstDitherChunk(int from, int to, int chunkSize)
+{
+	int x = (from + chunkSize - 1) & ~(chunkSize - 1);
+	if (x < chunkSize)
+		x = chunkSize;
+	return x < to ? x : to;
+}
+
+#if SIMD_X86
+SIMD_TARGET("sse2")
+static void ClassifyDitherPixels_SSE2(const uint8_t* row, int from, int to, uint64_t* solidBits, uint64_t* ditherBits)
+{
+	int x = GetFirstDitherChunk(from, to, 16);
+	ClassifyDitherPixelRange(row, from, x, solidBits, ditherBits);
+
+	for (; x + 16 <= to; x += 16)
+	{
+		__m128i prev = _mm_loadu_si128((const __m128i*) (row + x - 1));
+		__m128i me   = _mm_loadu_si128((const __m128i*) (row + x));
+		__m128i next = _mm_loadu_si128((const __m128i*) (row + x + 1));
+
+		__m128i solid  = _mm_or_si128(_mm_cmpeq_epi8(me, next), _mm_cmpeq_epi8(me, prev));
+		__m128i dither = _mm_andnot_si128(solid, _mm_cmpeq_epi8(prev, next));
+
+		solidBits[x >> 6]	|= (uint64_t) (uint16_t) _mm_movemask_epi8(solid) << (x & 63);
+		ditherBits[x >> 6]	|= (uint64_t) (uint16_t) _mm_movemask_epi8(dither) << (x & 63);
+	}
+
+	ClassifyDitherPixelRange(row, x, to, solidBits, ditherBits);
+}
+
+SIMD_TARGET("avx2")
+static void ClassifyDitherPixels_AVX2(const uint8_t* row, int from, int to, uint64_t* solidBits, uint64_t* ditherBits)
+{
+	int x = GetFirstDitherChunk(from, to, 32);
+	ClassifyDitherPixelRange(row, from, x, solidBits, ditherBits);
+
+	for (; x + 32 <= to; x += 32)
+	{
+		__m256i prev = _mm256_loadu_si256((const __m256i*) (row + x - 1));
+		__m256i me   = _mm256_loadu_si256((const __m256i*) (row + x));
+		__m256i next = _mm256_loadu_si256((const __m256i*) (row + x + 1));
+
+		__m256i solid  = _mm256_or_si256(_mm256_cmpeq_epi8(me, next), _mm256_cmpeq_epi8(me, prev));
+		__m256i dither = _mm256_andnot_si256(solid, _mm256_cmpeq_epi8(prev, next));
+
+		solidBits[x >> 6]	|= (uint64_t) (uint32_t) _mm256_movemask_epi8(solid) << (x & 63);
+		ditherBits[x >> 6]	|= (uint64_t) (uint32_t) _mm256_movemask_epi8(dither) << (x & 63);
+	}
+
+	ClassifyDitherPixelRange(row, x, to, solidBits, ditherBits);
+}
 #endif
 
-				smearFlags[x] = 0;			// clear for next row
-			}
-			else
+#if SIMD_NEON
+static inline uint64_t MoveMask_NEON(uint8x16_t v)
+{
+	// Keep one distinct bit per byte, then fold each half into a single byte
+	static const uint8_t kBitWeights[16] = { 1,2,4,8,16,32,64,128, 1,2,4,8,16,32,64,128 };
+	uint8x16_t bits = vandq_u8(v, vld1q_u8(kBitWeights));
+	uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(bits)));
+	return vgetq_lane_u64(sums, 0) | (vgetq_lane_u64(sums, 1) << 8);
+}
+
+static void ClassifyDitherPixels_NEON(const uint8_t* row, int from, int to, uint64_t* solidBits, uint64_t* ditherBits)
+{
+	int x = GetFirstDitherChunk(from, to, 16);
+	ClassifyDitherPixelRange(row, from, x, solidBits, ditherBits);
+
+	for (; x + 16 <= to; x += 16)
+	{
+		uint8x16_t prev = vld1q_u8(row + x - 1);
+		uint8x16_t me   = vld1q_u8(row + x);
+		uint8x16_t next = vld1q_u8(row + x + 1);
+
+		uint8x16_t solid  = vorrq_u8(vceqq_u8(me, next), vceqq_u8(me, prev));
+		uint8x16_t dither = vbicq_u8(vceqq_u8(prev, next), solid);
+
+		solidBits[x >> 6]	|= MoveMask_NEON(solid) << (x & 63);
+		ditherBits[x >> 6]	|= MoveMask_NEON(dither) << (x & 63);
+	}
+
+	ClassifyDitherPixelRange(row, x, to, solidBits, ditherBits);
+}
+#endif
+
+/****************** FILTER DITHERING: ROW ********************/
+//
+// Flags the pixels that the dithering filter should smear into their right neighbor.
+//
+// A dither stride starts on a pixel whose neighbors match each other but not itself.
+// It goes on through such pixels, and through a single other pixel right after one of them,
+// until it reaches a pixel that matches a neighbor, or two such "other" pixels in a row.
+// Strides containing at least two dither pixels get flagged, plus a pixel of bleed on each side.
+//
+// This gives exactly the same flags as the original per-pixel state machine
+// (FilterDithering_Row_Reference), but it only visits the strides themselves.
+//
+// knownBits (optional) marks pixels whose flags are already known (see FindTileDitherStrides).
+// Those pixels are skipped, and the flags in knownSmearBits are used instead.
+//
+
+static void FilterDithering_Row(const uint8_t* indexedRow, int width, uint8_t* rowSmearFlags,
+		const uint64_t* knownBits, const uint64_t* knownSmearBits)
+{
+	uint64_t solidBits[MAX_DITHER_ROW_WORDS];
+	uint64_t ditherBits[MAX_DITHER_ROW_WORDS];
+	uint64_t breakBits[MAX_DITHER_ROW_WORDS];
+
+	const int end = width - 1;			// pixels 0..width-2 get classified
+	const int numWords = (width + 63) >> 6;
+
+	memset(solidBits, 0, numWords * sizeof(uint64_t));
+	memset(ditherBits, 0, numWords * sizeof(uint64_t));
+
+			/* CLASSIFY PIXELS */
+
+	if (!knownBits)
+	{
+		gClassifyDitherPixels(indexedRow, 0, end, solidBits, ditherBits);
+	}
+	else
+	{
+		// A known span is always bounded by pixels that end a stride,
+		// so leaving it unclassified makes it look like a solid area to the stride walk below,
+		// and no stride can cross it.
+		int x = 0;
+		while ((x = NextClearBit(knownBits, x, end)) < end)
+		{
+			int knownStart = NextSetBit(knownBits, x, end);
+			gClassifyDitherPixels(indexedRow, x, knownStart, solidBits, ditherBits);
+			x = knownStart;
+		}
+	}
+
+			/* FIND PIXELS THAT END A STRIDE */
+
+	uint64_t carry = 0;
+
+	for (int w = 0; w < numWords; w++)
+	{
+		uint64_t ditherOrAfterDither = ditherBits[w] | (ditherBits[w] << 1) | carry;
+		breakBits[w] = solidBits[w] | ~ditherOrAfterDither;
+		carry = ditherBits[w] >> 63;
+	}
+
+			/* FLAG STRIDES */
+
+	int x = 0;
+	while ((x = NextSetBit(ditherBits, x, end)) < end)
+	{
+		int first	= x;
+		int stop	= NextSetBit(breakBits, first + 1, end);
+		int last	= PrevSetBit(ditherBits, stop - 1);
+
+		if (last > first)
+		{
+			memset(rowSmearFlags + first - 1, 1, last - first + 3);
+		}
+
+		x = stop + 1;					// the pixel that ended the stride can't start the next one
+	}
+
+			/* FLAG STRIDES INSIDE KNOWN SPANS */
+
+	if (knownSmearBits)
+	{
+		x = 0;
+		while ((x = NextSetBit(knownSmearBits, x, width)) < width)
+		{
+			int runEnd = NextClearBit(knownSmearBits, x, width);
+			memset(rowSmearFlags + x, 1, runEnd - x);
+			x = runEnd;
+		}
+	}
+}
+
+/****************** FIND TILE DITHER STRIDES ********************/
+//
+// Precomputes the smear flags of each row of a 32x32 tile, for the pixels whose flags
+// don't depend on what's drawn left or right of the tile.
+//
+// Those are the pixels strictly between the first and last stride-ending pixels
+// that can be told apart from the tile alone. Only strides that start after the first
+// such pixel are flagged (the bleed may reach onto the boundary pixels themselves).
+//
+
+void FindTileDitherStrides(const uint8_t* tilePixels, TileDitherRow* rows)
+{
+	for (int y = 0; y < 32; y++)
+	{
+		const uint8_t* row = tilePixels + y * 32;
+		uint64_t solidBits = 0;
+		uint64_t ditherBits = 0;
+		uint8_t flags[32];
+
+		ClassifyDitherPixelRange(row, 0, 31, &solidBits, &ditherBits);
+
+				/* FIND OUTERMOST STRIDE-ENDING PIXELS */
+
+		// Pixels 0 and 31 are missing a neighbor, so only pixels 1..30 can be classified for sure.
+		// A pixel that isn't a dither pixel ends a stride if it matches a neighbor,
+		// or if the pixel before it isn't a dither pixel either.
+		uint64_t breaks = solidBits | ~(ditherBits | (ditherBits << 1));
+		breaks &= 0x7FFFFFFEull & ~ditherBits;		// pixels 1..30
+		breaks &= ~2ull | solidBits;				// pixel 1 can only end a stride by matching a neighbor
+
+		rows[y].known = 0;
+		rows[y].smear = 0;
+
+		if (!breaks)
+			continue;
+
+		int firstBreak	= LowestSetBit(breaks);
+		int lastBreak	= HighestSetBit(breaks);
+
+		if (lastBreak - firstBreak < 2)
+			continue;
+
+				/* FLAG STRIDES BETWEEN THEM */
+
+		memset(flags, 0, sizeof(flags));
+
+		uint64_t strideStarts = ditherBits & ~((2ull << firstBreak) - 1) & ((1ull << lastBreak) - 1);
+
+		while (strideStarts)
+		{
+			int first	= LowestSetBit(strideStarts);
+			int stop	= first + 1 + LowestSetBit(breaks >> (first + 1));		// lastBreak is past first, so there's one
+			int last	= HighestSetBit(ditherBits & ((1ull << stop) - 1));
+
+			if (last > first)
 			{
-				*color = gGamePalette.finalColorsXX[*indexed];
+				memset(flags + first - 1, 1, last - first + 3);
 			}
 
-			color++;
-			indexed++;
+			strideStarts &= ~((2ull << stop) - 1);			// the pixel that ended the stride can't start the next one
 		}
 
-		*color = gGamePalette.finalColorsXX[*indexed];		// last
-		color++;
-		indexed++;
+		for (int i = firstBreak; i <= lastBreak; i++)
+		{
+			rows[y].smear |= (uint32_t) flags[i] << i;
+		}
+
+		rows[y].known = (uint32_t) (((1ull << lastBreak) - 1) & ~((2ull << firstBreak) - 1));
 	}
 }
 
-static inline void FilterDithering_Row(const uint8_t* indexedRow, uint8_t* rowSmearFlags)
+#if _DEBUG
+static void FilterDithering_Row_Reference(const uint8_t* indexedRow, int width, uint8_t* rowSmearFlags)
 {
 	static const int THRESH = 2;
 	static const int BLEED = 1;
@@ -109,7 +531,7 @@ static inline void FilterDithering_Row(const uint8_t* indexedRow, uint8_t* rowSm
 		memset(rowSmearFlags+ditherStart, 1, ditherLength+BLEED);			\
 	} while(0)
 
-	for (int x = 0; x < VISIBLE_WIDTH-1; x++)
+	for (int x = 0; x < width-1; x++)
 	{
 		next = indexedRow[x+1];
 
@@ -143,6 +565,262 @@ static inline void FilterDithering_Row(const uint8_t* indexedRow, uint8_t* rowSm
 
 #undef COMMIT_STRIDE
 }
+#endif
+
+#pragma mark - Dither smearing kernels
+
+// Average of two RGBA colors, rounded down in each channel, at the framebuffer's color depth
+static inline color_t MixColors(uint32_t left, uint32_t right)
+{
+	uint32_t mix = (left & right) + (((left ^ right) >> 1) & 0x7F7F7F7F);
+
+#if FRAMEBUFFER_COLOR_DEPTH == 16
+	return (color_t) (((mix >> 11) & 0x001F) | ((mix >> 13) & 0x07E0) | ((mix >> 16) & 0xF800));
+#else
+	return mix;
+#endif
+}
+
+static void SmearRow_Scalar(color_t* color, const uint8_t* indexed, uint8_t* smearFlags, int width, const ConversionLUT* lut)
+{
+	for (int x = 0; x < width-1; x++)
+	{
+		if (smearFlags[x])
+		{
+			color[x] = MixColors(lut->colors32[indexed[x]], lut->colors32[indexed[x+1]]);
+			smearFlags[x] = 0;			// clear for next row
+		}
+	}
+}
+
+#if SIMD_X86
+SIMD_TARGET("avx2")
+static void SmearRow_AVX2(color_t* color, const uint8_t* indexed, uint8_t* smearFlags, int width, const ConversionLUT* lut)
+{
+	const __m256i kLow7 = _mm256_set1_epi8(0x7F);
+	int x = 0;
+
+	for (; x + 8 < width; x += 8)
+	{
+		__m128i flags = _mm_loadl_epi64((const __m128i*) (smearFlags + x));
+		if (_mm_testz_si128(flags, flags))
+			continue;
+
+#if FRAMEBUFFER_COLOR_DEPTH == 32
+		// The row already holds the unfiltered colors, and pixel x+8 isn't touched until the next chunk
+		__m256i left  = _mm256_loadu_si256((const __m256i*) (color + x));
+		__m256i right = _mm256_loadu_si256((const __m256i*) (color + x + 1));
+#else
+		const int* table = (const int*) lut->colors32;
+		__m256i left  = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (indexed + x))), 4);
+		__m256i right = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (indexed + x + 1))), 4);
+#endif
+
+		__m256i mix = _mm256_add_epi32(
+				_mm256_and_si256(left, right),
+				_mm256_and_si256(_mm256_srli_epi32(_mm256_xor_si256(left, right), 1), kLow7));
+
+#if FRAMEBUFFER_COLOR_DEPTH == 32
+		__m256i smear = _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(flags), _mm256_setzero_si256());
+		_mm256_storeu_si256((__m256i*) (color + x), _mm256_blendv_epi8(left, mix, smear));
+#else
+		__m256i c565 = _mm256_or_si256(
+				_mm256_or_si256(
+					_mm256_and_si256(_mm256_srli_epi32(mix, 11), _mm256_set1_epi32(0x001F)),
+					_mm256_and_si256(_mm256_srli_epi32(mix, 13), _mm256_set1_epi32(0x07E0))),
+				_mm256_and_si256(_mm256_srli_epi32(mix, 16), _mm256_set1_epi32(0xF800)));
+		c565 = _mm256_permute4x64_epi64(_mm256_packus_epi32(c565, c565), _MM_SHUFFLE(3, 1, 2, 0));
+
+		__m128i smear = _mm_cmpgt_epi16(_mm_cvtepu8_epi16(flags), _mm_setzero_si128());
+		__m128i plain = _mm_loadu_si128((const __m128i*) (color + x));
+		_mm_storeu_si128((__m128i*) (color + x), _mm_blendv_epi8(plain, _mm256_castsi256_si128(c565), smear));
+#endif
+
+		_mm_storel_epi64((__m128i*) (smearFlags + x), _mm_setzero_si128());
+	}
+
+	SmearRow_Scalar(color + x, indexed + x, smearFlags + x, width - x, lut);
+}
+#endif
+
+#if SIMD_NEON_A64
+static void SmearRow_NEON(color_t* color, const uint8_t* indexed, uint8_t* smearFlags, int width, const ConversionLUT* lut)
+{
+	int x = 0;
+
+	for (; x + 16 < width; x += 16)
+	{
+		uint8x16_t flags = vld1q_u8(smearFlags + x);
+		if (vmaxvq_u8(flags) == 0)
+			continue;
+
+		uint8x16_t smear = vtstq_u8(flags, flags);
+		uint8x16_t left  = vld1q_u8(indexed + x);
+		uint8x16_t right = vld1q_u8(indexed + x + 1);
+
+		// Halving adds round down, like MixColors
+		uint8x16_t b = vhaddq_u8(Lookup256_NEON(lut->planes32[1], left), Lookup256_NEON(lut->planes32[1], right));
+		uint8x16_t g = vhaddq_u8(Lookup256_NEON(lut->planes32[2], left), Lookup256_NEON(lut->planes32[2], right));
+		uint8x16_t r = vhaddq_u8(Lookup256_NEON(lut->planes32[3], left), Lookup256_NEON(lut->planes32[3], right));
+
+#if FRAMEBUFFER_COLOR_DEPTH == 32
+		uint8x16_t a = vhaddq_u8(Lookup256_NEON(lut->planes32[0], left), Lookup256_NEON(lut->planes32[0], right));
+		uint8x16x4_t c = vld4q_u8((const uint8_t*) (color + x));		// RGBA 8-8-8-8 is ABGR in memory
+		c.val[0] = vbslq_u8(smear, a, c.val[0]);
+		c.val[1] = vbslq_u8(smear, b, c.val[1]);
+		c.val[2] = vbslq_u8(smear, g, c.val[2]);
+		c.val[3] = vbslq_u8(smear, r, c.val[3]);
+		vst4q_u8((uint8_t*) (color + x), c);
+#else
+		r = vshrq_n_u8(r, 3);
+		g = vshrq_n_u8(g, 2);
+		b = vshrq_n_u8(b, 3);
+
+		uint16x8_t lo = vorrq_u16(vorrq_u16(
+				vshlq_n_u16(vmovl_u8(vget_low_u8(r)), 11),
+				vshlq_n_u16(vmovl_u8(vget_low_u8(g)), 5)),
+				vmovl_u8(vget_low_u8(b)));
+		uint16x8_t hi = vorrq_u16(vorrq_u16(
+				vshlq_n_u16(vmovl_u8(vget_high_u8(r)), 11),
+				vshlq_n_u16(vmovl_u8(vget_high_u8(g)), 5)),
+				vmovl_u8(vget_high_u8(b)));
+
+		uint16x8_t smearLo = vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(vget_low_u8(smear))));
+		uint16x8_t smearHi = vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(vget_high_u8(smear))));
+
+		vst1q_u16(color + x,     vbslq_u16(smearLo, lo, vld1q_u16(color + x)));
+		vst1q_u16(color + x + 8, vbslq_u16(smearHi, hi, vld1q_u16(color + x + 8)));
+#endif
+
+		vst1q_u8(smearFlags + x, vdupq_n_u8(0));
+	}
+
+	SmearRow_Scalar(color + x, indexed + x, smearFlags + x, width - x, lut);
+}
+#endif
+
+#pragma mark - Kernel selection
+
+static void PickColorConversionKernels(void)
+{
+	gConvertRow					= ConvertRow_Scalar;
+	gClassifyDitherPixels		= ClassifyDitherPixels_Scalar;
+	gSmearRow					= SmearRow_Scalar;
+	gConvertRowName				= "scalar";
+	gClassifyDitherPixelsName	= "scalar";
+	gSmearRowName				= "scalar";
+
+#if SIMD_X86
+	if (SDL_HasSSE2())
+	{
+		gClassifyDitherPixels		= ClassifyDitherPixels_SSE2;
+		gClassifyDitherPixelsName	= "sse2";
+	}
+
+	if (SDL_HasAVX2())
+	{
+		gConvertRow					= ConvertRow_AVX2;
+		gClassifyDitherPixels		= ClassifyDitherPixels_AVX2;
+		gSmearRow					= SmearRow_AVX2;
+		gConvertRowName				= "avx2";
+		gClassifyDitherPixelsName	= "avx2";
+		gSmearRowName				= "avx2";
+	}
+#elif SIMD_NEON
+	gClassifyDitherPixels		= ClassifyDitherPixels_NEON;
+	gClassifyDitherPixelsName	= "neon";
+	#if SIMD_NEON_A64
+	gConvertRow					= ConvertRow_NEON;
+	gSmearRow					= SmearRow_NEON;
+	gConvertRowName				= "neon";
+	gSmearRowName				= "neon";
+	#endif
+#endif
+
+	SDL_Log("Palette lookup: %s; dither detection: %s; dither smearing: %s",
+			gConvertRowName, gClassifyDitherPixelsName, gSmearRowName);
+}
+
+/****************** PREPARE COLOR CONVERSION ********************/
+//
+// Must be called on the main thread before converting any rows in a frame.
+// Snapshots the palette and the playfield's dither cache, so the converter threads
+// may keep working on indexedFramebuffer while the main thread moves on to the next frame.
+//
+
+void PrepareColorConversion(const uint8_t* indexedFramebuffer)
+{
+	if (!gConvertRow)
+	{
+		PickColorConversionKernels();
+	}
+
+	GAME_ASSERT(VISIBLE_WIDTH <= 64 * MAX_DITHER_ROW_WORDS);
+
+	gConversionSource = indexedFramebuffer;
+
+	FillConversionLUT(&gConversionLUT, &gGamePalette);
+
+	LatchPlayfieldDitherCache();
+}
+
+#pragma mark - Filters
+
+void IndexedFramebufferToColor_NoFilter(color_t* color, int firstRow, int numRows)
+{
+#ifndef __vita__
+	color						= color + firstRow * VISIBLE_WIDTH;
+#else	
+	color_t *start = color;
+#endif
+	const uint8_t* indexed		= gConversionSource + firstRow * VISIBLE_WIDTH;
+
+	for (int y = 0; y < numRows; y++)
+	{
+#ifdef __vita__
+		color						= start + (firstRow + y) * 1024;
+#endif
+		gConvertRow(color, indexed, VISIBLE_WIDTH, &gConversionLUT);
+
+		indexed += VISIBLE_WIDTH;
+#ifndef __vita__
+		color += VISIBLE_WIDTH;
+#endif
+	}
+}
+
+void IndexedFramebufferToColor_FilterDithering(color_t* color, int threadNum, int firstRow, int numRows)
+{
+#ifndef __vita__
+	color						= color + firstRow * VISIBLE_WIDTH;
+#else
+	color_t *start = color;
+#endif
+	const uint8_t* indexed		= gConversionSource + firstRow * VISIBLE_WIDTH;
+	uint8_t* smearFlags			= gRowDitherStrides + threadNum * VISIBLE_WIDTH;
+
+	uint64_t knownBits[MAX_DITHER_ROW_WORDS];
+	uint64_t knownSmearBits[MAX_DITHER_ROW_WORDS];
+
+	for (int y = 0; y < numRows; y++)
+	{
+#ifdef __vita__
+		color						= start + (firstRow + y) * 1024;
+#endif
+		if (GetPlayfieldRowDitherCache(firstRow + y, knownBits, knownSmearBits))	// reuse tile strides
+			FilterDithering_Row(indexed, VISIBLE_WIDTH, smearFlags, knownBits, knownSmearBits);
+		else
+			FilterDithering_Row(indexed, VISIBLE_WIDTH, smearFlags, NULL, NULL);
+
+		gConvertRow(color, indexed, VISIBLE_WIDTH, &gConversionLUT);
+		gSmearRow(color, indexed, smearFlags, VISIBLE_WIDTH, &gConversionLUT);
+
+		indexed += VISIBLE_WIDTH;
+#ifndef __vita__
+		color += VISIBLE_WIDTH;
+#endif
+	}
+}
 
 void DoublePixels(const color_t* colorx1, color_t* colorx2, int firstRow, int numRows)
 {
@@ -164,3 +842,330 @@ void DoublePixels(const color_t* colorx1, color_t* colorx2, int firstRow, int nu
 		colorx2 += VISIBLE_WIDTH * 2;
 	}
 }
+
+#pragma mark - Benchmark
+
+#if _DEBUG
+
+/****************** BENCHMARK COLOR CONVERSION ********************/
+//
+// Checks every palette lookup and dithering kernel available on this CPU
+// against the scalar/original code, then times full-frame conversions
+// at each resolution the PFSIZE_* settings use.
+// Results go to stdout.
+//
+
+enum { kBenchMaxWidth = 832, kBenchMaxHeight = 480, kBenchNumPasses = 50 };
+
+// Visible area at each PFSIZE_* setting (see OnChangePlayfieldSize).
+// Small and medium both show 640x480, so they share a row.
+static const struct { const char* name; int width; int height; } kBenchSizes[] =
+{
+	{ "sm/med",	640,	480 },
+	{ "wide",	832,	480 },
+};
+
+typedef struct
+{
+	const char*			name;
+	ConvertRowFunc		func;
+	int					supported;
+} ConvertRowBenchEntry;
+
+typedef struct
+{
+	const char*					name;
+	ClassifyDitherPixelsFunc	classify;
+	SmearRowFunc				smear;
+	int							supported;
+} DitherBenchEntry;
+
+static void BenchmarkDitheringFilter(const ConversionLUT* lut);
+
+void BenchmarkColorConversion(void)
+{
+	// The active kernels get swapped out below, so no frame may be converting in the background
+	CancelConvertFramebufferMT();
+
+	ConvertRowBenchEntry entries[] =
+	{
+		{ "scalar",	ConvertRow_Scalar,	1 },
+#if SIMD_X86
+		{ "avx2",	ConvertRow_AVX2,	SDL_HasAVX2() },
+#elif SIMD_NEON_A64
+		{ "neon",	ConvertRow_NEON,	1 },
+#endif
+	};
+	const int numEntries = (int) (sizeof(entries) / sizeof(entries[0]));
+
+	const size_t numPixels = kBenchMaxWidth * kBenchMaxHeight;
+	uint8_t* indexed		= SDL_malloc(numPixels);
+	color_t* colorRef		= SDL_malloc(numPixels * sizeof(color_t));
+	color_t* colorTest		= SDL_malloc(numPixels * sizeof(color_t));
+	ConversionLUT* lut		= SDL_malloc(sizeof(ConversionLUT));
+
+	uint32_t seed = 0x12345678;
+	for (size_t i = 0; i < numPixels; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		indexed[i] = (uint8_t) (seed >> 24);
+	}
+
+	FillConversionLUT(lut, &gGamePalette);
+
+	printf("Palette lookup: %d-bit color, active kernel: %s\n", FRAMEBUFFER_COLOR_DEPTH, gConvertRowName);
+	printf("pfsize  resolution  kernel     ns/frame\n");
+
+	for (int s = 0; s < (int) (sizeof(kBenchSizes) / sizeof(kBenchSizes[0])); s++)
+	{
+		const int w = kBenchSizes[s].width;
+		const int h = kBenchSizes[s].height;
+
+		for (int y = 0; y < h; y++)
+			ConvertRow_Scalar(colorRef + y*w, indexed + y*w, w, lut);
+
+		for (int e = 0; e < numEntries; e++)
+		{
+			if (!entries[e].supported)
+				continue;
+
+					/* VERIFY EXACT OUTPUT */
+
+			memset(colorTest, 0, numPixels * sizeof(color_t));
+			for (int y = 0; y < h; y++)
+				entries[e].func(colorTest + y*w, indexed + y*w, w, lut);
+			if (0 != memcmp(colorRef, colorTest, w * h * sizeof(color_t)))
+				printf("PALETTE LOOKUP MISMATCH: %s at %dx%d\n", entries[e].name, w, h);
+
+					/* TIME IT */
+
+			uint64_t t0 = SDL_GetPerformanceCounter();
+			for (int pass = 0; pass < kBenchNumPasses; pass++)
+			{
+				for (int y = 0; y < h; y++)
+					entries[e].func(colorTest + y*w, indexed + y*w, w, lut);
+			}
+			uint64_t t1 = SDL_GetPerformanceCounter();
+
+			double ns = (double) (t1 - t0) * 1e9 / (double) SDL_GetPerformanceFrequency() / kBenchNumPasses;
+			printf("%-7s %4dx%-4d   %-8s %10.0f\n", kBenchSizes[s].name, w, h, entries[e].name, ns);
+		}
+	}
+
+	BenchmarkDitheringFilter(lut);
+
+	SDL_free(indexed);
+	SDL_free(colorRef);
+	SDL_free(colorTest);
+	SDL_free(lut);
+}
+
+/****************** BENCHMARK DITHERING FILTER ********************/
+
+static void MakeDitheredTestImage(uint8_t* indexed, size_t numPixels)
+{
+	// Mix of solid runs, two-color checker runs (some with glitches),
+	// and noise, which is what the stride detector has to tell apart.
+
+	uint32_t seed = 0x9E3779B9;
+	#define NEXT_RANDOM() (seed = seed * 1664525 + 1013904223, seed >> 16)
+
+	size_t i = 0;
+	while (i < numPixels)
+	{
+		int runLength	= 1 + NEXT_RANDOM() % 24;
+		int kind		= NEXT_RANDOM() % 4;
+		uint8_t c1		= (uint8_t) NEXT_RANDOM();
+		uint8_t c2		= (uint8_t) NEXT_RANDOM();
+
+		for (int k = 0; k < runLength && i < numPixels; k++, i++)
+		{
+			switch (kind)
+			{
+				case 0:		indexed[i] = c1;									break;	// solid
+				case 1:		indexed[i] = (k & 1) ? c2 : c1;						break;	// checker
+				case 2:		indexed[i] = NEXT_RANDOM() % 8 == 0 ? (uint8_t) NEXT_RANDOM() : ((k & 1) ? c2 : c1);	break;	// glitchy checker
+				default:	indexed[i] = (uint8_t) NEXT_RANDOM();				break;	// noise
+			}
+		}
+	}
+
+	#undef NEXT_RANDOM
+}
+
+static void BenchmarkDitheringFilter(const ConversionLUT* lut)
+{
+	DitherBenchEntry entries[] =
+	{
+		{ "scalar",	ClassifyDitherPixels_Scalar,	SmearRow_Scalar,	1 },
+#if SIMD_X86
+		{ "sse2",	ClassifyDitherPixels_SSE2,		SmearRow_Scalar,	SDL_HasSSE2() },
+		{ "avx2",	ClassifyDitherPixels_AVX2,		SmearRow_AVX2,		SDL_HasAVX2() },
+#elif SIMD_NEON_A64
+		{ "neon",	ClassifyDitherPixels_NEON,		SmearRow_NEON,		1 },
+#elif SIMD_NEON
+		{ "neon",	ClassifyDitherPixels_NEON,		SmearRow_Scalar,	1 },
+#endif
+	};
+	const int numEntries = (int) (sizeof(entries) / sizeof(entries[0]));
+
+	const size_t numPixels = kBenchMaxWidth * kBenchMaxHeight;
+	uint8_t* indexed		= SDL_malloc(numPixels);
+	uint8_t* flagsRef		= SDL_malloc(kBenchMaxWidth);
+	uint8_t* flagsTest		= SDL_malloc(kBenchMaxWidth);
+	color_t* colorRef		= SDL_malloc(kBenchMaxWidth * sizeof(color_t));
+	color_t* colorTest		= SDL_malloc(numPixels * sizeof(color_t));
+
+	MakeDitheredTestImage(indexed, numPixels);
+
+	ClassifyDitherPixelsFunc activeClassify = gClassifyDitherPixels;
+
+	printf("Dithering filter: active kernels: detection %s, smearing %s\n", gClassifyDitherPixelsName, gSmearRowName);
+
+			/* VERIFY SMEAR FLAGS AGAINST THE ORIGINAL STATE MACHINE, AND SMEARED COLORS AGAINST SCALAR CODE */
+
+	for (int e = 0; e < numEntries; e++)
+	{
+		if (!entries[e].supported)
+			continue;
+
+		gClassifyDitherPixels = entries[e].classify;
+		int flagMismatches = 0;
+		int colorMismatches = 0;
+
+		for (int width = 2; width <= kBenchMaxWidth; width += (width < 200 ? 1 : 316))
+		{
+			for (int y = 0; y < kBenchMaxHeight; y += 7)
+			{
+				const uint8_t* row = indexed + y * kBenchMaxWidth;
+
+				memset(flagsRef, 0, kBenchMaxWidth);
+				memset(flagsTest, 0, kBenchMaxWidth);
+				FilterDithering_Row_Reference(row, width, flagsRef);
+				FilterDithering_Row(row, width, flagsTest, NULL, NULL);
+				if (0 != memcmp(flagsRef, flagsTest, width))
+					flagMismatches++;
+
+				ConvertRow_Scalar(colorRef, row, width, lut);
+				ConvertRow_Scalar(colorTest, row, width, lut);
+				SmearRow_Scalar(colorRef, row, flagsRef, width, lut);
+				entries[e].smear(colorTest, row, flagsTest, width, lut);
+				if (0 != memcmp(colorRef, colorTest, width * sizeof(color_t)))
+					colorMismatches++;
+			}
+		}
+
+		if (flagMismatches || colorMismatches)
+			printf("DITHERING MISMATCH: %s: %d rows with different smear flags, %d rows with different colors\n",
+					entries[e].name, flagMismatches, colorMismatches);
+	}
+
+			/* TIME FULL FRAMES: ORIGINAL PER-PIXEL DETECTION VS. EACH KERNEL SET */
+
+	printf("pfsize  resolution  kernel     ns/frame\n");
+
+	for (int s = 0; s < (int) (sizeof(kBenchSizes) / sizeof(kBenchSizes[0])); s++)
+	{
+		const int w = kBenchSizes[s].width;
+		const int h = kBenchSizes[s].height;
+
+		for (int e = -1; e < numEntries; e++)
+		{
+			if (e >= 0 && !entries[e].supported)
+				continue;
+
+			if (e >= 0)
+				gClassifyDitherPixels = entries[e].classify;
+
+			memset(flagsTest, 0, kBenchMaxWidth);
+
+			uint64_t t0 = SDL_GetPerformanceCounter();
+			for (int pass = 0; pass < kBenchNumPasses; pass++)
+			{
+				for (int y = 0; y < h; y++)
+				{
+					const uint8_t* row = indexed + y * w;
+					color_t* color = colorTest + y * w;
+
+					if (e < 0)
+					{
+						FilterDithering_Row_Reference(row, w, flagsTest);
+						ConvertRow_Scalar(color, row, w, lut);
+						SmearRow_Scalar(color, row, flagsTest, w, lut);
+					}
+					else
+					{
+						FilterDithering_Row(row, w, flagsTest, NULL, NULL);
+						gConvertRow(color, row, w, lut);
+						entries[e].smear(color, row, flagsTest, w, lut);
+					}
+				}
+			}
+			uint64_t t1 = SDL_GetPerformanceCounter();
+
+			double ns = (double) (t1 - t0) * 1e9 / (double) SDL_GetPerformanceFrequency() / kBenchNumPasses;
+			printf("%-7s %4dx%-4d   %-8s %10.0f\n", kBenchSizes[s].name, w, h, e < 0 ? "original" : entries[e].name, ns);
+		}
+	}
+
+	gClassifyDitherPixels = activeClassify;
+
+			/* VERIFY AND TIME TILE STRIDE CACHE ON THE CURRENT FRAME */
+
+	if (gIndexedFramebuffer && VISIBLE_WIDTH <= kBenchMaxWidth)
+	{
+		LatchPlayfieldDitherCache();		// describe the current frame rather than the last presented one
+
+		uint64_t knownBits[MAX_DITHER_ROW_WORDS];
+		uint64_t knownSmearBits[MAX_DITHER_ROW_WORDS];
+		int numCachedRows = 0;
+		int numMismatches = 0;
+		int numKnownPixels = 0;
+		uint64_t ticksFull = 0;
+		uint64_t ticksCached = 0;
+
+		for (int y = 0; y < VISIBLE_HEIGHT; y++)
+		{
+			const uint8_t* row = gIndexedFramebuffer + y * VISIBLE_WIDTH;
+
+			if (!GetPlayfieldRowDitherCache(y, knownBits, knownSmearBits))
+				continue;
+
+			numCachedRows++;
+			for (int w = 0; w < (VISIBLE_WIDTH + 63) >> 6; w++)
+			{
+				for (uint64_t bits = knownBits[w]; bits; bits &= bits - 1)
+					numKnownPixels++;
+			}
+
+			memset(flagsRef, 0, kBenchMaxWidth);
+			memset(flagsTest, 0, kBenchMaxWidth);
+
+			uint64_t t0 = SDL_GetPerformanceCounter();
+			FilterDithering_Row(row, VISIBLE_WIDTH, flagsRef, NULL, NULL);
+			uint64_t t1 = SDL_GetPerformanceCounter();
+			FilterDithering_Row(row, VISIBLE_WIDTH, flagsTest, knownBits, knownSmearBits);
+			uint64_t t2 = SDL_GetPerformanceCounter();
+
+			ticksFull += t1 - t0;
+			ticksCached += t2 - t1;
+
+			if (0 != memcmp(flagsRef, flagsTest, VISIBLE_WIDTH))
+				numMismatches++;
+		}
+
+		double nsPerTick = 1e9 / (double) SDL_GetPerformanceFrequency();
+		printf("Tile stride cache on current frame: %d playfield rows, %d%% of their pixels known, %d mismatching rows\n",
+				numCachedRows, numCachedRows ? (int) (100LL * numKnownPixels / (numCachedRows * VISIBLE_WIDTH)) : 0, numMismatches);
+		printf("Stride detection on those rows: %.0f ns full, %.0f ns with tile cache\n",
+				ticksFull * nsPerTick, ticksCached * nsPerTick);
+	}
+
+	SDL_free(indexed);
+	SDL_free(flagsRef);
+	SDL_free(flagsTest);
+	SDL_free(colorRef);
+	SDL_free(colorTest);
+}
+
+#endif
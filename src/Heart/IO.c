@@ -17,6 +17,8 @@
 #include "infobar.h"
 #include "input.h"
 #include "externs.h"
+#include <SDL.h>
+#include <stdio.h>
 
 /****************************/
 /*    CONSTANTS             */
@@ -26,9 +28,14 @@
 #define	NUM_KEYS		43
 
 
-#define	MAX_DEMO_SIZE		80000L
-#define	END_DEMO_MARK		0x7fff
-#define	DEMO_SEED			1234L
+#define	DEMO_MAGIC			0x4d4d446dL			// 'MMDm'
+#define	DEMO_VERSION		1
+#define	DEMO_MAX_RUN		0xffff
+#define	DEMO_RECORD_PATH	"demo.mmdemo"
+
+// Needs that open modal screens (bunny radar, quit prompt). Those screens wait on the live input,
+// so demos leave these needs out: playback would stall until someone pressed a key.
+#define	DEMO_MODAL_NEEDS	((1u << kNeed_Radar) | (1u << kNeed_UIPause))
 
 
 /**********************/
@@ -36,10 +43,17 @@
 /**********************/
 
 short	gDemoMode = DEMO_MODE_OFF;
-Handle	gDemoDataHandle;
-Ptr		gDemoDataPtr,gPrevDemoDataPtr;
-long	gDemoSize;
-short	gDemoKeyIterations;
+Byte	gDemoDifficulty;
+
+static	FILE*			gDemoFile = nil;
+static	unsigned long	gDemoSeed;
+static	InputSnapshot	gDemoSnapshot;				// input for the current run of identical ticks
+static	long			gDemoRunLength;				// # ticks in the current run (record: so far; playback: left)
+static	long			gDemoNumTicks;
+static	Uint64			gDemoStartTime;
+
+static	char			gQueuedDemoPath[256];
+static	Boolean			gDemoUnthrottled = false;
 
 short	gHtab=0,gVtab=0;
 
@@ -48,47 +62,124 @@ short	gHtab=0,gVtab=0;
 Boolean		gAbortDemoFlag,gGameIsDemoFlag;
 
 
-/*************** START RECORDING DEMO *****************/
+/*************** DEMO FILE I/O *****************/
+//
+// The demo file is in the following format (big-endian):
+//
+//     Header:
+//         long		'MMDm'
+//         short	version
+//         short	starting scene
+//         short	difficulty
+//         long		random seed (see SeedDemoRandomForArea)
 //
-// Begins to record key commands for playback later
+//     Then, for each run of identical ticks:
+//         short	# of ticks in the run (0 = end of demo)
+//         long		needs active bitmask
+//         long		needs changed bitmask
+//         long		left stick magnitude
+//         short	right stick aim
+//
+
+static void WriteDemoShort(uint16_t n)
+{
+	fputc((n >> 8) & 0xFF, gDemoFile);
+	fputc(n & 0xFF, gDemoFile);
+}
+
+static void WriteDemoLong(uint32_t n)
+{
+	WriteDemoShort((uint16_t) (n >> 16));
+	WriteDemoShort((uint16_t) n);
+}
+
+static uint16_t ReadDemoShort(void)
+{
+	int hi = fgetc(gDemoFile);
+	int lo = fgetc(gDemoFile);
+	if (hi == EOF || lo == EOF)
+		DoFatalAlert("Demo file is truncated!");
+	return (uint16_t) ((hi << 8) | lo);
+}
+
+static uint32_t ReadDemoLong(void)
+{
+	uint32_t hi = ReadDemoShort();
+	return (hi << 16) | ReadDemoShort();
+}
+
+static void WriteDemoRun(void)
+{
+	if (gDemoRunLength == 0)
+		return;
+
+	WriteDemoShort((uint16_t) gDemoRunLength);
+	WriteDemoLong(gDemoSnapshot.needsActive);
+	WriteDemoLong(gDemoSnapshot.needsChanged);
+	WriteDemoLong((uint32_t) gDemoSnapshot.leftStickMagnitude);
+	WriteDemoShort((uint16_t) gDemoSnapshot.rightStickAim);
+	gDemoRunLength = 0;
+}
+
+static void ReadDemoRun(void)
+{
+	gDemoRunLength = ReadDemoShort();
+	if (gDemoRunLength == 0)								// end of demo
+		return;
+
+	gDemoSnapshot.needsActive			= ReadDemoLong();
+	gDemoSnapshot.needsChanged			= ReadDemoLong();
+	gDemoSnapshot.leftStickMagnitude	= (int32_t) ReadDemoLong();
+	gDemoSnapshot.rightStickAim			= (int16_t) ReadDemoShort();
+
+	gDemoSnapshot.needsActive			&= ~DEMO_MODAL_NEEDS;	// in case the recorder didn't filter them out
+	gDemoSnapshot.needsChanged			&= ~DEMO_MODAL_NEEDS;
+}
+
+static Boolean IsSameSnapshot(const InputSnapshot* a, const InputSnapshot* b)
+{
+	return a->needsActive == b->needsActive
+		&& a->needsChanged == b->needsChanged
+		&& a->leftStickMagnitude == b->leftStickMagnitude
+		&& a->rightStickAim == b->rightStickAim;
+}
+
+
+/*************** START RECORDING DEMO *****************/
 //
-// The demo data is in the following format:
-//     short	# iterations of following KeyMap
-//	   KeyMap	the KeyMap in question
+// Begins to record the input of every game tick for playback later.
+// The demo is written to demo.mmdemo in the working directory when the game ends.
 //
 
 void StartRecordingDemo(void)
 {
-	DoFatalAlert("TODO: Implement StartRecordingDemo");
-#if 0
 	gAbortDemoFlag = false;
 	gGameIsDemoFlag = false;
 
-	gDemoDataHandle = AllocHandle(MAX_DEMO_SIZE);			// alloc memory for it
-	if (gDemoDataHandle == nil)
-		DoFatalAlert("Cant allocate memory for record buffer.");
-	HLockHi(gDemoDataHandle);
-	gDemoDataPtr = gPrevDemoDataPtr = *gDemoDataHandle;
-	gDemoSize = 0L;											// init size to 0
-
-	DoFatalAlert("TODO: Reimplement StartRecordingDemo");
-#if 0
-	gOldKeyMap[0] = 0xffffffffL;							// init old keymap
-	gOldKeyMap[1] = 0xffffffffL;
-	gOldKeyMap[2] = 0xffffffffL;
-	gOldKeyMap[3] = 0xffffffffL;
-#endif
+	gDemoFile = fopen(DEMO_RECORD_PATH, "wb");
+	if (gDemoFile == nil)
+	{
+		DoAlert("Cant open demo file for recording.");
+		return;
+	}
+
+	gDemoSeed = MyRandomLong();								// any seed will do, as long as it's in the file
+	gDemoDifficulty = gGamePrefs.difficulty;
 
-	gDemoMode = DEMO_MODE_RECORD;
-	SetMyRandomSeed(DEMO_SEED);								// always use same seed!
+	WriteDemoLong(DEMO_MAGIC);
+	WriteDemoShort(DEMO_VERSION);
+	WriteDemoShort(gStartingScene);
+	WriteDemoShort(gDemoDifficulty);
+	WriteDemoLong((uint32_t) gDemoSeed);
 
-	gDemoKeyIterations = 0;
-#endif
+	gDemoRunLength = 0;
+	gDemoNumTicks = 0;
+	gDemoMode = DEMO_MODE_RECORD;
 }
 
 /***************** SAVE DEMO DATA *************************/
 //
-// Save keyboard data for demo playback later
+// Finish writing the demo file
 //
 
 void SaveDemoData(void)
@@ -96,38 +187,38 @@ void SaveDemoData(void)
 	if (gDemoMode != DEMO_MODE_RECORD)					// be sure we were recording
 		return;
 
-	DoFatalAlert("TODO: Implement SaveDemoData");
-#if 0
-Handle		resHandle;
-
-	*(short *)gDemoDataPtr = END_DEMO_MARK;						// put end mark @ end of file
-	gDemoSize += sizeof(short);
-
-					/* SAVE AS RESOURCE */
-
-#ifdef __powerc
-	resHandle = GetResource('dEmo',1000+gStartingScene+(1000*gPPCFullScreenFlag));		// read the resource
-#else
-	resHandle = GetResource('dEmo',4000+gStartingScene);
-#endif
-	RemoveResource(resHandle);									// nuke it
-	ReleaseResource(resHandle);
-
-	PtrToHand(*gDemoDataHandle, &resHandle, gDemoSize);			// make a handle with data
-#ifdef __powerc
-	AddResource( resHandle, 'dEmo', 1000+gStartingScene+(1000*gPPCFullScreenFlag), "Demo Data" );		// add resource
-#else
-	AddResource( resHandle, 'dEmo', 4000+gStartingScene, "Demo Data" );		// add resource
-#endif
-	if ( ResError() )
-		DoFatalAlert("Couldnt Add Demo Resource!");
-	WriteResource( resHandle );									// update it
-	ReleaseResource(resHandle);									// nuke resource
-
-	DisposeHandle(gDemoDataHandle);								// delete demo data
-	gDemoDataHandle = nil;
+	WriteDemoRun();										// flush last run
+	WriteDemoShort(0);									// put end mark @ end of file
+
+	fclose(gDemoFile);
+	gDemoFile = nil;
 	gDemoMode = DEMO_MODE_OFF;
-#endif
+
+	printf("wrote %s (%ld ticks)\n", DEMO_RECORD_PATH, gDemoNumTicks);
+}
+
+
+/********************* QUEUE DEMO PLAYBACK ****************/
+//
+// Makes the title screen start playing back a demo file right away.
+// If unthrottled, the game runs as fast as it can during playback (for benchmarking).
+// The game quits when the demo ends.
+//
+
+void QueueDemoPlayback(const char* hostPath, Boolean unthrottled)
+{
+	snprintf(gQueuedDemoPath, sizeof(gQueuedDemoPath), "%s", hostPath);
+	gDemoUnthrottled = unthrottled;
+}
+
+Boolean IsDemoPlaybackQueued(void)
+{
+	return gQueuedDemoPath[0] != '\0';
+}
+
+Boolean IsDemoUnthrottled(void)
+{
+	return gDemoMode == DEMO_MODE_PLAYBACK && gDemoUnthrottled;
 }
 
 
@@ -135,112 +226,102 @@ Handle		resHandle;
 
 void InitDemoPlayback(void)
 {
-	DoFatalAlert("TODO: Implement InitDemoPlayback");
-#if 0
-	gStartingScene = RandomRange(0,2);						// get random demo (dont do 3 & 4)
+	gDemoFile = fopen(gQueuedDemoPath, "rb");
+	if (gDemoFile == nil)
+		DoFatalAlert2("Error reading demo file!", gQueuedDemoPath);
+
+	if (ReadDemoLong() != DEMO_MAGIC || ReadDemoShort() != DEMO_VERSION)
+		DoFatalAlert2("Not a demo file, or made by another version of the game:", gQueuedDemoPath);
+
+	gStartingScene = (Byte) ReadDemoShort();
+	gDemoDifficulty = (Byte) ReadDemoShort();
+	gDemoSeed = ReadDemoLong();
 
 	gAbortDemoFlag = false;
 	gGameIsDemoFlag = true;
 	gDemoMode = DEMO_MODE_PLAYBACK;
-	SetMyRandomSeed(DEMO_SEED);								// always use same seed!
 
-				/* LOAD DEMO DATA */
+	gDemoRunLength = 0;										// no run loaded yet
+	gDemoNumTicks = 0;
+	gDemoStartTime = SDL_GetPerformanceCounter();
+}
 
-#ifdef __powerc
-	gDemoDataHandle = GetResource('dEmo',1000+gStartingScene+(1000*gPPCFullScreenFlag));	// read the resource
-#else
-	gDemoDataHandle = GetResource('dEmo',4000+gStartingScene);	// read the resource
-#endif
 
-	if (gDemoDataHandle == nil)
-		DoFatalAlert("Error reading Demo Resource!");
+/********************* SEED DEMO RANDOM FOR AREA ****************/
+//
+// The screens between areas don't go through the demo, so each area restarts
+// the random number generator from the demo's seed.
+//
 
-	DetachResource(gDemoDataHandle);						// detach resource
-	HLockHi(gDemoDataHandle);
-	gDemoDataPtr = *gDemoDataHandle;
+void SeedDemoRandomForArea(void)
+{
+	if (gDemoMode == DEMO_MODE_OFF)
+		return;
 
-	gDemoKeyIterations = 0;									// no iterations present
-#endif
+	SetMyRandomSeed(gDemoSeed + gSceneNum * 3 + gAreaNum);
 }
 
 
 /**************** READ KEYBOARD *************/
+//
+// Only in-game ticks are recorded and played back: the other screens run
+// on timers and always read the real input.
+//
 
 void ReadKeyboard(void)
 {
-#if 0
-short	*intPtr;
-KeyMap tempKeys;
-#endif
+	UpdateInput();										// READ THE REAL KEYBOARD
 
 					/* DEMO PLAYBACK */
 
-	if (gDemoMode == DEMO_MODE_PLAYBACK)				// see if read from demo file
+	if (gDemoMode == DEMO_MODE_PLAYBACK && gIsInGame)		// see if read from demo file
 	{
-		DoFatalAlert("TODO: Reimplement demo playback");
-#if 0
-		if (gDemoKeyIterations == 0)					// see if need to get next keymap
+		InputSnapshot live;
+		GetInputSnapshot(&live);
+		if (live.needsActive & live.needsChanged)			// any key aborts
 		{
-			intPtr = (short *)gDemoDataPtr;				// get new iteration count
-			gDemoKeyIterations = *intPtr++;
-			if (gDemoKeyIterations == END_DEMO_MARK)	// see if end of file
+			StopDemo();
+			return;
+		}
+
+		if (gDemoRunLength == 0)							// see if need to get next run
+		{
+			ReadDemoRun();
+			if (gDemoRunLength == 0)						// see if end of file
 			{
 				StopDemo();
 				return;
 			}
-
-			BlockMove((Ptr)intPtr,&gKeyMap,sizeof(KeyMap));
-			gDemoDataPtr += sizeof(KeyMap) + sizeof(short);
 		}
-		else
-			gDemoKeyIterations--;						// decrement iteration counter
 
-		MyGetKeys(&tempKeys);												// read real keyboard only to check for abort
-//		GetKeys(tempKeys);								// read real keyboard only to check for abort
-		if (tempKeys[0] || tempKeys[1] || tempKeys[2] || tempKeys[3])		// any key aborts
-		{
-			StopDemo();
-		}
-#endif
-	}
-	else
-	{
-//		MyGetKeys(&gKeyMap);										// READ THE REAL KEYBOARD
-//		GetKeys(gKeyMap);								// READ THE REAL KEYBOARD
-		UpdateInput();
+		gDemoRunLength--;
+		gDemoNumTicks++;
+		ApplyInputSnapshot(&gDemoSnapshot);
 	}
 
 					/* RECORD DEMO */
 
-	if (gDemoMode == DEMO_MODE_RECORD)					// see if record keyboard
+	if (gDemoMode == DEMO_MODE_RECORD && gIsInGame)			// see if record keyboard
 	{
-		DoFatalAlert("TODO: Reimplement demo recording");
-#if 0
-		if ((gKeyMap[0] == gOldKeyMap[0]) &&					// see if same as last occurrence
-			(gKeyMap[1] == gOldKeyMap[1]) &&
-			(gKeyMap[2] == gOldKeyMap[2]) &&
-			(gKeyMap[3] == gOldKeyMap[3]))
+		InputSnapshot snapshot;
+		GetInputSnapshot(&snapshot);
+		snapshot.needsActive &= ~DEMO_MODAL_NEEDS;			// the radar & quit prompt still work while recording,
+		snapshot.needsChanged &= ~DEMO_MODAL_NEEDS;			// they just don't go in the demo
+
+		if (gDemoRunLength > 0
+			&& gDemoRunLength < DEMO_MAX_RUN
+			&& IsSameSnapshot(&snapshot, &gDemoSnapshot))	// see if same as last tick
 		{
-			intPtr = (short *)gPrevDemoDataPtr;					// increment iteration count
-			*intPtr = *intPtr+1;
+			gDemoRunLength++;
 		}
-		else													// new KeyMap, so reset and add
+		else												// new input, so start a new run
 		{
-			gPrevDemoDataPtr = gDemoDataPtr;
-			intPtr = (short *)gDemoDataPtr;						// init iteration count
-			*intPtr++ = 0;
-			BlockMove(&gKeyMap,(Ptr)intPtr,sizeof(KeyMap));		// copy keymap to file
-			BlockMove(&gKeyMap,&gOldKeyMap,sizeof(KeyMap));		// copy keymap to oldkeymap
-			gDemoDataPtr += sizeof(KeyMap) + sizeof(short);
-			gDemoSize += sizeof(KeyMap) + sizeof(short);
-
-			gScore = MAX_DEMO_SIZE-gDemoSize;					// show remaining memory in score
-			ShowScore();
+			WriteDemoRun();
+			gDemoSnapshot = snapshot;
+			gDemoRunLength = 1;
 		}
 
-		if (gDemoSize >= (MAX_DEMO_SIZE - sizeof(KeyMap)))		// see if overflowed
-			DoFatalAlert("Demo Record Buffer Overflow!");
-#endif
+		gDemoNumTicks++;
 	}
 }
 
@@ -249,10 +330,24 @@ KeyMap tempKeys;
 
 void StopDemo(void)
 {
-	DisposeHandle(gDemoDataHandle);
+	if (gDemoFile)
+	{
+		fclose(gDemoFile);
+		gDemoFile = nil;
+	}
+
+	if (gDemoMode == DEMO_MODE_PLAYBACK)
+	{
+		double seconds = (double) (SDL_GetPerformanceCounter() - gDemoStartTime) / (double) SDL_GetPerformanceFrequency();
+		printf("demo %s: %ld ticks in %.3f s\n", gQueuedDemoPath, gDemoNumTicks, seconds);
+	}
+
 	gDemoMode = DEMO_MODE_OFF;			// set back to OFF
 	gAbortDemoFlag = true;
 	ReadKeyboard();						// read keyboard to reset it all
+
+	if (IsDemoPlaybackQueued())			// demo came from the command line, we're done
+		CleanQuit();
 }
 
 /*************** PRINT NUMBER ****************/
@@ -24,6 +24,10 @@
 #include "miscanims.h"
 #include "weapon.h"
 #include "shape.h"
+#include "blit.h"
+#include "framebufferfilter.h"
+#include "profiler.h"
+#include "assetloader.h"
 #include "io.h"
 #include "main.h"
 #include "input.h"
@@ -37,6 +41,14 @@
 /*    CONSTANTS             */
 /****************************/
 
+enum											// files loaded by LoadAreaArt, in order
+{
+	kAreaArt_TileSet,
+	kAreaArt_Shapes1,
+	kAreaArt_Shapes2,
+	kAreaArt_Map,
+	NUM_AREA_ART_FILES
+};
 
 
 /**********************/
@@ -101,6 +113,8 @@ void InitGame(void)
 
 	gCurrentPlayer = ONE_PLAYER;					// start with player 1
 	gDifficultySetting = gGamePrefs.difficulty;		// by default, use difficulty from prefs
+	if (gDemoMode == DEMO_MODE_PLAYBACK)
+		gDifficultySetting = gDemoDifficulty;		// play demo at the difficulty it was recorded at
 	InitWeaponsList();
 	InitScore();
 	InitCoins();
@@ -165,6 +179,8 @@ void InitGame(void)
 
 void InitArea(void)
 {
+	SeedDemoRandomForArea();									// demos must play out the same every time
+
 	FadeOutGameCLUT();
 
 	OptimizeMemory();
@@ -174,6 +190,7 @@ void InitArea(void)
 	FillThermometer(10);
 	LoadAreaArt();												// load art
 	LoadAreaSound();											// load sound
+	PrefetchNextAreaArt();										// start unpacking the next area's art in the background
 	FillThermometer(100);
 
 	SetScreenOffsetForArea();
@@ -212,17 +229,12 @@ void InitArea(void)
 }
 
 
-/*************** LOAD AREA ART ****************/
-//
-// Load the necessary Screen, Maps, Tiles, and Sprites for this area.
-//
+/*************** GET AREA ART PATHS ****************/
 
-void LoadAreaArt(void)
+static void GetAreaArtPaths(Byte sceneNum, Byte areaNum, char paths[NUM_AREA_ART_FILES][64])
 {
-	char path[256];
-
 	const char* sceneName = nil;
-	switch (gSceneNum)
+	switch (sceneNum)
 	{
 		case SCENE_JURASSIC:		sceneName = "jurassic";		break;
 		case SCENE_CANDY:			sceneName = "candy";		break;
@@ -233,25 +245,101 @@ void LoadAreaArt(void)
 			GAME_ASSERT_MESSAGE(false, "Unsupported scene ID!");
 	}
 
-	snprintf(path, sizeof(path), ":maps:%s.tileset", sceneName);
-	LoadTileSet(path);
-	FillThermometer(20);
+	GAME_ASSERT(areaNum < 3);
+
+	snprintf(paths[kAreaArt_TileSet], sizeof(paths[0]), ":maps:%s.tileset", sceneName);
+	snprintf(paths[kAreaArt_Shapes1], sizeof(paths[0]), ":shapes:%s1.shapes", sceneName);
+	snprintf(paths[kAreaArt_Shapes2], sizeof(paths[0]), ":shapes:%s2.shapes", sceneName);
+	snprintf(paths[kAreaArt_Map], sizeof(paths[0]), ":maps:%s.map-%d", sceneName, areaNum + 1);
+}
+
+
+/*************** LOAD AREA ART ****************/
+//
+// Load the necessary Screen, Maps, Tiles, and Sprites for this area.
+//
+
+void LoadAreaArt(void)
+{
+	char paths[NUM_AREA_ART_FILES][64];
+	int numPending;
+	short percent = 10;
+
+	GetAreaArtPaths(gSceneNum, gAreaNum, paths);
+
+			/* UNPACK ALL FILES AT ONCE */
+			//
+			// Source port note: the files get unpacked side by side by the asset loader
+			// (unless the previous area already prefetched them).
+			// The byteswapping in LoadTileSet, LoadShapeTable & LoadPlayfield stays serial.
+			//
+
+	for (int i = 0; i < NUM_AREA_ART_FILES; i++)
+		PrefetchPackedFile(paths[i]);
+
+	do
+	{
+		numPending = 0;
+		for (int i = 0; i < NUM_AREA_ART_FILES; i++)
+			numPending += IsPrefetchPending(paths[i]);
+
+		short newPercent = 10 + 50 * (NUM_AREA_ART_FILES - numPending) / NUM_AREA_ART_FILES;
+		if (newPercent != percent)
+		{
+			percent = newPercent;
+			FillThermometer(percent);
+		}
+
+		if (numPending > 0)
+			WaitForPrefetchProgress(33);
+	} while (numPending > 0);
 
-	snprintf(path, sizeof(path), ":shapes:%s1.shapes", sceneName);
-	LoadShapeTable(path, GROUP_AREA_SPECIFIC);
-	FillThermometer(40);
+			/* FIX UP THE UNPACKED DATA */
 
-	snprintf(path, sizeof(path), ":shapes:%s2.shapes", sceneName);
-	LoadShapeTable(path, GROUP_AREA_SPECIFIC2);
-	FillThermometer(60);
+	LoadTileSet(paths[kAreaArt_TileSet]);
+	FillThermometer(65);
 
-	GAME_ASSERT(gAreaNum < 3);
-	snprintf(path, sizeof(path), ":maps:%s.map-%d", sceneName, gAreaNum + 1);
-	LoadPlayfield(path);
+	LoadShapeTable(paths[kAreaArt_Shapes1], GROUP_AREA_SPECIFIC);
+	FillThermometer(70);
+
+	LoadShapeTable(paths[kAreaArt_Shapes2], GROUP_AREA_SPECIFIC2);
+	FillThermometer(75);
+
+	LoadPlayfield(paths[kAreaArt_Map]);
 	FillThermometer(80);
 }
 
 
+/*************** PREFETCH NEXT AREA ART ****************/
+//
+// Source port note: the area that comes after this one (in this scene or at the start of the next)
+// gets unpacked in the background while this one plays, so LoadAreaArt finds it ready.
+// If the guess is wrong (2-player games, death, quitting), the files just get thrown away.
+//
+
+void PrefetchNextAreaArt(void)
+{
+	char paths[NUM_AREA_ART_FILES][64];
+	Byte nextScene = gSceneNum;
+	Byte nextArea = gAreaNum + 1;
+
+	FlushPrefetchedFiles();										// whatever this area didn't use
+
+	if (nextArea >= 3)
+	{
+		nextArea = 0;
+		nextScene++;
+		if (nextScene >= MAX_SCENES)							// last area of the game
+			return;
+	}
+
+	GetAreaArtPaths(nextScene, nextArea, paths);
+
+	for (int i = 0; i < NUM_AREA_ART_FILES; i++)
+		PrefetchPackedFile(paths[i]);
+}
+
+
 /*************** CORE GAME UPDATE: FIXED FRAMERATE VERSION ****************/
 //
 // Updates the simulation and renders the playfield.
@@ -268,18 +356,21 @@ static void UpdateSimAndRenderFixedFrame(void)
 	gFrames++;												// one more simulation frame
 
 	UpdateShakeyScreen();
-	ReadKeyboard();
-	MoveObjects();
-	SortObjectsByY();										// sort 'em
-	ScrollPlayfield();										// do playfield updating
-	UpdateTileAnimation();
-	DrawObjects();
-	DisplayPlayfield();
-	UpdateInfoBar();
-	EraseObjects();
-	PresentIndexedFramebuffer();
+	PROFILE_STAGE(kProfile_ReadKeyboard, ReadKeyboard());
+	PROFILE_STAGE(kProfile_MoveObjects, MoveObjects());
+	PROFILE_STAGE(kProfile_SortObjectsByY, SortObjectsByY());			// sort 'em
+	PROFILE_STAGE(kProfile_ScrollPlayfield, ScrollPlayfield());		// do playfield updating
+	PROFILE_STAGE(kProfile_UpdateTileAnimation, UpdateTileAnimation());
+	PROFILE_STAGE(kProfile_DrawObjects, DrawObjects());
+	PROFILE_STAGE(kProfile_DisplayPlayfield, DisplayPlayfieldFused());
+	PROFILE_STAGE(kProfile_UpdateInfoBar, UpdateInfoBar());
+	PresentIndexedFramebufferPipelined();
+	PROFILE_STAGE(kProfile_EraseObjects, EraseObjects());	// after present: the converter may read the PF buffer
 
 	// Regulate speed
+	if (IsDemoUnthrottled())								// benchmarking: go as fast as we can
+		return;
+
 	uint32_t tick = SDL_GetTicks();
 	while ((tick - oldTick) < GAME_SPEED_SDL)
 	{
@@ -315,11 +406,11 @@ static void UpdateSimAndRenderTweenedFrames(void)
 	gFrames++;												// one more simulation frame
 
 	UpdateShakeyScreen();
-	ReadKeyboard();
-	MoveObjects();
-	SortObjectsByY();										// sort 'em
-	UpdateTileAnimation();
-	UpdateInfoBar();
+	PROFILE_STAGE(kProfile_ReadKeyboard, ReadKeyboard());
+	PROFILE_STAGE(kProfile_MoveObjects, MoveObjects());
+	PROFILE_STAGE(kProfile_SortObjectsByY, SortObjectsByY());			// sort 'em
+	PROFILE_STAGE(kProfile_UpdateTileAnimation, UpdateTileAnimation());
+	PROFILE_STAGE(kProfile_UpdateInfoBar, UpdateInfoBar());
 
 	gTimeSinceSim -= GAME_SPEED_SDL;						// catch up
 
@@ -336,11 +427,11 @@ static void UpdateSimAndRenderTweenedFrames(void)
 
 		GAME_ASSERT(gTweenFrameFactor.L >= 0 && gTweenFrameFactor.L <= 0x10000);
 
-		ScrollPlayfield();									// also tweens camera position
-		DrawObjects();
-		DisplayPlayfield();
-		EraseObjects();
-		PresentIndexedFramebuffer();
+		PROFILE_STAGE(kProfile_ScrollPlayfield, ScrollPlayfield());	// also tweens camera position
+		PROFILE_STAGE(kProfile_DrawObjects, DrawObjects());
+		PROFILE_STAGE(kProfile_DisplayPlayfield, DisplayPlayfieldFused());
+		PresentIndexedFramebufferPipelined();
+		PROFILE_STAGE(kProfile_EraseObjects, EraseObjects());	// after present: the converter may read the PF buffer
 
 		uint32_t now = SDL_GetTicks();
 		gTimeSinceSim += now - startOfFrameTimestamp;
@@ -369,7 +460,7 @@ void PlayArea(void)
 	{
 					/* UPDATE SIMULATION & RENDER FRAME(S) */
 
-		if (gGamePrefs.uncappedFramerate)
+		if (gGamePrefs.uncappedFramerate && gDemoMode == DEMO_MODE_OFF)	// demos need the camera in lockstep with the sim
 			UpdateSimAndRenderTweenedFrames();
 		else
 			UpdateSimAndRenderFixedFrame();
@@ -382,7 +473,11 @@ void PlayArea(void)
 		if (GetNewNeedState(kNeed_Radar))				// see if show radar
 			DisplayBunnyRadar();
 
-		if (GetNewNeedState(kNeed_UIPause) || IsCmdQPressed())				// see if abort game
+		// Source port note: the quit prompt and the level skip read live input that demos don't record.
+		// Quitting ends a recording right there, so it's still allowed while recording;
+		// skipping a level would change the game behind the recording's back.
+
+		if (gDemoMode != DEMO_MODE_PLAYBACK && (GetNewNeedState(kNeed_UIPause) || IsCmdQPressed()))	// see if abort game
 		{
 			PauseAllChannels(true);
 			gAbortGameFlag = AskIfQuit();
@@ -390,7 +485,7 @@ void PlayArea(void)
 				PauseAllChannels(false);
 		}
 
-		if (GetSDLKeyState(SDL_SCANCODE_PERIOD) && GetSDLKeyState(SDL_SCANCODE_N))	// see if skip to next level
+		if (gDemoMode == DEMO_MODE_OFF && GetSDLKeyState(SDL_SCANCODE_PERIOD) && GetSDLKeyState(SDL_SCANCODE_N))	// see if skip to next level
 		{
 			gNumBunnies = 1;
 			DecBunnyCount();
@@ -399,12 +494,27 @@ void PlayArea(void)
 		if (gNumBunnies <= 0)					// special hack to fix reported bug!?!?
 			DecBunnyCount();
 
+		if (gProfilerEnabled && GetNewSDLKeyState(SDL_SCANCODE_F11))	// dump frame profile (--profile)
+			DumpProfile();
+
 #if _DEBUG
+		if (GetNewSDLKeyState(SDL_SCANCODE_F5))
+			BenchmarkPackedFiles();
+
+		if (GetNewSDLKeyState(SDL_SCANCODE_F6))
+			BenchmarkColorConversion();
+
+		if (GetNewSDLKeyState(SDL_SCANCODE_F7))
+			BenchmarkBlitters();
+
 		if (GetNewSDLKeyState(SDL_SCANCODE_F8))
 			DumpIndexedTGA("playfield.tga", PF_BUFFER_WIDTH, PF_BUFFER_HEIGHT, *gPFBufferHandle);
 
 		if (GetNewSDLKeyState(SDL_SCANCODE_F9))
 			gScreenScrollFlag = !gScreenScrollFlag;
+
+		if (GetNewSDLKeyState(SDL_SCANCODE_F10))
+			ReportRenderThreadStats();
 #endif
 
 	} while (!gGlobFlag_MeDoneDead && !gAbortGameFlag && !gFinishedArea && !gAbortDemoFlag);
@@ -633,6 +743,7 @@ FSSpec		mySpec;
 			NumObjects = 				gPlayerSaveData[gCurrentPlayer].numObjects;
 			FirstNodePtr = 				gPlayerSaveData[gCurrentPlayer].firstNodePtr;
 			gMyNodePtr =  				gPlayerSaveData[gCurrentPlayer].myNodePtr;
+			RebuildObjectIndexes();								// list heads live outside of ObjectList
 		}
 		else
 			gPlayerSaveData[gCurrentPlayer].newAreaFlag = false;		// not new anymore
@@ -1060,6 +1171,9 @@ game_over:
 
 	SaveDemoData();												// if was recording demo, save it
 
+	if (gDemoMode == DEMO_MODE_PLAYBACK)						// game ended before the demo did
+		StopDemo();
+
 	if (!gGameIsDemoFlag)										// if demo, then dont bother with final stuff
 	{
 		if (gWinFlag)											// see if won or lost
@@ -1226,6 +1340,7 @@ game_over:
 
 void CleanMemory(void)
 {
+	FlushPrefetchedFiles();
 	ZapAllAddedSounds();
 	KillSong();
 	DisposeCurrentMapData();
@@ -1274,6 +1389,8 @@ static void InitDefaultPrefs(void)
 	gGamePrefs.windowedZoom = 0;	// 0 == automatic
 	gGamePrefs.preferredDisplay = 0;
 	gGamePrefs.uncappedFramerate = true;
+	gGamePrefs.pipelinedPresent = false;
+	gGamePrefs.fusedPlayfieldCopy = true;
 	gGamePrefs.music = true;
 	gGamePrefs.soundEffects = true;
 	gGamePrefs.interpolateAudio = true;
@@ -1396,7 +1513,6 @@ void GameMain(void)
 
 	InitInput();                                    // init ISp
 	InitPaletteStuff();
-	CreatePlayfieldPermanentMemory();				// init permanent playfield stuff
 	InitObjectManager();							// call this just to allocate memory
 	InitSoundTools();
 	GetDateTime ((unsigned long *)(&someLong));		// init random seed
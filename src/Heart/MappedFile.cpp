@@ -0,0 +1,275 @@
+// MAPPED FILE
+// This file is part of Mighty Mike. https://github.com/jorio/mightymike
+//
+// Maps read-only data files (movies, images, text) straight into memory, so they can be
+// used in place instead of being copied into a handle. Pages are only brought in as
+// they're touched, and they're backed by the file, so they don't count against the heap.
+//
+// Pomme's file manager has no way to do this, so data file paths (":movies:pangea.spin")
+// are resolved against the Data folder on the host, case-insensitively like Pomme does.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <string_view>
+#include <system_error>
+
+#if _WIN32
+	#include <windows.h>
+#elif !defined(__vita__)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+extern "C"
+{
+	#include "mappedfile.h"
+}
+
+namespace fs = std::filesystem;
+
+static fs::path gDataHostPath;
+
+// ----------------------------------------------------------------------------
+
+static bool EqualsIgnoreCase(const std::string& a, const std::string& b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (tolower((unsigned char) a[i]) != tolower((unsigned char) b[i]))
+			return false;
+	}
+
+	return true;
+}
+
+// Turns ":movies:pangea.spin" into "<Data>/Movies/Pangea.spin".
+// Returns false if nothing exists at that path.
+static bool FindDataPath(const char* fileName, fs::path& outPath)
+{
+	std::error_code ec;
+
+	outPath = gDataHostPath;
+
+	std::string_view remaining = fileName;
+	while (!remaining.empty())
+	{
+		size_t colon = remaining.find(':');
+		std::string component(remaining.substr(0, colon));
+		remaining = (colon == std::string_view::npos) ? std::string_view() : remaining.substr(colon + 1);
+
+		if (component.empty())
+			continue;
+
+		fs::path candidate = outPath / component;
+		if (fs::exists(candidate, ec))
+		{
+			outPath = candidate;
+			continue;
+		}
+
+		bool found = false;
+		for (const auto& entry : fs::directory_iterator(outPath, ec))
+		{
+			if (EqualsIgnoreCase((const char*) entry.path().filename().u8string().c_str(), component))
+			{
+				outPath = entry.path();
+				found = true;
+				break;
+			}
+		}
+
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+// Same as FindDataPath, but the path must be a file.
+static bool ResolveDataPath(const char* fileName, fs::path& outPath)
+{
+	std::error_code ec;
+	return FindDataPath(fileName, outPath) && fs::is_regular_file(outPath, ec);
+}
+
+// ----------------------------------------------------------------------------
+
+/******************** INIT MAPPED FILES *****************/
+//
+// dataHostPath is the Data folder, UTF-8.
+//
+
+void InitMappedFiles(const char* dataHostPath)
+{
+	gDataHostPath = fs::path(std::u8string_view((const char8_t*) dataHostPath));
+}
+
+/******************** MAP DATA FILE *****************/
+//
+// Maps a whole data file, read-only.
+// Returns nullptr if the file can't be mapped (it may still be readable through the file manager).
+//
+
+const void* MapDataFile(const char* fileName, long* outSize)
+{
+	fs::path path;
+
+	if (gDataHostPath.empty() || !ResolveDataPath(fileName, path))
+	{
+		return nullptr;
+	}
+
+#if _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || size.QuadPart > 0x7FFFFFFF)
+	{
+		CloseHandle(file);
+		return nullptr;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);								// the mapping keeps the file open
+	if (!mapping)
+	{
+		return nullptr;
+	}
+
+	const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);							// the view keeps the mapping alive
+	if (!data)
+	{
+		return nullptr;
+	}
+
+	*outSize = (long) size.QuadPart;
+	return data;
+
+#elif defined(__vita__)
+	(void) outSize;
+	return nullptr;
+
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+
+	struct stat st;
+	if (0 != fstat(fd, &st) || st.st_size <= 0 || st.st_size > 0x7FFFFFFF)		// can't map an empty file
+	{
+		close(fd);
+		return nullptr;
+	}
+
+	void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);										// the mapping keeps the file open
+	if (data == MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	*outSize = (long) st.st_size;
+	return data;
+#endif
+}
+
+/******************** UNMAP DATA FILE *****************/
+
+void UnmapDataFile(const void* data, long size)
+{
+#if _WIN32
+	(void) size;
+	UnmapViewOfFile(data);
+#elif defined(__vita__)
+	(void) data;
+	(void) size;
+#else
+	munmap((void*) data, size);
+#endif
+}
+
+/******************** LIST DATA FOLDER *****************/
+//
+// Fills outNames with the files in a data folder (":maps"), as data file paths
+// (":maps:Fairy.Tileset"), sorted by name regardless of case.
+// Returns the number of names written, at most maxNames.
+//
+
+int ListDataFolder(const char* folderName, char (*outNames)[64], int maxNames)
+{
+	std::error_code ec;
+	fs::path folderPath;
+
+	if (gDataHostPath.empty() || !FindDataPath(folderName, folderPath) || !fs::is_directory(folderPath, ec))
+	{
+		return 0;
+	}
+
+	std::vector<std::string> names;
+	for (const auto& entry : fs::directory_iterator(folderPath, ec))
+	{
+		std::string name = (const char*) entry.path().filename().u8string().c_str();
+		if (entry.is_regular_file(ec) && name[0] != '.')
+			names.push_back(name);
+	}
+
+	std::sort(names.begin(), names.end(), [](const std::string& a, const std::string& b)
+	{
+		return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+			[](char x, char y) { return tolower((unsigned char) x) < tolower((unsigned char) y); });
+	});
+
+	int numNames = 0;
+	for (const auto& name : names)
+	{
+		if (numNames >= maxNames)
+			break;
+		snprintf(outNames[numNames++], sizeof(outNames[0]), "%s:%s", folderName, name.c_str());
+	}
+
+	return numNames;
+}
+
+/******************** GET DATA FILE MOD TIME *****************/
+//
+// Gets the last modification time of a data file, in the filesystem clock's own units.
+// Only good for telling whether a file has changed since an earlier call.
+// Returns false if the file can't be found.
+//
+
+bool GetDataFileModTime(const char* fileName, int64_t* outModTime)
+{
+	std::error_code ec;
+	fs::path path;
+
+	if (gDataHostPath.empty() || !ResolveDataPath(fileName, path))
+	{
+		return false;
+	}
+
+	auto modTime = fs::last_write_time(path, ec);
+	if (ec)
+	{
+		return false;
+	}
+
+	*outModTime = (int64_t) modTime.time_since_epoch().count();
+	return true;
+}
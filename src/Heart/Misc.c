@@ -23,6 +23,9 @@
 #include "cinema.h"
 #include "externs.h"
 #include "main.h"
+#include "assetloader.h"
+#include "assetcache.h"
+#include "mappedfile.h"
 
 /****************************/
 /*    PROTOTYPES             */
@@ -37,8 +40,6 @@
 // until I get around to implementing a better solution for speed regulation.
 #define		SPINLOCK_DELAY		2
 
-#define	DECOMP_PACKET_SIZE	20000L
-
 									// FILE COMPRESSION TYPES
 									//=======================
 
@@ -69,8 +70,6 @@ Boolean		gGlobalFlagList[MAX_GLOBAL_FLAGS];
 
 static	unsigned long seed0 = 0, seed1 = 0, seed2 = 0;
 
-Byte		gRLBDecompBuffer[DECOMP_PACKET_SIZE];
-
 /**************** CLEAR GLOBAL FLAGS ****************/
 
 void ClearGlobalFlags(void)
@@ -152,6 +151,7 @@ static Boolean beenHereFlag = false;
 		goto	exit;
 
 	CleanMemory();
+	ShutdownAssetLoader();
 	ZapAllSounds();
 	CleanupDisplay();								// unloads Draw Sprocket
 
@@ -261,40 +261,88 @@ void WaitWhileMusic(void)
 	}
 }
 
-/******************** LOAD RAW FILE *****************/
+/******************** MAP MIKE FILE *****************/
+//
+// Makes the whole contents of a read-only data file available at mappedFile->data,
+// without copying it if the host lets us map it (see MappedFile.cpp).
+// Otherwise, the file is read into memory. Either way, release it with UnmapMikeFile.
+//
+// Returns false if the file can't be opened.
+//
+// Source port note: replaces LoadRawFile, which always read the file into a handle.
+//
 
-Handle LoadRawFile(const char* fileName)
+Boolean MapMikeFile(const char* fileName, MappedFile* mappedFile)
 {
 OSErr		iErr;
+FSSpec		spec;
 short		fRefNum;
 long		fileSize;
-Handle		dataHand;
+Ptr			buffer;
 
-	fRefNum = OpenMikeFile(fileName);
+	mappedFile->data = MapDataFile(fileName, &mappedFile->size);
+	mappedFile->isMapped = mappedFile->data != nil;
+
+	if (mappedFile->isMapped)
+		return true;
+
+				/* CAN'T MAP IT: READ IT */
+
+	FSMakeFSSpec(gDataSpec.vRefNum, gDataSpec.parID, fileName, &spec);
+	if (FSpOpenDF(&spec, fsRdPerm, &fRefNum) != noErr)
+		return false;
 
 	iErr = GetEOF(fRefNum, &fileSize);
 	GAME_ASSERT(iErr == noErr);
 
-	dataHand = NewHandle(fileSize);
-	GAME_ASSERT(dataHand);
+	buffer = NewPtr(fileSize);
+	GAME_ASSERT(buffer);
 
-	iErr = FSRead(fRefNum,&fileSize,*dataHand);
+	iErr = FSRead(fRefNum,&fileSize,buffer);
 	GAME_ASSERT(iErr == noErr);
 
 	iErr = FSClose(fRefNum);
 	GAME_ASSERT(iErr == noErr);
 
-	return dataHand;
+	mappedFile->data = (const uint8_t*) buffer;
+	mappedFile->size = fileSize;
+	return true;
 }
 
-/******************** LOAD PACKED FILE *****************/
+/******************** UNMAP MIKE FILE *****************/
 
-Handle LoadPackedFile(const char* fileName)
+void UnmapMikeFile(MappedFile* mappedFile)
+{
+	if (!mappedFile->data)
+		return;
+
+	if (mappedFile->isMapped)
+		UnmapDataFile(mappedFile->data, mappedFile->size);
+	else
+		DisposePtr((Ptr) mappedFile->data);
+
+	mappedFile->data = nil;
+	mappedFile->size = 0;
+	mappedFile->isMapped = false;
+}
+
+/******************** READ PACKED FILE *****************/
+//
+// Reads a packed file's header and its whole payload, and allocates the handle
+// that UnpackPackedFile fills in. Goes through the file manager: main thread only.
+//
+// If allowNative is set and the native asset cache has this file, the cached image
+// goes straight into the handle instead, and packedFile->isNative is set.
+//
+// Source port note: the original streamed the packed data through a 20K buffer.
+// Now the whole payload is read in one go and expanded from memory.
+//
+
+void ReadPackedFile(const char* fileName, PackedFile* packedFile, Boolean allowNative)
 {
 OSErr		iErr;
 short		fRefNum;
 long		fileSize;
-Handle		dataHand;
 long		numToRead;
 int32_t		decompSize;
 int32_t		decompType;
@@ -328,28 +376,46 @@ int32_t		decompType;
 
 					/* GET MEMORY FOR UNPACKED DATA */
 
-	dataHand = NewHandle(decompSize);
-	GAME_ASSERT_MESSAGE(dataHand, "No Memory for Unpacked Data!");
-
-	switch(decompType)
-	{
-		case 	PACK_TYPE_RLB:
-				DecompressRLBFile(fRefNum,*dataHand,decompSize);
-				break;
-
-		case	PACK_TYPE_RLW:
-				RLW_Expand(fRefNum,(unsigned short *)*dataHand,fileSize);
-				break;
+	packedFile->dataHand = NewHandle(decompSize);
+	GAME_ASSERT_MESSAGE(packedFile->dataHand, "No Memory for Unpacked Data!");
 
-		case	PACK_TYPE_NONE:
-				FSRead(fRefNum,&fileSize,*dataHand);
-				break;
+	packedFile->unpackedSize = decompSize;
+	packedFile->packType = decompType;
+	packedFile->packedData = nil;
+	packedFile->packedSize = 0;
+	packedFile->isNative = false;
 
-		default:
+	if (allowNative
+		&& LoadNativeAsset(fileName, fileSize + 8, decompSize, decompType, packedFile->dataHand))
+	{
+		packedFile->isNative = true;								// already unpacked & byteswapped
+	}
+	else
+	{
+		switch(decompType)
 		{
-				char error[256];
-				snprintf(error, 256, "Unsupported compression type %d", decompType);
-				DoFatalAlert(error);
+			case 	PACK_TYPE_RLB:
+			case	PACK_TYPE_RLW:
+					packedFile->packedData = NewPtr(fileSize);		// read all packed data at once
+					GAME_ASSERT_MESSAGE(packedFile->packedData, "No Memory for Packed Data!");
+
+					numToRead = fileSize;
+					iErr = FSRead(fRefNum,&numToRead,packedFile->packedData);
+					GAME_ASSERT_MESSAGE(iErr == noErr, "Error reading Packed data!");
+					packedFile->packedSize = numToRead;
+					break;
+
+			case	PACK_TYPE_NONE:
+					numToRead = fileSize < decompSize ? fileSize : decompSize;
+					FSRead(fRefNum,&numToRead,*packedFile->dataHand);	// nothing left to unpack
+					break;
+
+			default:
+			{
+					char error[256];
+					snprintf(error, 256, "Unsupported compression type %d", decompType);
+					DoFatalAlert(error);
+			}
 		}
 	}
 
@@ -358,6 +424,59 @@ int32_t		decompType;
 
 	iErr = FSClose(fRefNum);
 	GAME_ASSERT_MESSAGE(iErr == noErr, "Can't close Packed file!");
+}
+
+/******************** UNPACK PACKED FILE *****************/
+//
+// Expands the payload read by ReadPackedFile into its handle.
+// Doesn't touch the file or memory managers, so it may run on any thread.
+//
+
+void UnpackPackedFile(const PackedFile* packedFile)
+{
+	if (!packedFile->packedData)						// stored uncompressed, or came from the native cache
+		return;
+
+	const uint8_t* src = (const uint8_t*) packedFile->packedData;
+
+	if (packedFile->packType == PACK_TYPE_RLB)
+		DecompressRLB(src, packedFile->packedSize, *packedFile->dataHand, packedFile->unpackedSize);
+	else
+		RLW_Expand(src, packedFile->packedSize, (uint8_t*) *packedFile->dataHand, packedFile->unpackedSize);
+}
+
+/******************** DISPOSE PACKED DATA *****************/
+
+void DisposePackedData(PackedFile* packedFile)
+{
+	CHECKED_DISPOSEPTR(packedFile->packedData);
+	packedFile->packedSize = 0;
+}
+
+/******************** LOAD PACKED FILE *****************/
+//
+// If outIsNative is given, the data may come from the native asset cache
+// (already byteswapped), and *outIsNative says whether it did.
+//
+
+Handle LoadPackedFile(const char* fileName, Boolean* outIsNative)
+{
+PackedFile	packedFile;
+Handle		dataHand;
+Boolean		isNative = false;
+
+	dataHand = TakePrefetchedFile(fileName, outIsNative ? &isNative : nil);	// see if the asset loader already has it
+	if (!dataHand)
+	{
+		ReadPackedFile(fileName, &packedFile, outIsNative != nil);
+		UnpackPackedFile(&packedFile);
+		DisposePackedData(&packedFile);
+		dataHand = packedFile.dataHand;
+		isNative = packedFile.isNative;
+	}
+
+	if (outIsNative)
+		*outIsNative = isNative;
 
 
 					/*  DUMP UNPACKED DATA TO FILE (FOR DEBUGGING ONLY) */
@@ -386,178 +505,182 @@ int32_t		decompType;
 	return(dataHand);								// return handle to unpacked data
 }
 
-/****************** DECOMPRESS RLB FILE *******************/
-
-void	DecompressRLBFile(short fRefNum, Ptr destPtr, long decompSize)
-{
-long	numToRead;
-Byte	count,data;
-Ptr		packetStart,srcPtr;
-
-					/* GET MEMORY FOR PACK BUFFER */
-
-	packetStart = (Ptr)&gRLBDecompBuffer[0];
-
-//	if ((packetStart = AllocPtr(DECOMP_PACKET_SIZE)) == nil)
-//		DoFatalAlert2 ("No Memory for RLB UnPack Buffer!",gMemoryErr);
-
-	srcPtr = packetStart;
-
-					/* READ 1ST DATA PACKET */
+/****************** DECOMPRESS RLB *******************/
+//
+// Expands Run-Length Byte data.
+// Each count byte is followed by either one byte to repeat (count > 0x7f: 257-count times)
+// or count+1 literal bytes. Stops when the output is full or the input runs out.
+//
+// Most runs in the game's files are only a few bytes long, so short runs are written
+// as one fixed-size block when there's room for it. The bytes past the end of the run
+// get overwritten by the next runs.
+//
 
-	numToRead = DECOMP_PACKET_SIZE;							// read a packet
-	FSRead(fRefNum,&numToRead,packetStart);
+#define	SHORT_RUN_BYTES		16
 
+void DecompressRLB(const uint8_t* src, long srcSize, Ptr destPtr, long decompSize)
+{
+const uint8_t*	srcEnd = src + srcSize;
+long			count;
 
-					/* UNPACK IT */
-	do
+	while (decompSize > 0 && src < srcEnd)
 	{
-		count = *srcPtr++;									// get count byte
-		numToRead--;
-		if (numToRead <= 0)
-		{
-			numToRead = DECOMP_PACKET_SIZE;					// read a packet
-			FSRead(fRefNum,&numToRead,packetStart);
-			srcPtr = packetStart;
-		}
+		count = *src++;										// get count byte
 
 		if (count > 0x7f)									// (-) means packed data
 		{
-			count = (-count)+1;
-			data = *srcPtr++;								// get data byte
-			numToRead--;
-			if (numToRead <= 0)
-			{
-				numToRead = DECOMP_PACKET_SIZE;				// read a packet
-				FSRead(fRefNum,&numToRead,packetStart);
-				srcPtr = packetStart;
-			}
-			decompSize -= count;
-			for (;count>0; count--)
-				*destPtr++ = data;
+			if (src >= srcEnd)
+				break;
+
+			count = 257 - count;
+			if (count > decompSize)
+				count = decompSize;
 
+			if (count <= SHORT_RUN_BYTES && decompSize >= SHORT_RUN_BYTES)
+				memset(destPtr, *src, SHORT_RUN_BYTES);
+			else
+				memset(destPtr, *src, count);
+			src++;
 		}
 		else												// (+) means nonpacked data
 		{
 			count += 1;
-			decompSize -= count;
-			for (; count>0; count--)
-			{
-				*destPtr++ = *srcPtr++;						// get data byte
-				numToRead--;
-				if (numToRead <= 0)
-				{
-					numToRead = DECOMP_PACKET_SIZE;			// read a packet
-					FSRead(fRefNum,&numToRead,packetStart);
-					srcPtr = packetStart;
-				}
-			}
+			if (count > srcEnd - src)
+				count = srcEnd - src;
+			if (count > decompSize)
+				count = decompSize;
+
+			if (count <= SHORT_RUN_BYTES && decompSize >= SHORT_RUN_BYTES && srcEnd - src >= SHORT_RUN_BYTES)
+				memcpy(destPtr, src, SHORT_RUN_BYTES);
+			else
+				memcpy(destPtr, src, count);
+			src += count;
 		}
-	} while (decompSize > 0);
-
-//	DisposePtr(packetStart);					// nuke packed data buffer
 
+		destPtr += count;
+		decompSize -= count;
+	}
 }
 
-/******************** RLW EXPAND FILE *********************/
+/******************** RLW EXPAND *********************/
 //
-// Expand a Run-Length Word file
+// Expands Run-Length Word data.
+// Each length byte is followed by either one word to repeat ((length&0x7f)+1 times, if bit 7 is set)
+// or length+1 literal words. Words are copied as-is, so the output keeps the file's byte order.
+// Short runs are written as fixed-size blocks, like in DecompressRLB.
 //
 
-void RLW_Expand(short fRefNum, unsigned short *output, long sourceSize)
+void RLW_Expand(const uint8_t* src, long srcSize, uint8_t* output, long outputSize)
 {
-uint16_t	*srcOriginalPtr,*sourcePtr;
-uint8_t		*lengthPtr;
-uint16_t	runCount,seed;
-long		buffSize;
-long		numToRead;
-
-				/* GET MEMORY FOR SOURCE DATA */
+const uint8_t*	srcEnd = src + srcSize;
+long			numBytes;
 
-	srcOriginalPtr = (unsigned short *)&gRLBDecompBuffer[0];
-
-//	srcOriginalPtr = (unsigned short *)AllocPtr(DECOMP_PACKET_SIZE);
-//	if (srcOriginalPtr == nil)
-//		DoFatalAlert("Couldnt allocate memory for RLW unpack buffer!");
-
-				/* READ FIRST SOURCE PACKET */
-
-	numToRead = DECOMP_PACKET_SIZE;
-	FSRead(fRefNum, &numToRead, (Ptr) srcOriginalPtr);
-	sourcePtr = srcOriginalPtr;
-	buffSize = DECOMP_PACKET_SIZE;
-
-	while (sourceSize > 0)
+	while (src < srcEnd && outputSize > 0)
 	{
-		lengthPtr = (unsigned char *)sourcePtr;
-		runCount = *lengthPtr++;							// get length byte
-		sourcePtr = (unsigned short *)lengthPtr;
-		sourceSize--;
-		if (--buffSize == 0)								// see if need to refill buffer
-		{
-			numToRead = DECOMP_PACKET_SIZE;
-			FSRead(fRefNum, &numToRead, (Ptr) srcOriginalPtr);
-			sourcePtr = srcOriginalPtr;
-			buffSize = DECOMP_PACKET_SIZE;
-		}
-		if (runCount&0x80)									// see if packed stream or not
+		numBytes = *src++;									// get length byte
+
+		if (numBytes & 0x80)								// see if packed stream or not
 		{
 					/* DECODE PACKED STREAM */
 
-			if (buffSize == 1)								// if only 1 byte in buffer, then adjust & reload
+			if (srcEnd - src < 2)
+				break;
+
+			numBytes = ((numBytes & 0x7f) + 1) * 2;
+			if (numBytes > outputSize)
+				numBytes = outputSize;
+
+			if (numBytes <= SHORT_RUN_BYTES && outputSize >= SHORT_RUN_BYTES)
 			{
-				SetFPos(fRefNum,fsFromMark,-1);
-				numToRead = DECOMP_PACKET_SIZE;
-				FSRead(fRefNum, &numToRead, (Ptr) srcOriginalPtr);
-				sourcePtr = srcOriginalPtr;
-				buffSize = DECOMP_PACKET_SIZE;
+				for (int i = 0; i < SHORT_RUN_BYTES; i += 2)
+				{
+					output[i] = src[0];
+					output[i+1] = src[1];
+				}
 			}
-			seed = *sourcePtr++;							// get the packed seed
-			sourceSize -= 2;
-			if ((buffSize -= 2) == 0)						// see if need to refill buffer
+			else if (src[0] == src[1])						// both bytes of the seed are the same
 			{
-				numToRead = DECOMP_PACKET_SIZE;
-				FSRead(fRefNum, &numToRead, (Ptr) srcOriginalPtr);
-				sourcePtr = srcOriginalPtr;
-				buffSize = DECOMP_PACKET_SIZE;
+				memset(output, src[0], numBytes);
 			}
-
-			runCount = (runCount&0x7f)+1;					// get counter
-			for (; runCount; runCount--)
+			else
 			{
-				*output++ = seed;
+				const uint8_t pattern[8] = { src[0], src[1], src[0], src[1], src[0], src[1], src[0], src[1] };
+				long i = 0;
+
+				for (; i + 8 <= numBytes; i += 8)				// 4 words at a time
+					memcpy(output + i, pattern, 8);
+				for (; i < numBytes; i++)
+					output[i] = pattern[i & 1];
 			}
+
+			src += 2;
 		}
 		else
 		{
 					/* DECODE UNPACKED STREAM */
 
-			runCount++;
-			for (; runCount; runCount--)
-			{
-				if (buffSize == 1)								// if only 1 byte in buffer, then adjust & reload
-				{
-					SetFPos(fRefNum,fsFromMark,-1);
-					numToRead = DECOMP_PACKET_SIZE;
-					FSRead(fRefNum, &numToRead, (Ptr) srcOriginalPtr);
-					sourcePtr = srcOriginalPtr;
-					buffSize = DECOMP_PACKET_SIZE;
-				}
-				*output++ = *sourcePtr++;
-				sourceSize-=2;
-				if ((buffSize -= 2) == 0)						// see if need to refill buffer
-				{
-					numToRead = DECOMP_PACKET_SIZE;
-					FSRead(fRefNum, &numToRead, (Ptr) srcOriginalPtr);
-					sourcePtr = srcOriginalPtr;
-					buffSize = DECOMP_PACKET_SIZE;
-				}
-			}
+			numBytes = (numBytes + 1) * 2;
+			if (numBytes > srcEnd - src)
+				numBytes = srcEnd - src;
+			if (numBytes > outputSize)
+				numBytes = outputSize;
+
+			if (numBytes <= SHORT_RUN_BYTES && outputSize >= SHORT_RUN_BYTES && srcEnd - src >= SHORT_RUN_BYTES)
+				memcpy(output, src, SHORT_RUN_BYTES);
+			else
+				memcpy(output, src, numBytes);
+			src += numBytes;
+		}
+
+		output += numBytes;
+		outputSize -= numBytes;
+	}
+}
+
+#if _DEBUG
+/******************** BENCHMARK PACKED FILES *********************/
+//
+// Times LoadPackedFile on every file in the Maps and Shapes folders.
+//
+
+void BenchmarkPackedFiles(void)
+{
+const int	numPasses = 10;
+char		paths[128][64];
+int			numPaths = 0;
+double		totalMicros = 0;
+long		totalBytes = 0;
+
+	numPaths += ListDataFolder(":maps", paths + numPaths, (int) (sizeof(paths)/sizeof(paths[0])) - numPaths);
+	numPaths += ListDataFolder(":shapes", paths + numPaths, (int) (sizeof(paths)/sizeof(paths[0])) - numPaths);
+
+	FlushPrefetchedFiles();								// or LoadPackedFile would just take the prefetched copy
+
+	printf("file                           unpacked     us/load\n");
+
+	for (int i = 0; i < numPaths; i++)
+	{
+		long unpackedSize = 0;
+
+		uint64_t t0 = SDL_GetPerformanceCounter();
+		for (int pass = 0; pass < numPasses; pass++)
+		{
+			Handle h = LoadPackedFile(paths[i], nil);
+			unpackedSize = GetHandleSize(h);
+			DisposeHandle(h);
 		}
+		uint64_t t1 = SDL_GetPerformanceCounter();
+
+		double us = (double) (t1 - t0) * 1e6 / (double) SDL_GetPerformanceFrequency() / numPasses;
+		printf("%-30s %8ld %11.0f\n", paths[i], unpackedSize, us);
+
+		totalMicros += us;
+		totalBytes += unpackedSize;
 	}
 
-//	DisposPtr((Ptr)srcOriginalPtr);
+	printf("%-30s %8ld %11.0f\n", "TOTAL", totalBytes, totalMicros);
 }
+#endif
 
 
 /******************** REGULATE SPEED ***************/
@@ -722,6 +845,7 @@ void FillThermometer(short percent)
 
 		gScreenBlankedFlag = false;
 		LoadImage(":images:charging.tga", LOADIMAGE_FADEIN);
+		MarkDirtyFramebufferRows(top, bottom-top+1);
 
 																			// draw thermometer box
 		memset(gScreenLookUpTable[top] + left, borderColor, width);			// top line
@@ -737,6 +861,7 @@ void FillThermometer(short percent)
 				/* FILL THERMOMETER */
 
 		int filledWidth = (width-2) * percent / 100;
+		MarkDirtyFramebufferRows(top+1, bottom-top-1);
 		for (int y = top+1; y < bottom; y++)
 		{
 			memset(gScreenLookUpTable[y] + left+1, fillColor, filledWidth);
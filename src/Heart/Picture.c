@@ -67,6 +67,7 @@ void LoadImage(const char* fileName, short showMode)
 	{
 		destPtr = gIndexedFramebuffer;
 		destRowBytes = VISIBLE_WIDTH;
+		MarkDirtyFramebuffer();
 	}
 
 				/* OFFSET DESTINATION POINTER */
@@ -0,0 +1,240 @@
+// FRAME PROFILER
+// This file is part of Mighty Mike. https://github.com/jorio/mightymike
+//
+// Records a span for each stage of the core loop (and for each converter thread's share of a frame)
+// into a fixed-size ring buffer. The buffer is dumped on demand as a Chrome trace (load it in
+// chrome://tracing or ui.perfetto.dev) and as a CSV file, so frame spikes can be tracked down
+// after the fact.
+//
+// Enable with --profile on the command line. F11 dumps the last few thousand frames while in-game.
+// A final dump is written when the game quits.
+
+#include <SDL.h>
+#include <stdio.h>
+#include "myglobals.h"
+#include "externs.h"
+#include "misc.h"
+#include "framebufferfilter.h"
+#include "profiler.h"
+
+/****************************/
+/*    CONSTANTS             */
+/****************************/
+
+#define PROFILE_RING_SIZE	(1 << 17)		// must be a power of two. ~20 spans per frame: about a minute at 100 fps
+#define PROFILE_RING_MASK	(PROFILE_RING_SIZE - 1)
+
+static const char* kProfileStageNames[kProfile_COUNT] =
+{
+	"ReadKeyboard",
+	"MoveObjects",
+	"SortObjectsByY",
+	"ScrollPlayfield",
+	"UpdateTileAnimation",
+	"DrawObjects",
+	"DisplayPlayfield",
+	"UpdateInfoBar",
+	"EraseObjects",
+	"Present",
+	"Convert",
+	"LatchFrame",
+	"WaitForConvert",
+	"ConvertTiles",
+	"Upload",
+	"Frame",
+};
+
+/****************************/
+/*    VARIABLES             */
+/****************************/
+
+typedef struct
+{
+	uint64_t		start;			// performance counter ticks since InitProfiler
+	uint32_t		duration;		// performance counter ticks
+	uint32_t		frame;
+	uint16_t		stage;
+	uint16_t		thread;
+	uint32_t		sequence;		// written last: index in the stream + 1, so the dump can skip half-written spans
+} ProfileSpan;
+
+Boolean						gProfilerEnabled		= false;
+
+static ProfileSpan*			gProfileRing			= NULL;
+static SDL_atomic_t			gProfileNextSpan;
+static SDL_atomic_t			gProfileFrame;
+static uint64_t				gProfileOrigin			= 0;
+static uint64_t				gProfileFrameStart		= 0;
+static int					gProfileNumDumps		= 0;
+
+
+/****************** INIT PROFILER ********************/
+
+void InitProfiler(void)
+{
+	if (gProfileRing)
+	{
+		return;
+	}
+
+	gProfileRing = (ProfileSpan*) NewPtrClear(PROFILE_RING_SIZE * (long) sizeof(ProfileSpan));
+	GAME_ASSERT(gProfileRing);
+
+	SDL_AtomicSet(&gProfileNextSpan, 0);
+	SDL_AtomicSet(&gProfileFrame, 0);
+
+	gProfileOrigin = SDL_GetPerformanceCounter();
+	gProfileFrameStart = 0;
+
+	gProfilerEnabled = true;
+}
+
+/****************** GET PROFILER TIME ********************/
+
+uint64_t GetProfilerTime(void)
+{
+	return SDL_GetPerformanceCounter() - gProfileOrigin;
+}
+
+/****************** RECORD PROFILER SPAN ********************/
+//
+// Safe to call from any thread. startTime comes from GetProfilerTime; the span ends now.
+//
+
+void RecordProfilerSpan(int stage, int thread, uint64_t startTime)
+{
+	if (!gProfilerEnabled)
+	{
+		return;
+	}
+
+	uint64_t now = GetProfilerTime();
+	uint32_t index = (uint32_t) SDL_AtomicAdd(&gProfileNextSpan, 1);
+
+	ProfileSpan* span = &gProfileRing[index & PROFILE_RING_MASK];
+	span->sequence	= 0;							// invalidate while we overwrite it
+	SDL_MemoryBarrierRelease();
+	span->start		= startTime;
+	span->duration	= (uint32_t) (now - startTime);
+	span->frame		= (uint32_t) SDL_AtomicGet(&gProfileFrame);
+	span->stage		= (uint16_t) stage;
+	span->thread	= (uint16_t) thread;
+	SDL_MemoryBarrierRelease();
+	span->sequence	= index + 1;
+}
+
+/****************** ADVANCE PROFILER FRAME ********************/
+//
+// Call once per presented frame. Records a span covering the whole frame.
+//
+
+void AdvanceProfilerFrame(void)
+{
+	if (!gProfilerEnabled)
+	{
+		return;
+	}
+
+	uint64_t now = GetProfilerTime();
+	if (gProfileFrameStart != 0)
+	{
+		RecordProfilerSpan(kProfile_Frame, kProfileThread_Main, gProfileFrameStart);
+	}
+	gProfileFrameStart = now;
+
+	SDL_AtomicAdd(&gProfileFrame, 1);
+}
+
+/****************** DUMP PROFILE ********************/
+//
+// Writes the contents of the ring buffer to profile-N.json (Chrome trace) and profile-N.csv
+// in the working directory.
+//
+
+static void GetThreadName(int thread, char* name, size_t nameSize)
+{
+	if (thread == kProfileThread_Main)
+		snprintf(name, nameSize, "Main");
+	else
+		snprintf(name, nameSize, "Renderer %02d", thread - kProfileThread_FirstConverter);	// same names as the OS threads
+}
+
+void DumpProfile(void)
+{
+	if (!gProfilerEnabled)
+	{
+		return;
+	}
+
+	char jsonPath[64];
+	char csvPath[64];
+	snprintf(jsonPath, sizeof(jsonPath), "profile-%d.json", gProfileNumDumps);
+	snprintf(csvPath, sizeof(csvPath), "profile-%d.csv", gProfileNumDumps);
+	gProfileNumDumps++;
+
+	FILE* json = fopen(jsonPath, "wb");
+	FILE* csv = fopen(csvPath, "wb");
+	if (!json || !csv)
+	{
+		if (json) fclose(json);
+		if (csv) fclose(csv);
+		DoAlert("Couldn't open profile file");
+		return;
+	}
+
+	double ticksToMicros = 1e6 / (double) SDL_GetPerformanceFrequency();
+
+	fprintf(json, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(csv, "frame,thread,stage,start_us,duration_us\n");
+
+			/* NAME THE THREADS */
+
+	for (int thread = 0; thread < kProfileThread_FirstConverter + MAX_RENDER_THREADS; thread++)
+	{
+		char threadName[32];
+		GetThreadName(thread, threadName, sizeof(threadName));
+		fprintf(json, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n",
+				thread, threadName);
+	}
+
+			/* WRITE SPANS, OLDEST FIRST */
+
+	uint32_t end = (uint32_t) SDL_AtomicGet(&gProfileNextSpan);
+	uint32_t begin = end > PROFILE_RING_SIZE ? end - PROFILE_RING_SIZE : 0;
+	int numSpans = 0;
+
+	for (uint32_t index = begin; index != end; index++)
+	{
+		const ProfileSpan* slot = &gProfileRing[index & PROFILE_RING_MASK];
+
+		if (slot->sequence != index + 1)				// not written yet, or already overwritten by a newer span
+			continue;
+		SDL_MemoryBarrierAcquire();
+		ProfileSpan span = *slot;
+		SDL_MemoryBarrierAcquire();
+		if (slot->sequence != index + 1)				// got overwritten while we were copying it
+			continue;
+
+		const char* stageName = kProfileStageNames[span.stage];
+		char threadName[32];
+		GetThreadName(span.thread, threadName, sizeof(threadName));
+		double startMicros = span.start * ticksToMicros;
+		double durationMicros = span.duration * ticksToMicros;
+
+		fprintf(json, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}},\n",
+				stageName, span.thread, startMicros, durationMicros, span.frame);
+
+		fprintf(csv, "%u,%s,%s,%.3f,%.3f\n",
+				span.frame, threadName, stageName, startMicros, durationMicros);
+
+		numSpans++;
+	}
+
+	// Trailing dummy event so the array doesn't end with a comma
+	fprintf(json, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Mighty Mike\"}}\n]}\n");
+
+	fclose(json);
+	fclose(csv);
+
+	printf("wrote %d spans to %s and %s\n", numSpans, jsonPath, csvPath);
+}
@@ -157,6 +157,28 @@ static MenuItem gVideoMenu[] =
 			.choices = { "32 fps, like original", "smooth" },
 		}
 	},
+#if !OSXPPC
+	{
+		.type = kMenuItem_Cycler, .cycler =
+		{
+			.caption = "render pipelining",
+			.callback = nil,
+			.valuePtr = &gGamePrefs.pipelinedPresent,
+			.numChoices = 2,
+			.choices = { "off, lowest latency", "on, faster on multicore" },
+		}
+	},
+#endif
+	{
+		.type = kMenuItem_Cycler, .cycler =
+		{
+			.caption = "playfield copy",
+			.callback = nil,
+			.valuePtr = &gGamePrefs.fusedPlayfieldCopy,
+			.numChoices = 2,
+			.choices = { "separate pass", "fused with conversion" },
+		}
+	},
 	{ .type = kMenuItem_Separator },
 	{
 		.type = kMenuItem_Cycler, .cycler =
@@ -592,7 +614,8 @@ static void OnChangePlayfieldSizeViaSettings(void)
 
 static void OnChangeDebugInfoInTitleBar(void)
 {
-	SDL_SetWindowTitle(gSDLWindow, "Mighty Mike " PROJECT_VERSION);
+	if (!gHeadless)
+		SDL_SetWindowTitle(gSDLWindow, "Mighty Mike " PROJECT_VERSION);
 }
 
 static void OnResetKeys(void)
@@ -43,26 +43,17 @@ struct SpinExtendedHeaderType
 };
 typedef struct SpinExtendedHeaderType SpinExtendedHeaderType;
 
-
-#define	SPIN_LOAD_SEG_SIZE		5000L				// # bytes to continue loading each frame (timing is more stable with smaller numbers)
-
 /**********************/
 /*     VARIABLES      */
 /**********************/
 
-static	Handle		gSpinFileHandle;
-static	Ptr			gSpinPtr;						// ptr into gSpinFileHandle
-static	Ptr			gSpinLoadPtr;					// ptr to location to continue loading data
+static	MappedFile	gSpinFile;						// whole SPIN file (read-only)
+static	Ptr			gSpinPtr;						// ptr into gSpinFile
 
 static	SpinExtendedHeaderType	gSpinHeader;
 
 static	short			gSpinX,gSpinY;
 
-
-static	short	gSpinfRefNum;						// fRefNum for SPIN file
-static	long	gSpinFileSize;						// remaining file size for SPIN file
-static	long	gSpinReadSize;						// amount if file already read
-
 static	Boolean	gDoublePix;
 
 /******************** PLAY SPIN FILE *********************/
@@ -124,85 +115,32 @@ unsigned long	time;
 
 				/* CLEANUP AND EXIT */
 bye:
-	DisposeHandle(gSpinFileHandle);							// zap the file
-	FSClose(gSpinfRefNum);									// close the file
+	UnmapMikeFile(&gSpinFile);								// zap the file
 }
 
 
 /******************* PRE-LOAD SPIN FILE ******************/
 //
-// Open SPIN file and preload initial data
+// Open SPIN file and make all of its data available
+//
+// Source port note: the original read a preload amount up front, then kept reading
+// the rest of the file in 5K segments as frames needed it (ContinueSpinLoad).
+// The file is now mapped whole (or read whole if it can't be mapped), so the movie
+// plays straight from it.
 //
 
-void PreLoadSpinFile(const char* fileName, long preLoadSize)
+void PreLoadSpinFile(const char* fileName)
 {
-OSErr		iErr;
-
 			/* PREPARE SCREEN */
 
 	BlankEntireScreenArea();
 
+					/*  MAP THE FILE */
 
-					/*  OPEN THE FILE */
-
-	gSpinfRefNum = OpenMikeFile(fileName);
-
-					/* GET SIZE OF FILE */
-
-	iErr = GetEOF(gSpinfRefNum, &gSpinFileSize);
-	GAME_ASSERT_MESSAGE(iErr == noErr, "Err SPIN file EOF!");
+	if (!MapMikeFile(fileName, &gSpinFile))
+		DoFatalAlert2("Cannot open data file", fileName);
 
-				/* ALLOC MEMORY FOR THE FILE */
-
-	gSpinFileHandle = NewHandle(gSpinFileSize);
-	GAME_ASSERT_MESSAGE(gSpinFileHandle, "Sorry, not enough memory to play SPIN file movie!");
-	gSpinPtr = *gSpinFileHandle;								// set master process pointer
-	gSpinLoadPtr = *gSpinFileHandle;							// set load pointer
-
-				/* READ THE FILE */
-
-	if (preLoadSize > gSpinFileSize)							// see if preloading too much
-		preLoadSize = gSpinFileSize;
-
-	iErr = FSRead(gSpinfRefNum,&preLoadSize,gSpinLoadPtr);		// read the preLoad amount only
-	GAME_ASSERT_MESSAGE(iErr == noErr, "Can't Read SPIN file!");
-
-	gSpinLoadPtr += preLoadSize;								// set ptr to next load
-	gSpinFileSize -= preLoadSize;								// dec size of remaining data
-
-	gSpinReadSize = preLoadSize;								// set amount read
-}
-
-
-/***************** CONTINUE SPIN LOAD ***********************/
-//
-// returns true if anything was loaded
-//
-
-Boolean ContinueSpinLoad(void)
-{
-long	numBytes;
-OSErr	iErr;
-
-	if (!gSpinFileSize)											// see if anything to load
-		return(false);
-
-	numBytes = SPIN_LOAD_SEG_SIZE;								// assume load max
-
-	if (numBytes > gSpinFileSize)								// see if too much
-		numBytes = gSpinFileSize;
-
-				/* READ THE FILE */
-
-	iErr = FSRead(gSpinfRefNum,&numBytes,gSpinLoadPtr);			// read it
-	if (iErr != noErr)
-		DoFatalAlert("Cant Continue to Read SPIN file!");
-
-	gSpinLoadPtr += numBytes;									// set ptr to next load
-	gSpinFileSize -= numBytes;									// dec size of remaining data
-
-	gSpinReadSize += numBytes;									// update size counter
-	return(true);
+	gSpinPtr = (Ptr) gSpinFile.data;							// set master process pointer (read only!)
 }
 
 
@@ -329,12 +267,6 @@ Ptr		framePtrBase;
 			count++;
 			frameSize -= count;
 
-			while(srcPtr+count+200 > gSpinLoadPtr)			// see if @ end of current buffer (200 is leeway margin)
-			{
-				if (!ContinueSpinLoad())					// keep loading until we have enough or its @ EOF
-					break;
-			}
-
 			memcpy(framePtr, srcPtr, count);
 			framePtr += count;
 			srcPtr += count;
@@ -374,6 +306,7 @@ void DrawSpinFrame(Ptr srcPtr)
 		size *= 4;											// memory copy on 68k.
 
 		uint8_t* destPtr = gScreenLookUpTable[y+gSpinY] + gSpinX + x;	// point to screen
+		MarkDirtyFramebufferRows(y+gSpinY, 1);
 		memcpy(destPtr, srcPtr, size);						// copy data
 		srcPtr += size;
 
@@ -20,6 +20,8 @@
 #include "input.h"
 #include "externs.h"
 #include "renderdrivers.h"
+#include "framebufferfilter.h"
+#include "profiler.h"
 #include "version.h"
 
 /****************************/
@@ -52,6 +54,13 @@ int				gEffectiveScalingType = kScaling_Stretch;
 
 uint8_t*		gRowDitherStrides = nil;		// for dithering filter
 
+uint8_t*		gDirtyFramebufferRows = nil;	// [VISIBLE_HEIGHT] nonzero if row changed since last present
+int				gNumDirtyFramebufferRows = 0;
+uint8_t*		gPlayfieldFramebufferRows = nil;	// [VISIBLE_HEIGHT] nonzero if the playfield part of the row is a straight copy of the PF buffer
+
+int16_t*		gPFTileCells = nil;				// [PF_TILE_HEIGHT*PF_TILE_WIDTH] tile definition drawn in each PF buffer cell, -1 if unknown
+uint8_t*		gPFSpriteCells = nil;			// [PF_TILE_HEIGHT*PF_TILE_WIDTH] nonzero if a sprite was drawn over the cell
+
 										// GAME STUFF
 Handle			gBackgroundHandle = nil;
 Handle			gOffScreenHandle = nil;
@@ -114,6 +123,8 @@ void DumpGameWindow(void)
 	uint8_t* destPtr	= gIndexedFramebuffer;
 	uint8_t* srcPtr		= (uint8_t *)(gOffScreenLookUpTable[0]+WINDOW_OFFSET);
 
+	MarkDirtyFramebuffer();
+
 						/* DO THE QUICK COPY */
 
 	for (int y = 0; y < VISIBLE_HEIGHT; y++)
@@ -159,6 +170,7 @@ long		size;
 	if (gGamePrefs.interlaceMode)
 	{
 		destPtr = gScreenLookUpTable[PF_WINDOW_TOP+1] + PF_WINDOW_LEFT;
+		MarkDirtyFramebufferRows(PF_WINDOW_TOP+1, PF_WINDOW_HEIGHT);
 
 		for (short height = PF_WINDOW_HEIGHT>>1; height > 0; height--)
 		{
@@ -186,6 +198,9 @@ Rect	r;
 
 static void DisposeScreenBuffers(void)
 {
+	CancelConvertFramebufferMT();			// converter threads may still be using the buffers
+	FlushPlayfieldCopy();					// nobody may copy into the buffers once they're gone
+
 	CHECKED_DISPOSEPTR(gIndexedFramebuffer);
 
 	CHECKED_DISPOSEHANDLE(gOffScreenHandle);
@@ -204,6 +219,12 @@ static void DisposeScreenBuffers(void)
 	CHECKED_DISPOSEHANDLE(gPFMaskBufferHandle);
 
 	CHECKED_DISPOSEPTR(gRowDitherStrides);
+	CHECKED_DISPOSEPTR(gDirtyFramebufferRows);
+	CHECKED_DISPOSEPTR(gPlayfieldFramebufferRows);
+	gNumDirtyFramebufferRows = 0;
+
+	CHECKED_DISPOSEPTR(gPFTileCells);
+	CHECKED_DISPOSEPTR(gPFSpriteCells);
 }
 
 /********************* INIT SCREEN BUFFERS ***********************/
@@ -290,9 +311,114 @@ static void InitScreenBuffers(void)
 		gPFMaskLookUpTable[i]	= (uint8_t*)(*gPFMaskBufferHandle)	+ (i * PF_BUFFER_WIDTH);
 	}
 
-					/* BUILD DITHERING FILTER BUFFER */
+					/* BUILD PLAYFIELD CELL MAPS */
+
+	gPFTileCells	= (int16_t*) NewPtr(PF_TILE_HEIGHT * PF_TILE_WIDTH * sizeof(int16_t));
+	gPFSpriteCells	= (uint8_t*) NewPtrClear(PF_TILE_HEIGHT * PF_TILE_WIDTH);
+	GAME_ASSERT(gPFTileCells);
+	GAME_ASSERT(gPFSpriteCells);
+	memset(gPFTileCells, 0xFF, PF_TILE_HEIGHT * PF_TILE_WIDTH * sizeof(int16_t));	// no tiles drawn yet
+
+					/* BUILD DITHERING FILTER BUFFERS */
 
 	gRowDitherStrides = (uint8_t*) NewPtrClear(gNumThreads * VISIBLE_WIDTH);
+
+	gPlayfieldFramebufferRows = (uint8_t*) NewPtrClear(VISIBLE_HEIGHT);
+	GAME_ASSERT(gPlayfieldFramebufferRows);
+
+					/* BUILD DIRTY ROW LIST */
+
+	gDirtyFramebufferRows = (uint8_t*) NewPtrClear(VISIBLE_HEIGHT);
+	GAME_ASSERT(gDirtyFramebufferRows);
+	MarkDirtyFramebuffer();
+}
+
+#pragma mark -
+
+/******************** MARK DIRTY FRAMEBUFFER ROWS ***********************/
+//
+// Anything that writes to gIndexedFramebuffer must flag the rows it touched,
+// so that the next present converts & uploads them. Rows that aren't flagged
+// keep whatever the renderer converted for them last time.
+//
+
+void MarkDirtyFramebufferRows(int firstRow, int numRows)
+{
+	if (!gDirtyFramebufferRows)						// screen buffers not made yet
+		return;
+
+	int endRow = firstRow + numRows;
+
+	if (firstRow < 0)
+		firstRow = 0;
+	if (endRow > VISIBLE_HEIGHT)
+		endRow = VISIBLE_HEIGHT;
+
+	for (int y = firstRow; y < endRow; y++)
+	{
+		gNumDirtyFramebufferRows += !gDirtyFramebufferRows[y];
+		gDirtyFramebufferRows[y] = 1;
+		gPlayfieldFramebufferRows[y] = 0;			// DisplayPlayfield sets this back if it's the one drawing
+	}
+}
+
+/******************** MARK DIRTY FRAMEBUFFER ***********************/
+//
+// Forces the entire screen to be reconverted on next present,
+// e.g. after a palette change.
+//
+
+void MarkDirtyFramebuffer(void)
+{
+	MarkDirtyFramebufferRows(0, VISIBLE_HEIGHT);
+}
+
+/******************** CLEAR DIRTY FRAMEBUFFER ROWS ***********************/
+
+void ClearDirtyFramebufferRows(void)
+{
+	if (gDirtyFramebufferRows)
+		memset(gDirtyFramebufferRows, 0, VISIBLE_HEIGHT);
+
+	gNumDirtyFramebufferRows = 0;
+}
+
+/******************** GET NEXT DIRTY ROW RUN ***********************/
+//
+// Finds the first run of consecutive nonzero entries of dirtyRows in [fromRow, endRow).
+// Returns the first row of the run (and its length in outNumRows), or -1 if none.
+//
+
+int GetNextDirtyRowRun(const uint8_t* dirtyRows, int fromRow, int endRow, int* outNumRows)
+{
+	int y = fromRow;
+
+	while (y < endRow && !dirtyRows[y])
+		y++;
+
+	if (y >= endRow)
+	{
+		*outNumRows = 0;
+		return -1;
+	}
+
+	int runStart = y;
+
+	while (y < endRow && dirtyRows[y])
+		y++;
+
+	*outNumRows = y - runStart;
+	return runStart;
+}
+
+/******************** GET NEXT DIRTY FRAMEBUFFER RUN ***********************/
+//
+// Finds the first run of rows in [fromRow, endRow) that changed since the last present.
+//
+
+int GetNextDirtyFramebufferRun(int fromRow, int endRow, int* outNumRows)
+{
+	return GetNextDirtyRowRun(gDirtyFramebufferRows, fromRow, endRow, outNumRows);
 }
 
 
@@ -353,6 +479,8 @@ long	x,y;
 
 	destPtr = gScreenLookUpTable[y] + x;			// calc write addr
 
+	MarkDirtyFramebufferRows(y, height);
+
 						/* DO THE ERASE */
 
 	for (; height > 0; height--)
@@ -387,10 +515,13 @@ void SetScreenOffsetFor640x480(void)
 
 void CleanupDisplay(void)
 {
+	if (gHeadless)
+		NullRender_Shutdown();
+	else
 #if GLRENDER
-	GLRender_Shutdown();
+		GLRender_Shutdown();
 #else
-	SDLRender_Shutdown();
+		SDLRender_Shutdown();
 #endif
 
 	DisposeScreenBuffers();
@@ -448,10 +579,11 @@ void DumpIndexedTGA(const char* hostPath, int width, int height, const char* dat
 }
 #endif
 
-void PresentIndexedFramebuffer(void)
+static void PresentFramebuffer(Boolean pipelined)
 {
 	if (gScreenBlankedFlag)		// CLUT was blanked (in-between a fade-out and a fade-in), ignore
 	{
+		FlushPlayfieldCopy();
 		return;
 	}
 
@@ -459,19 +591,47 @@ void PresentIndexedFramebuffer(void)
 	// Check screenshot key
 	if (GetNewSDLKeyState(SDL_SCANCODE_F12))
 	{
+		FlushPlayfieldCopy();
 		SaveIndexedScreenshot();
 	}
 #endif
 
+	//-------------------------------------------------------------------------
+	// Filter setting changed: reconvert everything
+
+	static Boolean previousFilterDithering = false;
+	if (previousFilterDithering != gGamePrefs.filterDithering)
+	{
+		previousFilterDithering = gGamePrefs.filterDithering;
+		MarkDirtyFramebuffer();
+	}
+
 	//-------------------------------------------------------------------------
 	// Present framebuffer
 
+	uint64_t presentStart = gProfilerEnabled ? GetProfilerTime() : 0;
+
+	if (pipelined)									// the pipeline latches the framebuffer as is
+		FlushPlayfieldCopy();
+
+	if (gHeadless)
+		NullRender_PresentFramebuffer(pipelined);
+	else
 #if GLRENDER
-	GLRender_PresentFramebuffer();
+		GLRender_PresentFramebuffer(pipelined);
 #else
-	SDLRender_PresentFramebuffer();
+		SDLRender_PresentFramebuffer(pipelined);
 #endif
 
+	FlushPlayfieldCopy();							// in case the renderer didn't convert the frame
+	ClearDirtyFramebufferRows();					// renderer is now up to date (or has a copy of the dirty rows)
+
+	if (gProfilerEnabled)
+	{
+		RecordProfilerSpan(kProfile_Present, kProfileThread_Main, presentStart);
+		AdvanceProfilerFrame();
+	}
+
 	//-------------------------------------------------------------------------
 	// Update debug info
 
@@ -480,16 +640,17 @@ void PresentIndexedFramebuffer(void)
 	uint32_t ticksElapsed = ticksNow - gDebugTextLastUpdatedAt;
 	if (ticksElapsed >= kDebugTextUpdateInterval)
 	{
-		if (gGamePrefs.debugInfoInTitleBar && gGamePrefs.displayMode == kDisplayMode_Windowed)
+		if (gGamePrefs.debugInfoInTitleBar && gGamePrefs.displayMode == kDisplayMode_Windowed && !gHeadless)
 		{
 			float fps = 1000 * gDebugTextFrameAccumulator / (float)ticksElapsed;
 			snprintf(
 					gDebugTextBuffer, sizeof(gDebugTextBuffer),
-					"Mike%s %s scl:%c thr:%d fps:%d obj:%ld x:%ld y:%ld",
+					"Mike%s %s scl:%c thr:%d%s fps:%d obj:%ld x:%ld y:%ld",
 					PROJECT_VERSION,
 					gRendererName,
 					'A' + gEffectiveScalingType,
 					gNumThreads,
+					pipelined ? "p" : "",
 					(int)roundf(fps),
 					NumObjects,
 					gMyX,
@@ -502,6 +663,29 @@ void PresentIndexedFramebuffer(void)
 	}
 }
 
+/****************** PRESENT INDEXED FRAMEBUFFER *************************/
+//
+// Converts and shows the frame right away.
+// If the previous frame was presented with PresentIndexedFramebufferPipelined, it gets flushed first.
+//
+
+void PresentIndexedFramebuffer(void)
+{
+	PresentFramebuffer(false);
+}
+
+/****************** PRESENT INDEXED FRAMEBUFFER: PIPELINED *************************/
+//
+// For the in-game loop. If the player enabled it, the frame gets converted in the background
+// while the main thread moves on to the next frame, and it's shown on the next present.
+// This trades one frame of latency for throughput on multicore machines.
+//
+
+void PresentIndexedFramebufferPipelined(void)
+{
+	PresentFramebuffer(gGamePrefs.pipelinedPresent && gNumThreads > 1);
+}
+
 static void MoveToPreferredDisplay(void)
 {
 #if !(__APPLE__)
@@ -519,6 +703,9 @@ static void MoveToPreferredDisplay(void)
 
 void SetFullscreenMode(bool enforceDisplayPref)
 {
+	if (gHeadless)		// no window
+		return;
+
 #if OSXPPC
 	if (gGamePrefs.displayMode == kDisplayMode_Windowed)
 	{
@@ -579,6 +766,9 @@ int GetMaxIntegerZoom(int displayWidth, int displayHeight)
 
 int GetMaxIntegerZoomForPreferredDisplay(void)
 {
+	if (gHeadless)		// no display
+		return 1;
+
 	int currentDisplay = SDL_GetWindowDisplayIndex(gSDLWindow);
 
 #if !(__APPLE__)
@@ -599,6 +789,9 @@ int GetMaxIntegerZoomForPreferredDisplay(void)
 
 void SetOptimalWindowSize(void)
 {
+	if (gHeadless)		// no window
+		return;
+
 	Uint32 windowFlags = SDL_GetWindowFlags(gSDLWindow);
 	SDL_RestoreWindow(gSDLWindow);
 
@@ -628,6 +821,9 @@ void SetOptimalWindowSize(void)
 
 static int GetEffectiveScalingType(void)
 {
+	if (gHeadless)		// no window, convert at 1x
+		return kScaling_Stretch;
+
 	int windowWidth = VISIBLE_WIDTH;
 	int windowHeight = VISIBLE_HEIGHT;
 
@@ -685,7 +881,8 @@ void OnChangeIntegerScaling(void)
 	gEffectiveScalingType = GetEffectiveScalingType();
 
 #if !(GLRENDER)
-	SDLRender_InitTexture();
+	if (!gHeadless)
+		SDLRender_InitTexture();
 #endif
 }
 
@@ -34,8 +34,13 @@ char				gTextInput[SDL_TEXTINPUTEVENT_TEXT_SIZE];
 
 Byte				gNeedStates[NUM_CONTROL_NEEDS];
 
+static int32_t		gLeftStickMagnitude = 0;			// sampled once per UpdateInput, so that demos can override it
+static short		gRightStickAim = AIM_NONE;
+
 static void ParseAltEnter(void);
 static void OnJoystickRemoved(SDL_JoystickID which);
+static int32_t ReadLeftStickMagnitude_Fix32(void);
+static short ReadRightStick8WayAim(void);
 
 /****************************/
 /*    CONSTANTS             */
@@ -127,9 +132,18 @@ void UpdateInput(void)
 			case SDL_WINDOWEVENT_RESIZED:
 				OnChangeIntegerScaling();
 				break;
+
+			case SDL_WINDOWEVENT_EXPOSED:
+				MarkDirtyFramebuffer();		// window contents need redrawing (screens that idle without presenting rely on this)
+				break;
 			}
 			break;
 
+		case SDL_RENDER_TARGETS_RESET:
+		case SDL_RENDER_DEVICE_RESET:
+			MarkDirtyFramebuffer();		// texture contents may have been lost
+			break;
+
 		case SDL_TEXTINPUT:
 			memcpy(gTextInput, event.text.text, sizeof(gTextInput));
 			_Static_assert(sizeof(gTextInput) == sizeof(event.text.text), "size mismatch: gTextInput / event.text.text");
@@ -245,6 +259,12 @@ void UpdateInput(void)
 
 		UpdateKeyState(&gNeedStates[i], downNow);
 	}
+
+	// --------------------------------------------
+	// Sample analog sticks
+
+	gLeftStickMagnitude = ReadLeftStickMagnitude_Fix32();
+	gRightStickAim = ReadRightStick8WayAim();
 }
 
 void ClearInput(void)
@@ -322,6 +342,47 @@ bool GetNewNeedState(int needID)
 	return gNeedStates[needID] == KEYSTATE_DOWN;
 }
 
+/******************** INPUT SNAPSHOTS (FOR DEMOS) *************************/
+//
+// Everything the game reads from the input devices during one tick, as reported by
+// GetNeedState, GetNewNeedState and the analog stick functions.
+//
+
+void GetInputSnapshot(InputSnapshot* snapshot)
+{
+	_Static_assert(NUM_CONTROL_NEEDS <= 32, "need bits won't fit in InputSnapshot");
+
+	snapshot->needsActive = 0;
+	snapshot->needsChanged = 0;
+
+	for (int i = 0; i < NUM_CONTROL_NEEDS; i++)
+	{
+		if (gNeedStates[i] & KEYSTATE_ACTIVE_BIT)
+			snapshot->needsActive |= 1u << i;
+		if (gNeedStates[i] & KEYSTATE_CHANGE_BIT)
+			snapshot->needsChanged |= 1u << i;
+	}
+
+	snapshot->leftStickMagnitude = gLeftStickMagnitude;
+	snapshot->rightStickAim = gRightStickAim;
+}
+
+void ApplyInputSnapshot(const InputSnapshot* snapshot)
+{
+	for (int i = 0; i < NUM_CONTROL_NEEDS; i++)
+	{
+		Byte state = KEYSTATE_OFF;
+		if (snapshot->needsActive & (1u << i))
+			state |= KEYSTATE_ACTIVE_BIT;
+		if (snapshot->needsChanged & (1u << i))
+			state |= KEYSTATE_CHANGE_BIT;
+		gNeedStates[i] = state;
+	}
+
+	gLeftStickMagnitude = snapshot->leftStickMagnitude;
+	gRightStickAim = snapshot->rightStickAim;
+}
+
 bool IsCmdQPressed(void)
 {
 #if __APPLE__
@@ -426,6 +487,16 @@ static void OnJoystickRemoved(SDL_JoystickID which)
 }
 
 int32_t GetLeftStickMagnitude_Fix32(void)
+{
+	return gLeftStickMagnitude;
+}
+
+short GetRightStick8WayAim(void)
+{
+	return gRightStickAim;
+}
+
+static int32_t ReadLeftStickMagnitude_Fix32(void)
 {
 #if NOJOYSTICK
 	return 0;
@@ -449,7 +520,7 @@ int32_t GetLeftStickMagnitude_Fix32(void)
 #endif
 }
 
-short GetRightStick8WayAim(void)
+static short ReadRightStick8WayAim(void)
 {
 #if NOJOYSTICK
 	return -1;
@@ -20,6 +20,10 @@ extern "C"
 {
 	#include "renderdrivers.h"
 	#include "framebufferfilter.h"
+	#include "blit.h"
+	#include "profiler.h"
+	#include "io.h"
+	#include "mappedfile.h"
 	#include "externs.h"
 	#include "version.h"
 
@@ -32,6 +36,41 @@ extern "C"
 	void GameMain(void);
 
 	int gNumThreads = 0;
+
+	// Run without a window, through the null render driver (--headless)
+	Boolean gHeadless = false;
+}
+
+// Convert frames to RGBA in headless mode, to include that in CPU measurements (--headless-convert)
+static bool gHeadlessConvert = false;
+
+// Record per-stage frame timings, dumped with F11 and on exit (--profile)
+static bool gProfile = false;
+
+static void ParseCommandLine(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "--headless")
+		{
+			gHeadless = true;
+		}
+		else if (argument == "--headless-convert")
+		{
+			gHeadless = true;
+			gHeadlessConvert = true;
+		}
+		else if (argument == "--profile")
+		{
+			gProfile = true;
+		}
+		else if ((argument == "--demo" || argument == "--demo-benchmark") && i + 1 < argc)
+		{
+			QueueDemoPlayback(argv[++i], argument == "--demo-benchmark");
+		}
+	}
 }
 
 static fs::path FindGameData(const char* executablePath)
@@ -109,44 +148,67 @@ static void Boot(const char* executablePath)
 		gNumThreads = 1;
 #endif
 #endif
+	if (gHeadless)
+	{
+		// The dummy drivers still pump events and keyboard state, without needing a display server or sound card
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+	}
+
 	// Start our "machine"
 	Pomme::Init();
 
+	// Pick sprite blitters for this CPU
+	InitBlitters();
+
+	if (gProfile)
+		InitProfiler();
+
 	// Initialize SDL video subsystem
 	if (0 != SDL_Init(SDL_INIT_VIDEO))
 		throw std::runtime_error("Couldn't initialize SDL video subsystem.");
 
+	if (gHeadless)
+	{
+		NullRender_Init(gHeadlessConvert);
+	}
+	else
+	{
 #if GLRENDER
 #if !(OSXPPC)
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
 #endif // OSXPPC
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
 #endif // GLRENDER
 
-	// Create window
-	int windowFlags = SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI;
+		// Create window
+		int windowFlags = SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI;
 #if GLRENDER
-	windowFlags |= SDL_WINDOW_OPENGL;
+		windowFlags |= SDL_WINDOW_OPENGL;
 #endif
-	gSDLWindow = SDL_CreateWindow(
-			"Mighty Mike " PROJECT_VERSION,
-			SDL_WINDOWPOS_UNDEFINED,
-			SDL_WINDOWPOS_UNDEFINED,
-			VISIBLE_WIDTH,
-			VISIBLE_HEIGHT,
-			windowFlags);
-	if (!gSDLWindow)
-		throw std::runtime_error("Couldn't create SDL window.");
+		gSDLWindow = SDL_CreateWindow(
+				"Mighty Mike " PROJECT_VERSION,
+				SDL_WINDOWPOS_UNDEFINED,
+				SDL_WINDOWPOS_UNDEFINED,
+				VISIBLE_WIDTH,
+				VISIBLE_HEIGHT,
+				windowFlags);
+		if (!gSDLWindow)
+			throw std::runtime_error("Couldn't create SDL window.");
 
 #if GLRENDER
-	GLRender_Init();
+		GLRender_Init();
 #else
-	if (!SDLRender_Init())
-		throw std::runtime_error("Couldn't create SDL renderer.");
+		if (!SDLRender_Init())
+			throw std::runtime_error("Couldn't create SDL renderer.");
 #endif // GLRENDER
+	}
 
 	fs::path dataPath = FindGameData(executablePath);
+
+	// Let MapMikeFile find the asset files on the host
+	InitMappedFiles((const char*) dataPath.u8string().c_str());
 #if !(__APPLE__)
 //	Pomme::Graphics::SetWindowIconFromIcl8Resource(gSDLWindow, 400);
 #endif
@@ -167,6 +229,8 @@ static void Boot(const char* executablePath)
 
 static void Shutdown()
 {
+	DumpProfile();				// no-op unless --profile
+
 	Pomme::Shutdown();
 
 	if (gSDLWindow)
@@ -203,6 +267,8 @@ int main(int argc, char** argv)
 
 	const char* executablePath = argc > 0 ? argv[0] : NULL;
 
+	ParseCommandLine(argc, argv);
+
 	// Start the game
 	try
 	{
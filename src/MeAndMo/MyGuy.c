@@ -211,7 +211,7 @@ void InitMe(void)
 	if (gMyNodePtr == nil)
 		DoFatalAlert("Couldnt init Me!");
 
-	gMyNodePtr->CType = CTYPE_MYGUY;
+	SetObjectCType(gMyNodePtr, CTYPE_MYGUY);
 	gMyNodePtr->CBits = CBITS_TOUCHABLE;
 
 	gMyNodePtr->TopOff = -17;					// set box
@@ -1313,7 +1313,7 @@ Boolean	delFlag;
 					if (targetNode->Type == ObjType_FairyHealth)	// don't delete poison apples
 					{
 						targetNode->ItemIndex = nil;				// make sure it won't come back
-						targetNode->CType = 0;
+						SetObjectCType(targetNode, 0);
 						SwitchAnim(targetNode,2);					// make poison apple vaporize
 						delFlag = false;
 					}
@@ -1456,29 +1456,32 @@ void StartMyThrow(void)
 void CheckIfMeOnMPlatform(void)
 {
 register	ObjNode		*thisNodePtr;
+ObjNode		*platformNode = nil;
 
 	gMyNodePtr->MPlatform = nil;						// assume not on mplatform
 
 					/* SCAN FOR MPLATFORMS */
 
-	thisNodePtr = FirstNodePtr;
-	do
+	UpdateObjectListRanks();							// if on several, use the 1st one in the linked list
+
+	for (thisNodePtr = GetFirstObjectOfCType(CTYPE_MPLATFORM);
+		thisNodePtr != nil;
+		thisNodePtr = GetNextObjectOfCType(thisNodePtr, CTYPE_MPLATFORM))
 	{
-		if (thisNodePtr->CType & CTYPE_MPLATFORM)
+		if ((gX.Int > thisNodePtr->LeftSide) && (gX.Int < thisNodePtr->RightSide) &&		// see if im on it
+			(gY.Int > thisNodePtr->TopSide) && (gY.Int < thisNodePtr->BottomSide))
 		{
-			if ((gX.Int > thisNodePtr->LeftSide) && (gX.Int < thisNodePtr->RightSide) &&		// see if im on it
-				(gY.Int > thisNodePtr->TopSide) && (gY.Int < thisNodePtr->BottomSide))
-			{
-				gSumDX += thisNodePtr->DX;
-				gSumDY += thisNodePtr->DY;
-				gMyNodePtr->MPlatform = thisNodePtr;
-				break;
-			}
+			if (platformNode == nil || thisNodePtr->ListRank < platformNode->ListRank)
+				platformNode = thisNodePtr;
 		}
+	}
 
-		thisNodePtr = (ObjNode *)thisNodePtr->NextNode;		// next node
+	if (platformNode != nil)
+	{
+		gSumDX += platformNode->DX;
+		gSumDY += platformNode->DY;
+		gMyNodePtr->MPlatform = platformNode;
 	}
-	while (thisNodePtr != nil);
 }
 
 
@@ -1559,7 +1562,7 @@ void MoveMyFlame(void)
 {
 	gThisNodePtr->X = gMyNodePtr->X;
 	gThisNodePtr->Y = gMyNodePtr->Y;
-	gThisNodePtr->Z = gMyNodePtr->Z-1;
+	SetObjectZ(gThisNodePtr, gMyNodePtr->Z-1);
 	gThisNodePtr->YOffset = gMyNodePtr->YOffset;
 }
 
@@ -237,7 +237,7 @@ void TurnMeIntoShip(ObjNode	*shipNode)
 {
 	shipNode->ItemIndex = nil;						// its no longer a map item - not coming back
 	shipNode->MoveCall = MoveMeSpaceShip;			// change move routine
-	shipNode->CType = CTYPE_HURTENEMY;				// make hurt enemy
+	SetObjectCType(shipNode, CTYPE_HURTENEMY);		// make hurt enemy
 
 
 				/* HIDE REAL ME */
@@ -162,7 +162,7 @@ ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_BONUS|CTYPE_WEAPONPOW;
+	SetObjectCType(newObj, CTYPE_BONUS|CTYPE_WEAPONPOW);
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -30;							// set box
@@ -639,7 +639,7 @@ short		z,y,x;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -20;										// set collision box
@@ -768,7 +768,7 @@ void MoveCake(void)
 	{
 		gNumBullets--;										// dec count (auto deletes itself later)
 		SwitchAnim(gThisNodePtr,1);								// BLOW IT UP!
-		gThisNodePtr->CType = CTYPE_MYBULLET;					// activate collision
+		SetObjectCType(gThisNodePtr, CTYPE_MYBULLET);			// activate collision
 		StopObjectMovement(gThisNodePtr);						// prevent movement extrapolation
 	}
 
@@ -825,7 +825,7 @@ short		z,y,x;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -16;										// set collision box
@@ -894,7 +894,7 @@ short		z,y,x;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -16;					// set collision box
@@ -977,7 +977,7 @@ Byte	animNum;
 
 	InitYOffset(newNode, -39);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -16;					// set collision box
@@ -1012,7 +1012,7 @@ void MoveToothpaste(void)
 		gNumBullets--;
 		SwitchAnim(gThisNodePtr,3);					// splat anim
 		gThisNodePtr->MoveCall = nil;
-		gThisNodePtr->CType = 0;
+		SetObjectCType(gThisNodePtr, 0);
 		gThisNodePtr->AnimSpeed = (MyRandomLong()&0b1111111111)+0x80;
 		StopObjectMovement(gThisNodePtr);			// prevent movement extrapolation
 		return;
@@ -172,7 +172,7 @@ void MoveRock(void)
 	{
 		gNumBullets--;										// dec count (auto deletes itself later)
 		SwitchAnim(gThisNodePtr,1);								// BLOW IT UP!
-		gThisNodePtr->CType = CTYPE_MYBULLET;					// activate collision
+		SetObjectCType(gThisNodePtr, CTYPE_MYBULLET);			// activate collision
 	}
 
 	CalcObjectBox();
@@ -223,7 +223,7 @@ short		z,y,x;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -30;						// set collision box
@@ -296,7 +296,7 @@ short		z,y,x;
 
 	InitYOffset(newNode, -32);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -16;					// set collision box
@@ -412,7 +412,7 @@ short		z,y,x;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -16;										// set collision box
@@ -480,7 +480,7 @@ short		z,y,x;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;		// activate collision
+	SetObjectCType(newNode, CTYPE_MYBULLET);	// activate collision
 	newNode->CBits = CBITS_TOUCHABLE;
 	newNode->TopOff = -20;					// set collision box (not activated yet)
 	newNode->BottomOff = 0;
@@ -544,7 +544,7 @@ void ExplodePie(ObjNode *theNode)
 	gNumBullets--;										// dec count (auto deletes itself later)
 	SwitchAnim(theNode,8);								// BLOW IT UP!
 	theNode->MoveCall = nil;							// stop from moving
-	theNode->CType = 0;									// no longer harmful
+	SetObjectCType(theNode, 0);							// no longer harmful
 	StopObjectMovement(theNode);						// prevent movement extrapolation
 
 	PlaySound(SOUND_PIESQUISH);
@@ -619,7 +619,7 @@ Byte 	sub;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -20;										// set collision box
@@ -716,7 +716,7 @@ static	unsigned long lastShotFrame = 0;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -32;										// set collision box
@@ -789,7 +789,7 @@ short		z,y,x;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -16;										// set collision box
@@ -902,7 +902,7 @@ short		z,y,x;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -16;										// set collision box
@@ -941,23 +941,21 @@ short		x,y;
 						/* SCAN FOR CLOSEST ENEMY */
 
 	bestDist = 0x7fff;
-	thisNodePtr = FirstNodePtr;
-	do
+	UpdateObjectListRanks();						// ties go to the enemy that's 1st in the linked list
+
+	for (thisNodePtr = GetFirstObjectOfCType(CTYPE_ENEMYA);
+		thisNodePtr != nil;
+		thisNodePtr = GetNextObjectOfCType(thisNodePtr, CTYPE_ENEMYA))
 	{
-		if (thisNodePtr->CType & CTYPE_ENEMYA)
-		{
-			dist = (Absolute(thisNodePtr->X.Int - x) + Absolute(thisNodePtr->Y.Int - y))/2;
+		dist = (Absolute(thisNodePtr->X.Int - x) + Absolute(thisNodePtr->Y.Int - y))/2;
 
-			if (dist < bestDist)
-			{
-				bestDist = dist;
-				targetNode = thisNodePtr;
-			}
+		if ((dist < bestDist) ||
+			(dist == bestDist && targetNode != nil && thisNodePtr->ListRank < targetNode->ListRank))
+		{
+			bestDist = dist;
+			targetNode = thisNodePtr;
 		}
-
-		thisNodePtr = thisNodePtr->NextNode;		// next node
 	}
-	while (thisNodePtr != nil);
 
 					/* REMEMBER WHERE TO GO */
 
@@ -1086,7 +1084,7 @@ short		z,y,x;
 	if (newNode == nil)
 		return(false);
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -32;										// set collision box
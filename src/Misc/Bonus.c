@@ -57,6 +57,14 @@ short		gNumBunnies;
 
 short	gShieldTimer;
 
+static short	*gBunnyItems = nil;						// indices into gMasterItemList of the bunnies still on the map
+static short	gNumBunnyItems = 0;
+static short	gBunnyItemsCapacity = 0;
+
+static Handle	gRadarImageHandle = nil;				// radar background, loaded once per session
+static int		gRadarImageWidth;
+static int		gRadarImageHeight;
+
 #define	NukeTimer		Special1
 #define	NukeDoneFlag	Flag0
 
@@ -80,7 +88,7 @@ short		i;
 		if (newObj == nil)
 			return;
 
-		newObj->CType = CTYPE_BONUS;
+		SetObjectCType(newObj, CTYPE_BONUS);
 		newObj->CBits = CBITS_TOUCHABLE;
 		newObj->CoinTimer = COIN_TIME+(MyRandomLong()&0b11111);		// set life of coin
 
@@ -164,7 +172,7 @@ ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_BONUS;
+	SetObjectCType(newObj, CTYPE_BONUS);
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -30;							// set box
@@ -241,6 +249,17 @@ register ObjNode	*theNode;
 
 void DeleteBunny(ObjNode *theNode)
 {
+short	itemNum = theNode->ItemIndex - gMasterItemList;
+
+	for (short i = 0; i < gNumBunnyItems; i++)		// take it off the radar
+	{
+		if (gBunnyItems[i] == itemNum)
+		{
+			gBunnyItems[i] = gBunnyItems[--gNumBunnyItems];
+			break;
+		}
+	}
+
 	theNode->ItemIndex->type |= ITEM_MEMORY;		// set memory bits to indicate it is really gone
 	theNode->ItemIndex = nil;						// wont be comin back
 	DeleteObject(theNode);
@@ -248,6 +267,9 @@ void DeleteBunny(ObjNode *theNode)
 
 
 /***************** COUNT BUNNIES ******************/
+//
+// Also builds the list of bunny items that DisplayBunnyRadar draws from.
+//
 
 void CountBunnies(void)
 {
@@ -261,6 +283,24 @@ short		i;
 	}
 
 	gBunnyCounts[gSceneNum][gAreaNum] = gNumBunnies;	// remember count for each level
+
+				/* BUILD RADAR LIST */
+
+	if (gNumBunnies > gBunnyItemsCapacity)			// grow list (kept for the whole session)
+	{
+		if (gBunnyItems)
+			DisposePtr((Ptr) gBunnyItems);
+		gBunnyItems = (short *) NewPtr(gNumBunnies * (long) sizeof(short));
+		GAME_ASSERT(gBunnyItems);
+		gBunnyItemsCapacity = gNumBunnies;
+	}
+
+	gNumBunnyItems = 0;
+	for (i=0; i < gNumItems; i++)
+	{
+		if (gMasterItemList[i].type == BUNNY_MAP_ID)
+			gBunnyItems[gNumBunnyItems++] = i;
+	}
 }
 
 
@@ -283,6 +323,11 @@ void DecBunnyCount(void)
 }
 
 /********************** DISPLAY BUNNY RADAR *****************************/
+//
+// Source port note: the radar image stays loaded after the first time,
+// the blips come from the bunny list built by CountBunnies,
+// and the screen only gets presented again if something invalidated it.
+//
 
 void DisplayBunnyRadar(void)
 {
@@ -294,13 +339,20 @@ const int	radarCenterY = gGamePrefs.pfSize == PFSIZE_SMALL ? RADAR_CENTER_Y : ((
 
 						/* DRAW RADAR BACKGROUND */
 
-	Handle imageHandle = LoadTGA(":images:radarmap.tga", false, &width, &height);
-	GAME_ASSERT(imageHandle);
+	if (!gRadarImageHandle)
+	{
+		gRadarImageHandle = LoadTGA(":images:radarmap.tga", false, &gRadarImageWidth, &gRadarImageHeight);
+		GAME_ASSERT(gRadarImageHandle);
+	}
+
+	width = gRadarImageWidth;
+	height = gRadarImageHeight;
 
 	PlaySound(SOUND_RADAR);
 
 	Ptr destPtr = (Ptr) gScreenLookUpTable[radarCenterY - height/2] + (radarCenterX - width/2);
-	Ptr srcPtr = *imageHandle;
+	MarkDirtyFramebufferRows(radarCenterY - height/2, height);
+	Ptr srcPtr = *gRadarImageHandle;
 
 	for (int i = 0; i < height; i++)
 	{
@@ -309,16 +361,16 @@ const int	radarCenterY = gGamePrefs.pfSize == PFSIZE_SMALL ? RADAR_CENTER_Y : ((
 		srcPtr += width;
 	}
 
-	DisposeHandle(imageHandle);
-
 						/* DRAW BLIPS */
 
-	for (int i=0; i < gNumItems; i++)
+	for (int i=0; i < gNumBunnyItems; i++)
 	{
-		if ((gMasterItemList[i].type & (ITEM_MEMORY|ITEM_NUM)) == BUNNY_MAP_ID)		// if memory bits set, then was deleted
+		const ObjectEntryType* itemPtr = &gMasterItemList[gBunnyItems[i]];
+
+		if (!(itemPtr->type & ITEM_MEMORY))								// if memory bits set, then was deleted (2P save may have restored them)
 		{
-			xDist = (gMasterItemList[i].x - gMyX)/RADAR_RANGE;
-			yDist = (gMasterItemList[i].y - gMyY)/RADAR_RANGE;
+			xDist = (itemPtr->x - gMyX)/RADAR_RANGE;
+			yDist = (itemPtr->y - gMyY)/RADAR_RANGE;
 
 			if ((Absolute(xDist) < 180) && (Absolute(yDist) < 172))				// draw if on radar screen
 			{
@@ -329,11 +381,14 @@ const int	radarCenterY = gGamePrefs.pfSize == PFSIZE_SMALL ? RADAR_CENTER_Y : ((
 	}
 
 
+	PresentIndexedFramebuffer();
+
 	UpdateInput();														// eat keypress
 	
 	while (!UserWantsOut() && !GetNewNeedState(kNeed_Radar))			// wait for spacebar
 	{
-		PresentIndexedFramebuffer();
+		if (gNumDirtyFramebufferRows > 0)								// only present again if screen was invalidated (palette, window, device reset)
+			PresentIndexedFramebuffer();
 		SDL_Delay(33);													// don't cook CPU too much
 		UpdateInput();
 	}
@@ -394,7 +449,7 @@ Byte	group,type;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_BONUS|CTYPE_HEALTH;
+	SetObjectCType(newObj, CTYPE_BONUS|CTYPE_HEALTH);
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -30;							// set box
@@ -459,7 +514,7 @@ short	group,type;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_BONUS|CTYPE_KEY;
+	SetObjectCType(newObj, CTYPE_BONUS|CTYPE_KEY);
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -20;							// set box
@@ -545,7 +600,7 @@ ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_BONUS|CTYPE_MISCPOW;
+	SetObjectCType(newObj, CTYPE_BONUS|CTYPE_MISCPOW);
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -20;							// set box
@@ -689,7 +744,7 @@ static	float	cosTbl[16] =	{-1,-0.92387,-0.7071,-0.38268,
 		if (newNode == nil)
 			return;
 
-		newNode->CType = CTYPE_MYBULLET;
+		SetObjectCType(newNode, CTYPE_MYBULLET);
 		newNode->CBits = CBITS_TOUCHABLE;
 
 		newNode->TopOff = -10;						// set collision box
@@ -781,7 +836,7 @@ ObjNode	*newNode;
 	if (newNode == nil)
 		goto update;
 
-	newNode->CType = CTYPE_MYBULLET;
+	SetObjectCType(newNode, CTYPE_MYBULLET);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -40;						// set collision box
@@ -830,7 +885,7 @@ ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_BONUS;
+	SetObjectCType(newObj, CTYPE_BONUS);
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -40;							// set box
@@ -137,7 +137,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_MISC;						// set collision info
+	SetObjectCType(newObj, CTYPE_MISC);				// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TopOff = PLANT_TOP;							// set box
@@ -178,7 +178,7 @@ ObjNode	*newObj;
 		{
 			gThisNodePtr->Flag0 = false;
 			SwitchAnim(gThisNodePtr,1);					// make spike
-			gThisNodePtr->CType = CTYPE_ENEMYC;			// make harmful
+			SetObjectCType(gThisNodePtr, CTYPE_ENEMYC);	// make harmful
 		}
 	}
 	else												// else SPIKING
@@ -194,7 +194,7 @@ ObjNode	*newObj;
 		{
 			gThisNodePtr->Flag0 = false;
 			SwitchAnim(gThisNodePtr,0);					// make bloom
-			gThisNodePtr->CType = CTYPE_MISC;
+			SetObjectCType(gThisNodePtr, CTYPE_MISC);
 		}
 	}
 
@@ -209,7 +209,7 @@ ObjNode	*newObj;
 							MovePlantPod,PLAYFIELD_RELATIVE);
 		if (newObj != nil)
 		{
-			newObj->CType = CTYPE_ENEMYB;				// set collision info
+			SetObjectCType(newObj, CTYPE_ENEMYB);		// set collision info
 			newObj->CBits = CBITS_TOUCHABLE;
 			newObj->TopOff = -8;						// set box
 			newObj->BottomOff = 0;
@@ -278,7 +278,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = 0;								// set collision info
+	SetObjectCType(newObj, 0);						// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -16;							// set box
@@ -315,7 +315,7 @@ void MoveJackInTheBox(void)
 		if (gThisNodePtr->SproingFinishedFlag)
 		{
 			SwitchAnim(gThisNodePtr,1);					// all done, go back to normal
-			gThisNodePtr->CType = 0;
+			SetObjectCType(gThisNodePtr, 0);
 			gThisNodePtr->DrawFlag = false;
 			gThisNodePtr->SproingFinishedFlag = false;
 		}
@@ -324,7 +324,7 @@ void MoveJackInTheBox(void)
 	{
 		if (!(MyRandomLong()&0b111111))
 		{
-			gThisNodePtr->CType = CTYPE_ENEMYC;			// make harmful
+			SetObjectCType(gThisNodePtr, CTYPE_ENEMYC);	// make harmful
 			gThisNodePtr->DrawFlag = true;
 			SwitchAnim(gThisNodePtr,0);
 			PlaySound(gSoundNum_JackInTheBox);
@@ -349,7 +349,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_MPLATFORM;				// set collision info
+	SetObjectCType(newObj, CTYPE_MPLATFORM);		// set collision info
 	newObj->CBits = 0;
 
 	newObj->TopOff = -40;							// set box
@@ -399,7 +399,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_ENEMYB;					// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYB);			// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TopOff = -10;							// set box
@@ -427,7 +427,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_ENEMYC;					// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYC);			// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -40;							// set box
@@ -478,7 +478,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_MISC;						// set collision info
+	SetObjectCType(newObj, CTYPE_MISC);				// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TopOff = -25;							// set box
@@ -552,7 +552,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;					// remember where this came from
 
-	newObj->CType = CTYPE_ENEMYB;					// set collision info
+	SetObjectCType(newObj, CTYPE_ENEMYB);			// set collision info
 	newObj->CBits = CBITS_TOUCHABLE;
 
 	newObj->TopOff = -20;							// set box
@@ -618,7 +618,7 @@ static	long hydrantDX[2] = {-0x90000L,0x90000L};
 
 	InitYOffset(newNode, -39);
 
-	newNode->CType = CTYPE_ENEMYC;
+	SetObjectCType(newNode, CTYPE_ENEMYC);
 	newNode->CBits = CBITS_TOUCHABLE;
 
 	newNode->TopOff = -16;					// set collision box
@@ -139,7 +139,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;							// remember where this came from
 
-	newObj->CType = CTYPE_TRIGGER;							// set collision info
+	SetObjectCType(newObj, CTYPE_TRIGGER);					// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TriggerSides = ALL_SOLID_SIDES;					// set trigger info
@@ -231,7 +231,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;							// remember where this came from
 
-	newObj->CType = CTYPE_TRIGGER|CTYPE_MISC;				// set collision info
+	SetObjectCType(newObj, CTYPE_TRIGGER|CTYPE_MISC);		// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TriggerSides = SIDE_BITS_BOTTOM|SIDE_BITS_TOP;	// set trigger info
@@ -271,7 +271,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;							// remember where this came from
 
-	newObj->CType = CTYPE_TRIGGER|CTYPE_MISC;			// set collision info
+	SetObjectCType(newObj, CTYPE_TRIGGER|CTYPE_MISC);	// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TriggerSides = SIDE_BITS_BOTTOM|SIDE_BITS_TOP;	// set trigger info
@@ -311,7 +311,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;							// remember where this came from
 
-	newObj->CType = CTYPE_TRIGGER|CTYPE_MISC;				// set collision info
+	SetObjectCType(newObj, CTYPE_TRIGGER|CTYPE_MISC);		// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TriggerSides = SIDE_BITS_BOTTOM|SIDE_BITS_TOP;	// set trigger info
@@ -350,7 +350,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;							// remember where this came from
 
-	newObj->CType = CTYPE_TRIGGER|CTYPE_MISC;				// set collision info
+	SetObjectCType(newObj, CTYPE_TRIGGER|CTYPE_MISC);		// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 
 	newObj->TriggerSides = SIDE_BITS_BOTTOM|SIDE_BITS_TOP;	// set trigger info
@@ -381,7 +381,7 @@ void MoveBargainDoor(void)
 	if (gThisNodePtr->SubType)						// see if truck is moving
 	{
 		GetObjectInfo();
-		gThisNodePtr->CType = 0;					// not solid when opening
+		SetObjectCType(gThisNodePtr, 0);			// not solid when opening
 
 					/* MOVE X */
 
@@ -428,7 +428,7 @@ register	ObjNode		*newObj;
 
 	newObj->ItemIndex = itemPtr;							// remember where this came from
 
-	newObj->CType = CTYPE_TRIGGER|CTYPE_MISC;			// set collision info
+	SetObjectCType(newObj, CTYPE_TRIGGER|CTYPE_MISC);	// set collision info
 	newObj->CBits = CBITS_ALLSOLID;
 	newObj->FairyDoorBoomFlag = false;					// hasnt exploded yet
 
@@ -453,7 +453,7 @@ void MoveFairyDoor(void)
 	if (gThisNodePtr->FairyDoorBoomFlag)					// see if door has exploded
 	{
 		gThisNodePtr->FairyDoorBoomFlag = false;
-		gThisNodePtr->CType = 0;
+		SetObjectCType(gThisNodePtr, 0);
 		PlaySound(gSoundNum_DoorOpen);
 	}
 
@@ -499,7 +499,7 @@ Boolean DoTrig_Door(void)
 	if (gMyKeys[gTriggerNode->KeyNeeded])					// see if I've got the key
 	{
 		SwitchAnim(gTriggerNode,1);							// open the door
-		gTriggerNode->CType = 0;
+		SetObjectCType(gTriggerNode, 0);
 		gTriggerNode->ItemIndex->type |= ITEM_MEMORY;		// set memory bits to remember that door is open
 		gMyKeys[gTriggerNode->KeyNeeded] = false;			// lose key
 		ShowKeys();											// update keys on screen
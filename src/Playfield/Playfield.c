@@ -26,6 +26,8 @@
 #include "enemy4.h"
 #include "enemy5.h"
 #include "racecar.h"
+#include "framebufferfilter.h"
+#include "assetcache.h"
 #include "externs.h"
 #include <string.h>
 
@@ -57,11 +59,25 @@ long	PF_WINDOW_LEFT	=	24;				// left MUST be on 4 pixel boundary!!!!!
 
 #define	VIEW_FACTOR		100				// amount to shift view for look-space
 
-#define	MAX_PLAYFIELD_WIDTH	1000L		// max tiles wide the PF will ever be
+#define	ITEM_CHUNK_SH		3			// items are indexed in chunks of 8x8 tiles
 
 #define	MAX_TILE_ANIMS	50						// max # of tile anims
 
 
+/****************************/
+/*    PROTOTYPES            */
+/****************************/
+
+static void ForgetPlayfieldTileCells(void);
+static void SetPlayfieldTileCell(long row, long col, int xlate);
+static void SnapshotDisplayedTileCells(long left, long top);
+static void SetUpPlayfieldCopy(void);
+static void CopyPlayfieldRows(int firstRow, int numRows);
+static void IndexTileAnimBaseTiles(void);
+static void DisposeItemIndex(void);
+static void BuildItemChunkIndex(void);
+static void SetTileAnimCell(long mapRow, long mapCol);
+static void RebuildTileAnimCells(void);
 
 
 /**********************/
@@ -71,6 +87,32 @@ long	PF_WINDOW_LEFT	=	24;				// left MUST be on 4 pixel boundary!!!!!
 static	Handle			gTileSetHandle = nil;
 static	Ptr				gTilesPtr;
 static	short			*gTileXlatePtr;
+static	int				gNumTileDefinitions = 0;
+static	TileDitherRow	*gTileDitherRows = nil;				// [gNumTileDefinitions*TILE_SIZE] precomputed smear flags for dithering filter
+
+static	int16_t			*gDisplayedTileCells = nil;			// gPFTileCells as of last DisplayPlayfield, -1 where sprites were
+static	long			gNumDisplayedTileCells = 0;
+static	long			gDisplayedLeft, gDisplayedTop;		// PF buffer coords shown at top-left of window in last DisplayPlayfield
+
+static	Boolean			gLatchedDitherCacheValid = false;	// the above, as of the frame being converted (see LatchPlayfieldDitherCache)
+static	int16_t			*gLatchedTileCells = nil;
+static	long			gNumLatchedTileCells = 0;
+static	long			gLatchedLeft, gLatchedTop;
+static	uint8_t			*gLatchedPlayfieldRows = nil;		// gPlayfieldFramebufferRows as of the frame being converted
+static	long			gNumLatchedPlayfieldRows = 0;
+
+typedef struct
+{
+	const uint8_t*		src;								// top-left of the segment in the PF buffer
+	uint8_t*			dest;								// top-left of the segment in the framebuffer
+	int					destRow;
+	int					width;
+	int					height;
+} PlayfieldCopySegment;
+
+static	PlayfieldCopySegment	gPlayfieldCopySegments[4];	// wrapped pieces of the PF buffer shown in the window (see SetUpPlayfieldCopy)
+static	int						gNumPlayfieldCopySegments = 0;
+static	Boolean					gPlayfieldCopyPending = false;	// DisplayPlayfieldFused left the copy to the color converter
 
 Handle			gPlayfieldHandle = nil;
 uint16_t		**gPlayfield = nil;
@@ -85,7 +127,12 @@ long			gTweenedScrollX,gTweenedScrollY;
 long			gScrollRow,gScrollCol,gOldScrollRow,gOldScrollCol;
 
 short			gNumItems = -1;
-static	ObjectEntryType	**gItemLookupTableX = nil;
+static	ObjectEntryType	**gItemLookupTableX = nil;					// [gPlayfieldTileWidth] 1st item at or after each column
+static	Boolean			gItemListSortedByX = false;
+static	long			gItemChunksWide = 0, gItemChunksHigh = 0;
+static	int32_t			*gItemChunkStart = nil;						// [chunks+1] index into gItemChunkItems of each chunk's items
+static	int16_t			*gItemChunkItems = nil;						// [gNumItems] item #'s, chunk by chunk, ascending within a chunk
+static	int16_t			*gItemScanList = nil;						// [gNumItems] scratch for ScanForPlayfieldItems
 ObjectEntryType *gMasterItemList = nil;
 
 TileAttribType	*gTileAttributes;
@@ -103,11 +150,20 @@ static	long			gShakeyScreenOffsetX = 0;
 static	long			gShakeyScreenOffsetY = 0;
 
 static	Ptr				gMaxItemAddress;								// addr of last item in current item list
+static	int32_t			gOffsetToItemList;								// OBJECT_LIST in gPlayfieldHandle (set by LoadPlayfield)
 
 // Source port note: moved from TileAnim.c
 static	short			gNumTileAnims;
 static	TileAnimEntryType	gTileAnims[MAX_TILE_ANIMS];
 
+static	int8_t			gTileAnimOfBaseTile[TILENUM_MASK+1];			// 1st tile anim using this base tile, -1 if none
+static	int16_t			gTileAnimCellHead[MAX_TILE_ANIMS];				// 1st PF buffer cell showing the anim's base tile, -1 if none
+static	int16_t			*gTileAnimCellAnim = nil;						// [PF_TILE_HEIGHT*PF_TILE_WIDTH] tile anim shown in each PF buffer cell, -1 if none
+static	int16_t			*gTileAnimCellNext = nil;						// per-anim doubly-linked lists of PF buffer cells
+static	int16_t			*gTileAnimCellPrev = nil;
+static	long			gNumTileAnimCells = 0;
+static	Boolean			gTileAnimCellsValid = false;					// lists match the map cells in the window at gScrollRow/gScrollCol
+
 
 /**********************/
 /*     TABLES         */
@@ -176,6 +232,10 @@ static	Boolean	(*gItemAddPtrs[])(ObjectEntryType *) = {
 
 void OnChangePlayfieldSize(void)
 {
+	CancelConvertFramebufferMT();						// converter threads must not see the dimensions change
+	FlushPlayfieldCopy();								// segments are only valid for the current dimensions
+	gTileAnimCellsValid = false;						// cell lists are laid out for the current dimensions
+
 	switch (gGamePrefs.pfSize)
 	{
 	case PFSIZE_SMALL:
@@ -255,16 +315,17 @@ int16_t* tileXparentList		= nil;
 	if (gTileSetHandle != nil)								// see if zap old tileset
 		DisposeHandle(gTileSetHandle);
 
-	gTileSetHandle = LoadPackedFile(fileName);				// load the file
+	Boolean isNative;
+	gTileSetHandle = LoadPackedFile(fileName, &isNative);	// load the file
 	tileSetPtr = *gTileSetHandle;							// get fixed ptr
 
 			/* GET OFFSETS */
 
-	int offsetToTileDefinitions			= UnpackI32BEInPlace(tileSetPtr+6)+2;		// base + offset + 2 (skip # tiles word)
-	int offsetToXlateTable				= UnpackI32BEInPlace(tileSetPtr+10)+2;	// base + offset + 2 (skip # entries word)
-	int offsetToTileAttributes			= UnpackI32BEInPlace(tileSetPtr+14)+2;	// base + offset + 2 (skip # entries word)
-	int offsetToTileAnimList			= UnpackI32BEInPlace(tileSetPtr+22)+2;
-	int offsetToTileXparentColorList	= UnpackI32BEInPlace(tileSetPtr+26)+2;
+	int offsetToTileDefinitions			= UnpackI32InPlaceUnlessNative(tileSetPtr+6, isNative)+2;		// base + offset + 2 (skip # tiles word)
+	int offsetToXlateTable				= UnpackI32InPlaceUnlessNative(tileSetPtr+10, isNative)+2;	// base + offset + 2 (skip # entries word)
+	int offsetToTileAttributes			= UnpackI32InPlaceUnlessNative(tileSetPtr+14, isNative)+2;	// base + offset + 2 (skip # entries word)
+	int offsetToTileAnimList			= UnpackI32InPlaceUnlessNative(tileSetPtr+22, isNative)+2;
+	int offsetToTileXparentColorList	= UnpackI32InPlaceUnlessNative(tileSetPtr+26, isNative)+2;
 
 	GAME_ASSERT(offsetToTileDefinitions	< offsetToXlateTable);
 	GAME_ASSERT(offsetToXlateTable		< offsetToTileAttributes);
@@ -273,11 +334,11 @@ int16_t* tileXparentList		= nil;
 
 			/* GET ENTRY COUNTS */
 
-	/*int numTileDefinitions		=*/   UnpackI16BEInPlace(tileSetPtr + offsetToTileDefinitions			- 2	);
-	int numXlateEntries					= UnpackI16BEInPlace(tileSetPtr + offsetToXlateTable				- 2	);
-	int numTileAttributeEntries			= UnpackI16BEInPlace(tileSetPtr + offsetToTileAttributes			- 2	);
-	gNumTileAnims						= UnpackI16BEInPlace(tileSetPtr + offsetToTileAnimList			- 2	);
-	int numTileXparentColors			= UnpackI16BEInPlace(tileSetPtr + offsetToTileXparentColorList	- 2	);
+	gNumTileDefinitions					= UnpackI16InPlaceUnlessNative(tileSetPtr + offsetToTileDefinitions			- 2, isNative);
+	int numXlateEntries					= UnpackI16InPlaceUnlessNative(tileSetPtr + offsetToXlateTable				- 2, isNative);
+	int numTileAttributeEntries			= UnpackI16InPlaceUnlessNative(tileSetPtr + offsetToTileAttributes			- 2, isNative);
+	gNumTileAnims						= UnpackI16InPlaceUnlessNative(tileSetPtr + offsetToTileAnimList				- 2, isNative);
+	int numTileXparentColors			= UnpackI16InPlaceUnlessNative(tileSetPtr + offsetToTileXparentColorList	- 2, isNative);
 
 			/* GET POINTERS TO TABLES */
 
@@ -289,14 +350,17 @@ int16_t* tileXparentList		= nil;
 
 			/* BYTESWAP STUFF */
 
-	// Byteswap gTileXlatePtr
-	UnpackIntsBE(2, numXlateEntries, gTileXlatePtr);
+	if (!isNative)
+	{
+		// Byteswap gTileXlatePtr
+		UnpackIntsBE(2, numXlateEntries, gTileXlatePtr);
 
-	// Byteswap gTileAttributes
-	UnpackStructs(">Hh4b", sizeof(TileAttribType), numTileAttributeEntries, gTileAttributes);
+		// Byteswap gTileAttributes
+		UnpackStructs(">Hh4b", sizeof(TileAttribType), numTileAttributeEntries, gTileAttributes);
 
-	// Byteswap tileXparentList
-	UnpackIntsBE(2, numTileXparentColors, tileXparentList);
+		// Byteswap tileXparentList
+		UnpackIntsBE(2, numTileXparentColors, tileXparentList);
+	}
 
 	/***************** PREPARE TILE ANIMS ***********************/
 	//
@@ -321,8 +385,11 @@ int16_t* tileXparentList		= nil;
 #endif
 
 		TileAnimDefType* tileAnimDef = (TileAnimDefType*) (currentTileAnimData + 16);
-		UnpackIntsBE(2, 3, tileAnimDef);										// byteswap speed, baseTile, numFrames
-		UnpackIntsBE(2, tileAnimDef->numFrames, tileAnimDef->tileNums);			// byteswap tileNums array
+		if (!isNative)
+		{
+			UnpackIntsBE(2, 3, tileAnimDef);									// byteswap speed, baseTile, numFrames
+			UnpackIntsBE(2, tileAnimDef->numFrames, tileAnimDef->tileNums);		// byteswap tileNums array
+		}
 
 #if _DEBUG
 //		printf("PrepareTileAnims #%d: \"%s\", %d frames\n", i, name, tileAnimDef->numFrames);
@@ -337,6 +404,11 @@ int16_t* tileXparentList		= nil;
 		currentTileAnimData += 16 + 2*3 + 2*tileAnimDef->numFrames;
 	}
 
+	if (!isNative)
+		SaveNativeAsset(fileName, gTileSetHandle);			// all byteswapped: next time, skip the byteswapping
+
+	IndexTileAnimBaseTiles();
+
 
 	/******************** SET TILE COLOR MASKS *********************/
 	//
@@ -351,6 +423,30 @@ int16_t* tileXparentList		= nil;
 
 		gColorMaskArray[tileXparentList[i]] = false;
 	}
+
+
+	/******************** PRECOMPUTE DITHER STRIDES *********************/
+	//
+	// Source port addition: lets the dithering filter skip most of the playfield.
+	//
+
+	GAME_ASSERT(gNumTileDefinitions >= 0);
+	GAME_ASSERT(gNumTileDefinitions == 0 ||
+				HandleBoundsCheck(gTileSetHandle, gTilesPtr + (gNumTileDefinitions << (TILE_SIZE_SH*2)) - 1));
+
+	CancelConvertFramebufferMT();							// converter threads may still be reading the old ones
+
+	if (gTileDitherRows != nil)
+		DisposePtr((Ptr) gTileDitherRows);
+	gTileDitherRows = (TileDitherRow*) NewPtr((gNumTileDefinitions + 1) * TILE_SIZE * sizeof(TileDitherRow));
+	GAME_ASSERT(gTileDitherRows);
+
+	for (int i = 0; i < gNumTileDefinitions; i++)
+	{
+		FindTileDitherStrides((const uint8_t*) gTilesPtr + (i << (TILE_SIZE_SH*2)), gTileDitherRows + i * TILE_SIZE);
+	}
+
+	ForgetPlayfieldTileCells();								// cells in PF buffer refer to old tileset
 }
 
 
@@ -386,6 +482,19 @@ void DisposeCurrentMapData(void)
 		gTileSetHandle = nil;
 	}
 
+	if (gTileDitherRows != nil)
+	{
+		CancelConvertFramebufferMT();
+		DisposePtr((Ptr) gTileDitherRows);
+		gTileDitherRows = nil;
+	}
+	gNumTileDefinitions = 0;
+	ForgetPlayfieldTileCells();
+	gNumTileAnims = 0;
+	gTileAnimCellsValid = false;
+
+	DisposeItemIndex();
+
 	gNumItems = -1;
 	gMasterItemList = nil;	// this is just a pointer within gPlayfieldHandle, no need to dispose of it
 
@@ -403,18 +512,21 @@ uint16_t	*tempPtr;
 long	i;
 Ptr		bytePtr,pfPtr;
 
-	gPlayfieldHandle = LoadPackedFile(fileName);					// load the file
+	Boolean isNative;
+	gPlayfieldHandle = LoadPackedFile(fileName, &isNative);		// load the file
 
 	pfPtr = *gPlayfieldHandle;										// get fixed ptr
 
 
-	int32_t offsetToMapImage		= UnpackI32BEInPlace(pfPtr + 2);
-	int32_t offsetToAltMap			= UnpackI32BEInPlace(pfPtr + 10);
+	int32_t offsetToMapImage		= UnpackI32InPlaceUnlessNative(pfPtr + 2, isNative);
+	gOffsetToItemList				= UnpackI32InPlaceUnlessNative(pfPtr + 6, isNative);
+	int32_t offsetToAltMap			= UnpackI32InPlaceUnlessNative(pfPtr + 10, isNative);
 
 				/* BUILD MAP ARRAY */
 
 	tempPtr = (uint16_t *)(pfPtr + offsetToMapImage);				// point to MAP_IMAGE
-	UnpackIntsBE(2, 2, tempPtr);									// byteswap width/height
+	if (!isNative)
+		UnpackIntsBE(2, 2, tempPtr);								// byteswap width/height
 	gPlayfieldTileWidth = *(tempPtr++);								// get dimensions
 	gPlayfieldTileHeight = *(tempPtr++);
 	gPlayfieldWidth = gPlayfieldTileWidth<<TILE_SIZE_SH;
@@ -424,7 +536,8 @@ Ptr		bytePtr,pfPtr;
 	GAME_ASSERT(gPlayfield);
 	for (i = 0; i < gPlayfieldTileHeight; i++)						// build 1st dimension of matrix
 	{
-		UnpackIntsBE(2, gPlayfieldTileWidth, tempPtr);				// byteswap row
+		if (!isNative)
+			UnpackIntsBE(2, gPlayfieldTileWidth, tempPtr);			// byteswap row
 		gPlayfield[i]= (unsigned short *)tempPtr;					// set pointer to row
 		tempPtr += gPlayfieldTileWidth;								// next row
 	}
@@ -450,6 +563,23 @@ Ptr		bytePtr,pfPtr;
 		gAltMapFlag = true;
 	}
 
+			/* BYTESWAP ALL OBJECT ENTRY STRUCTS */
+			//
+			// Source port note: moved here from BuildItemList, so the native asset cache
+			// can keep the whole map byteswapped.
+			//
+
+	// Ensure the in-memory representation of the struct is tightly-packed to match the struct's layout on disk
+	_Static_assert(sizeof(struct ObjectEntryType) == 4+4+2+4, "ObjectEntryType has incorrect size!");
+
+	if (!isNative)
+	{
+		short numItems = UnpackI16BEInPlace(pfPtr + gOffsetToItemList);		// get # items in file
+		UnpackStructs(">2ih4b", sizeof(ObjectEntryType), numItems, pfPtr + gOffsetToItemList + 2);
+
+		SaveNativeAsset(fileName, gPlayfieldHandle);				// next time, skip the byteswapping
+	}
+
 	gScrollX = 0;													// default these
 	gScrollY = 0;
 	gOldScrollX = 0;
@@ -535,6 +665,8 @@ long		right,left,top,bottom;
 			row = 0;
 	}
 
+	RebuildTileAnimCells();										// index animated tiles in the window
+
 				/* ADD ITEMS IN THIS AREA */
 
 	SetItemDeleteWindow();
@@ -568,36 +700,38 @@ long	offset;
 long	col,itemCol,itemNum,nextCol,prevCol;
 ObjectEntryType *lastPtr;
 
-	if	(gPlayfieldTileWidth > MAX_PLAYFIELD_WIDTH)				// see if bigger than max allowed
-		DoFatalAlert("gPlayfieldTileWidth is greater than MAX_PLAYFIELD_WIDTH!");
+	DisposeItemIndex();
 
 					/* GET BASIC INFO */
 
-	offset = UnpackI32BE(*gPlayfieldHandle + 6);				// get offset to OBJECT_LIST
-	gNumItems = UnpackI16BE(*gPlayfieldHandle + offset);		// get # items in file
+	offset = gOffsetToItemList;									// get offset to OBJECT_LIST (already byteswapped by LoadPlayfield)
+	memcpy(&gNumItems, *gPlayfieldHandle + offset, sizeof(gNumItems));	// get # items in file
 	if (gNumItems == 0)
 		return;
 	gMasterItemList = (ObjectEntryType *)(*gPlayfieldHandle+offset+2);	// point to items in file
 
-					/* BYTESWAP ALL OBJECT ENTRY STRUCTS */
-
-	// Ensure the in-memory representation of the struct is tightly-packed to match the struct's layout on disk
-	_Static_assert(sizeof(struct ObjectEntryType) == 4+4+2+4, "ObjectEntryType has incorrect size!");
-
-	UnpackStructs(">2ih4b", sizeof(ObjectEntryType), gNumItems, gMasterItemList);
-
 				/* BUILD HORIZ LOOKUP TABLE */
+				//
+				// Source port note: this used to be a permanent table of MAX_PLAYFIELD_WIDTH (1000) entries.
+				// It's now sized for the map. It's only used if the items aren't sorted by X (see ScanForPlayfieldItems).
+				//
+
+	gItemLookupTableX = (ObjectEntryType **) NewPtrClear(sizeof(ObjectEntryType *) * gPlayfieldTileWidth);
+	GAME_ASSERT(gItemLookupTableX);
 
 	gMaxItemAddress = (Ptr)&gMasterItemList[gNumItems-1];		// remember addr of last item
 	lastPtr = &gMasterItemList[0];
 	nextCol = 0;												// start @ col 0
 	prevCol = -1;
+	gItemListSortedByX = true;
 	for (itemNum = 0; itemNum < gNumItems; itemNum++)
 	{
 		itemCol = gMasterItemList[itemNum].x>>TILE_SIZE_SH;		// get column of item
+		if (itemCol < prevCol)
+			gItemListSortedByX = false;
 		if (itemCol != prevCol)									// see if changed
 		{
-			for (col = nextCol; col <= itemCol; col++)			// filler pointers
+			for (col = nextCol; col <= itemCol && col < gPlayfieldTileWidth; col++)	// filler pointers
 				gItemLookupTableX[col] = &gMasterItemList[itemNum];
 			prevCol = itemCol;
 			nextCol = itemCol+1;
@@ -607,6 +741,105 @@ ObjectEntryType *lastPtr;
 	for (col = nextCol; col < gPlayfieldTileWidth; col++)		// set trailing column pointers
 		gItemLookupTableX[col] = lastPtr;
 
+				/* BUILD 2D LOOKUP TABLE */
+
+	BuildItemChunkIndex();
+}
+
+
+/************************ GET ITEM CHUNK ***********************/
+
+static inline long GetItemChunk(long row, long col)
+{
+	row >>= ITEM_CHUNK_SH;
+	col >>= ITEM_CHUNK_SH;
+
+	if (row < 0) row = 0;										// items off the map go in the edge chunks
+	if (row >= gItemChunksHigh) row = gItemChunksHigh-1;
+	if (col < 0) col = 0;
+	if (col >= gItemChunksWide) col = gItemChunksWide-1;
+
+	return row * gItemChunksWide + col;
+}
+
+
+/************************ BUILD ITEM CHUNK INDEX ***********************/
+//
+// Buckets the items by 8x8-tile chunk of the map, so that ScanForPlayfieldItems
+// only looks at the items near the strip that scrolled into view.
+//
+
+static void BuildItemChunkIndex(void)
+{
+long	numChunks,chunk,itemNum;
+
+	gItemChunksWide = (gPlayfieldTileWidth + (1<<ITEM_CHUNK_SH) - 1) >> ITEM_CHUNK_SH;
+	gItemChunksHigh = (gPlayfieldTileHeight + (1<<ITEM_CHUNK_SH) - 1) >> ITEM_CHUNK_SH;
+	if (gItemChunksWide < 1) gItemChunksWide = 1;
+	if (gItemChunksHigh < 1) gItemChunksHigh = 1;
+	numChunks = gItemChunksWide * gItemChunksHigh;
+
+	gItemChunkStart = (int32_t *) NewPtrClear(sizeof(int32_t) * (numChunks + 1));
+	gItemChunkItems = (int16_t *) NewPtr(sizeof(int16_t) * gNumItems);
+	gItemScanList = (int16_t *) NewPtr(sizeof(int16_t) * gNumItems);
+	GAME_ASSERT(gItemChunkStart && gItemChunkItems && gItemScanList);
+
+				/* COUNT ITEMS PER CHUNK */
+
+	for (itemNum = 0; itemNum < gNumItems; itemNum++)
+	{
+		chunk = GetItemChunk(gMasterItemList[itemNum].y>>TILE_SIZE_SH, gMasterItemList[itemNum].x>>TILE_SIZE_SH);
+		gItemChunkStart[chunk+1]++;
+	}
+
+	for (chunk = 0; chunk < numChunks; chunk++)					// counts -> start offsets
+		gItemChunkStart[chunk+1] += gItemChunkStart[chunk];
+
+				/* FILL CHUNKS IN ITEM ORDER */
+
+	for (itemNum = 0; itemNum < gNumItems; itemNum++)
+	{
+		chunk = GetItemChunk(gMasterItemList[itemNum].y>>TILE_SIZE_SH, gMasterItemList[itemNum].x>>TILE_SIZE_SH);
+		gItemChunkItems[gItemChunkStart[chunk]++] = (int16_t) itemNum;	// (temporarily advances start to end)
+	}
+
+	for (chunk = numChunks; chunk > 0; chunk--)					// shift back: start[c] = old end[c-1]
+		gItemChunkStart[chunk] = gItemChunkStart[chunk-1];
+	gItemChunkStart[0] = 0;
+}
+
+
+/************************ DISPOSE ITEM INDEX ***********************/
+
+static void DisposeItemIndex(void)
+{
+	if (gItemLookupTableX)
+	{
+		DisposePtr((Ptr) gItemLookupTableX);
+		gItemLookupTableX = nil;
+	}
+
+	if (gItemChunkStart)
+	{
+		DisposePtr((Ptr) gItemChunkStart);
+		gItemChunkStart = nil;
+	}
+
+	if (gItemChunkItems)
+	{
+		DisposePtr((Ptr) gItemChunkItems);
+		gItemChunkItems = nil;
+	}
+
+	if (gItemScanList)
+	{
+		DisposePtr((Ptr) gItemScanList);
+		gItemScanList = nil;
+	}
+
+	gItemChunksWide = 0;
+	gItemChunksHigh = 0;
+	gItemListSortedByX = false;
 }
 
 
@@ -644,6 +877,12 @@ void ScrollPlayfield(void)
 	gScrollCol = gTweenedScrollX / TILE_SIZE;			// get new row/col
 	gScrollRow = gTweenedScrollY / TILE_SIZE;
 
+	if (gScrollRow > gOldScrollRow+1 || gScrollRow < gOldScrollRow-1	// the scroll functions below only bring in 1 row/col,
+		|| gScrollCol > gOldScrollCol+1 || gScrollCol < gOldScrollCol-1)	// so reindex the whole window for tile anims
+	{
+		gTileAnimCellsValid = false;
+	}
+
 
 			/* SEE IF SCROLLED A TILE VERTICALLY */
 
@@ -711,6 +950,7 @@ long	row,col,x,mapRow,right;
 	for (x = 0; x < PF_TILE_WIDTH; x++)
 	{
 		DrawATile(gPlayfield[mapRow][gScrollCol+x],row,col,true);
+		SetTileAnimCell(mapRow, gScrollCol+x);
 
 		if (++col >= PF_TILE_WIDTH)
 			col = 0;
@@ -746,6 +986,7 @@ long	row,col,x,right;
 	for (x = 0; x < PF_TILE_WIDTH; x++)
 	{
 		DrawATile(gPlayfield[gScrollRow][gScrollCol+x],row,col,true);
+		SetTileAnimCell(gScrollRow, gScrollCol+x);
 		if (++col >= PF_TILE_WIDTH)
 			col = 0;
 	}
@@ -786,6 +1027,7 @@ long	row,col,y,mapCol,mapRowTop,mapRowBot;
 	for (y = 0; y < PF_TILE_HEIGHT; y++)
 	{
 		DrawATile(gPlayfield[gScrollRow+y][mapCol],row,col,true);
+		SetTileAnimCell(gScrollRow+y, mapCol);
 		if (++row >= PF_TILE_HEIGHT)
 			row = 0;
 	}
@@ -821,6 +1063,7 @@ long	row,col,y,mapRowTop,mapRowBot,mapCol;
 	for (y = 0; y < PF_TILE_HEIGHT; y++)
 	{
 		DrawATile(gPlayfield[gScrollRow+y][gScrollCol],row,col,true);
+		SetTileAnimCell(gScrollRow+y, gScrollCol);
 		if (++row >= PF_TILE_HEIGHT)
 			row = 0;
 	}
@@ -848,41 +1091,91 @@ long	row,col,y,mapRowTop,mapRowBot,mapCol;
 // Given this range, scan for items.  Coords are in row/col values.
 //
 
+static void AddPlayfieldItem(ObjectEntryType *itemPtr)
+{
+long	type;
+Boolean	flag;
+
+	if (!(itemPtr->type&ITEM_IN_USE))							// see if item available
+	{
+		type = itemPtr->type&ITEM_NUM;							// mask out status bits 15..12
+		if (type > MAX_ITEM_NUM)								// error check!
+			DoFatalAlert("Illegal Map Item Type!");
+		else
+		{
+			flag = gItemAddPtrs[type](itemPtr);					// call item's ADD routine
+			if (flag)
+				itemPtr->type |= ITEM_IN_USE;					// set in-use flag
+		}
+	}
+}
+
 void ScanForPlayfieldItems(long top, long bottom, long left, long right)
 {
 ObjectEntryType *itemPtr;
-long	row,type;
-Boolean		flag;
+long	row,col,chunkRow,chunkCol,chunk,i,j,numFound;
+int16_t	itemNum;
 
-	if (gNumItems == 0)
+	if (gNumItems <= 0)
 		return;
 
-	itemPtr = gItemLookupTableX[left];								// get pointer to 1st item at this X
+				/* NO 2D INDEX: SCAN ALL ITEMS IN THIS COLUMN RANGE */
 
-	while (((itemPtr->x>>TILE_SIZE_SH) >= left) && ((itemPtr->x>>TILE_SIZE_SH) <= right))	// check all items in this column range
+	if (!gItemListSortedByX)
 	{
-		row = itemPtr->y>>TILE_SIZE_SH;
-		if ((row >= top) && (row <= bottom))						// & this row range
+		itemPtr = gItemLookupTableX[left];								// get pointer to 1st item at this X
+
+		while (((itemPtr->x>>TILE_SIZE_SH) >= left) && ((itemPtr->x>>TILE_SIZE_SH) <= right))	// check all items in this column range
 		{
-					/* ADD AN ITEM */
+			row = itemPtr->y>>TILE_SIZE_SH;
+			if ((row >= top) && (row <= bottom))						// & this row range
+				AddPlayfieldItem(itemPtr);
+
+			itemPtr++;													// point to next item
+			if ((Ptr) itemPtr > gMaxItemAddress)						// see if its past the last address
+				break;
+		}
+		return;
+	}
+
+				/* GATHER ITEMS IN THIS AREA FROM THE CHUNKS IT OVERLAPS */
+
+	numFound = 0;
+
+	for (chunkRow = top >> ITEM_CHUNK_SH; chunkRow <= (bottom >> ITEM_CHUNK_SH) && chunkRow < gItemChunksHigh; chunkRow++)
+	{
+		if (chunkRow < 0)
+			continue;
 
-			if (!(itemPtr->type&ITEM_IN_USE))						// see if item available
+		for (chunkCol = left >> ITEM_CHUNK_SH; chunkCol <= (right >> ITEM_CHUNK_SH) && chunkCol < gItemChunksWide; chunkCol++)
+		{
+			if (chunkCol < 0)
+				continue;
+
+			chunk = chunkRow * gItemChunksWide + chunkCol;
+
+			for (i = gItemChunkStart[chunk]; i < gItemChunkStart[chunk+1]; i++)
 			{
-				type = itemPtr->type&ITEM_NUM;						// mask out status bits 15..12
-				if (type > MAX_ITEM_NUM)							// error check!
-					DoFatalAlert("Illegal Map Item Type!");
-				else
+				itemNum = gItemChunkItems[i];
+				itemPtr = &gMasterItemList[itemNum];
+				row = itemPtr->y>>TILE_SIZE_SH;
+				col = itemPtr->x>>TILE_SIZE_SH;
+
+				if ((row >= top) && (row <= bottom) && (col >= left) && (col <= right))
 				{
-					flag = gItemAddPtrs[type](itemPtr);				// call item's ADD routine
-					if (flag)
-						itemPtr->type |= ITEM_IN_USE;				// set in-use flag
+					for (j = numFound; j > 0 && gItemScanList[j-1] > itemNum; j--)	// keep in item order, like the old scan
+						gItemScanList[j] = gItemScanList[j-1];
+					gItemScanList[j] = itemNum;
+					numFound++;
 				}
 			}
 		}
-		itemPtr++;													// point to next item
-		if ((Ptr) itemPtr > gMaxItemAddress)						// see if its past the last address
-			break;
 	}
+
+				/* ADD THEM */
+
+	for (i = 0; i < numFound; i++)
+		AddPlayfieldItem(&gMasterItemList[gItemScanList[i]]);
 }
 
 
@@ -1246,23 +1539,6 @@ Boolean NilAdd(ObjectEntryType *itemPtr)
 }
 
 
-/******************* CREATE PLAYFIELD PERMANENT MEMORY ***********************/
-//
-// Create playfield memory items that ARE NEVER PURGED.. EVER!
-//
-
-void CreatePlayfieldPermanentMemory(void)
-{
-Handle		tempHand;
-
-				/* ALLOC MEMORY FOR ITEM LOOKUP TABLE */
-
-	tempHand = NewHandleClear(sizeof(ObjectEntryType *)*MAX_PLAYFIELD_WIDTH);
-	GAME_ASSERT(tempHand);
-	gItemLookupTableX = (ObjectEntryType **)*tempHand;
-}
-
-
 /************************ DRAW A TILE ***********************/
 
 void DrawATile(unsigned short tileNum, short row, short col, Boolean maskFlag)
@@ -1286,6 +1562,8 @@ Ptr			destPtrB,srcPtrB;
 
 	int xlate = gTileXlatePtr[tileNum&TILENUM_MASK];
 
+	SetPlayfieldTileCell(row, col, xlate);
+
 	copyOfSrc = srcPtr = (unsigned char *)(gTilesPtr + (xlate<<(TILE_SIZE_SH*2)));
 	destPtr = (unsigned char *)destStartPtr;
 	destCopyPtr = (unsigned char *)destCopyStartPtr;
@@ -1392,6 +1670,8 @@ unsigned long	rowS,colS;								// shifted version of row & col
 
 	GAME_ASSERT(HandleBoundsCheck(gTileSetHandle, (Ptr) srcPtr));
 
+	SetPlayfieldTileCell(row, col, gTileXlatePtr[tileNum]);
+
 						/* DRAW THE TILE */
 
 	for (int y = 0; y < TILE_SIZE; y++)
@@ -1406,23 +1686,20 @@ unsigned long	rowS,colS;								// shifted version of row & col
 
 
 
-/********************* DISPLAY PLAYFIELD ***************/
+/****************** SET UP PLAYFIELD COPY ********************/
 //
-// Dump Current playfield area to the screen
+// Works out which wrapped pieces of the PF buffer make up the playfield window
+// (up to four, depending on where the scroll position falls in the ring buffer).
 //
 
-void DisplayPlayfield(void)
+static void SetUpPlayfieldCopy(void)
 {
-Ptr			destPtr,srcPtr;
-long		top,left,width;
-unsigned long	height;
+long		top,left;
 long		numSegments,seg;
 Ptr			destPtrs[4];
 Ptr			srcPtrs[4];
 unsigned long	heights[4];
 long		widths[4];
-long		srcAdd,destAdd;
-long		method;
 
 	left	= PositiveModulo(gTweenedScrollX + gShakeyScreenOffsetX, PF_BUFFER_WIDTH);		// get PF buffer pixel coords to start @
 	top		= PositiveModulo(gTweenedScrollY + gShakeyScreenOffsetY, PF_BUFFER_HEIGHT);
@@ -1434,7 +1711,6 @@ long		method;
 
 		if ((top+(PF_WINDOW_HEIGHT-1)) > PF_BUFFER_HEIGHT)	// see if 2 vertical segments
 		{
-			method = 0;
 			numSegments = 4;
 			widths[0] = widths[2] = (PF_BUFFER_WIDTH-left);
 			heights[0] = heights[1] = PF_BUFFER_HEIGHT-top;
@@ -1452,7 +1728,6 @@ long		method;
 		}
 		else														// 1 vertical segment
 		{
-			method = 1;
 			numSegments = 2;
 			srcPtrs[0] = (Ptr)((srcPtrs[1] = (Ptr)(gPFLookUpTable[top]))+left);
 			widths[0] = PF_BUFFER_WIDTH-left;
@@ -1468,7 +1743,6 @@ long		method;
 	{
 		if ((top+(PF_WINDOW_HEIGHT-1)) > PF_BUFFER_HEIGHT)			// see if 2 vertical segments
 		{
-			method = 2;
 			numSegments = 2;
 			destPtrs[0] = (Ptr)(gScreenLookUpTable[PF_WINDOW_TOP]+
 								PF_WINDOW_LEFT);
@@ -1482,7 +1756,6 @@ long		method;
 		}
 		else														// 1 vertical segment
 		{
-			method = 3;
 			numSegments = 1;
 			destPtrs[0] = (Ptr)(gScreenLookUpTable[PF_WINDOW_TOP]+
 								PF_WINDOW_LEFT);
@@ -1492,105 +1765,243 @@ long		method;
 		}
 	}
 
-					/**********************************/
-					/* SPECIAL CASE METHOD 0 / 4 SEGS */
-					/**********************************/
+	MarkDirtyFramebufferRows(PF_WINDOW_TOP, PF_WINDOW_HEIGHT);
+	SnapshotDisplayedTileCells(left, top);
 
-	if (method == 0)
+	for (seg = 0; seg < numSegments; seg++)
 	{
-		Ptr		destPtr2,srcPtr2;
-		long	width2,srcAdd2,destAdd2;
+		PlayfieldCopySegment* copySeg = &gPlayfieldCopySegments[seg];
+		copySeg->src		= (const uint8_t*) srcPtrs[seg];
+		copySeg->dest		= (uint8_t*) destPtrs[seg];
+		copySeg->destRow	= (int) ((copySeg->dest - gScreenLookUpTable[0]) / VISIBLE_WIDTH);
+		copySeg->width		= (int) widths[seg];
+		copySeg->height		= (int) heights[seg];
+	}
+	gNumPlayfieldCopySegments = (int) numSegments;
+}
+
+
+/****************** COPY PLAYFIELD ROWS ********************/
+//
+// Copies the given framebuffer rows of the playfield window from the PF buffer,
+// as set up by SetUpPlayfieldCopy. Rows outside the window are left alone.
+//
+
+static void CopyPlayfieldRows(int firstRow, int numRows)
+{
+	int endRow = firstRow + numRows;
+
+	for (int seg = 0; seg < gNumPlayfieldCopySegments; seg++)
+	{
+		const PlayfieldCopySegment* copySeg = &gPlayfieldCopySegments[seg];
+
+		int from	= firstRow > copySeg->destRow ? firstRow : copySeg->destRow;
+		int to		= endRow < copySeg->destRow + copySeg->height ? endRow : copySeg->destRow + copySeg->height;
 
-		for (seg = 0; seg < 4; seg+=2)
+		for (int row = from; row < to; row++)
 		{
-			destPtr = destPtrs[0+seg];
-			srcPtr	= srcPtrs[0+seg];
-			destPtr2 = destPtrs[1+seg];
-			srcPtr2	= srcPtrs[1+seg];
+			int y = row - copySeg->destRow;
+			memcpy(copySeg->dest + y * VISIBLE_WIDTH, copySeg->src + y * PF_BUFFER_WIDTH, copySeg->width);
+		}
+	}
+}
 
-			height = heights[0+seg];					// set height
-			width = widths[0+seg];						// set width
-			width2 = widths[1+seg];						// set width
 
-			srcAdd = (PF_BUFFER_WIDTH)-width;			// calc line add (for normal display)
-			destAdd = (VISIBLE_WIDTH)-width;
-			srcAdd2 = (PF_BUFFER_WIDTH)-width2;			// calc line add (for normal display)
-			destAdd2 = (VISIBLE_WIDTH)-width2;
+/********************* DISPLAY PLAYFIELD ***************/
+//
+// Dump Current playfield area to the screen
+//
 
-						/* DO 1ST SEG */
-			do
-			{
-				memcpy(destPtr, srcPtr, width);
-				destPtr += width;
-				srcPtr += width;
+void DisplayPlayfield(void)
+{
+	SetUpPlayfieldCopy();
+	CopyPlayfieldRows(PF_WINDOW_TOP, PF_WINDOW_HEIGHT);
+	gPlayfieldCopyPending = false;
+}
 
 
-						/* DO 2ND SEG */
+/****************** DISPLAY PLAYFIELD: FUSED ********************/
+//
+// Same as DisplayPlayfield, but lets the color converter copy each row right before
+// converting it, on the next present. This saves a full pass over the playfield.
+//
+// Until that present, the PF buffer and the playfield window in the framebuffer
+// must not change (EraseObjects goes after the present).
+//
 
-				memcpy(destPtr2, srcPtr2, width2);
-				destPtr2 += width2;
-				srcPtr2 += width2;
+void DisplayPlayfieldFused(void)
+{
+	if (!gGamePrefs.fusedPlayfieldCopy)
+	{
+		DisplayPlayfield();
+		return;
+	}
 
-				srcPtr += srcAdd;							// next line
-				destPtr += destAdd;
-				srcPtr2 += srcAdd2;
-				destPtr2 += destAdd2;
-			} while (--height);
-		}
+	SetUpPlayfieldCopy();
+	gPlayfieldCopyPending = true;
+}
+
+
+/****************** PENDING PLAYFIELD COPY ********************/
+
+Boolean IsPlayfieldCopyPending(void)
+{
+	return gPlayfieldCopyPending;
+}
+
+// Called from the converter threads, each on its own rows
+void CopyPendingPlayfieldRows(int firstRow, int numRows)
+{
+	CopyPlayfieldRows(firstRow, numRows);
+}
+
+// The converter threads have copied every row of the window
+void MarkPlayfieldCopyDone(void)
+{
+	gPlayfieldCopyPending = false;
+}
+
+// Does the copy now if nobody has done it yet. Call before touching the PF buffer,
+// or before reading the playfield window in the framebuffer.
+void FlushPlayfieldCopy(void)
+{
+	if (!gPlayfieldCopyPending)
+		return;
+
+	CopyPlayfieldRows(PF_WINDOW_TOP, PF_WINDOW_HEIGHT);
+	gPlayfieldCopyPending = false;
+}
+
+
+
+
+#pragma mark - Tile animation
+
+/**************** INDEX TILE ANIM BASE TILES **********************/
+//
+// Builds the base tile -> tile anim lookup for the current tileset.
+// If several anims share a base tile, they all use the cell list of the first one.
+//
+
+static void IndexTileAnimBaseTiles(void)
+{
+	memset(gTileAnimOfBaseTile, 0xFF, sizeof(gTileAnimOfBaseTile));
+
+	for (int animNum = gNumTileAnims-1; animNum >= 0; animNum--)		// backwards so the 1st anim wins
+	{
+		int baseTile = gTileAnims[animNum].defPtr->baseTile;
+		if (baseTile <= TILENUM_MASK)									// other values never match a masked map tile
+			gTileAnimOfBaseTile[baseTile] = animNum;
 	}
-	else
+
+	gTileAnimCellsValid = false;
+}
+
+/**************** SET TILE ANIM CELL **********************/
+//
+// Files the PF buffer cell showing this map cell under the tile anim for its tile, if any.
+// Called as the scroll functions bring new rows and columns into the window.
+//
+
+static void SetTileAnimCell(long mapRow, long mapCol)
+{
+int		cell,animNum,oldAnim,next,prev;
+
+	if (!gTileAnimCellsValid)											// whole window gets reindexed on the next update anyway
+		return;
+
+	cell = (mapRow % PF_TILE_HEIGHT) * PF_TILE_WIDTH + (mapCol % PF_TILE_WIDTH);
+	animNum = gTileAnimOfBaseTile[gPlayfield[mapRow][mapCol] & TILENUM_MASK];
+	oldAnim = gTileAnimCellAnim[cell];
+
+	if (oldAnim == animNum)
+		return;
+
+				/* UNLINK FROM OLD ANIM'S LIST */
+
+	if (oldAnim >= 0)
 	{
-					/**********************************/
-					/* NORMAL CASE METHOD 1..3        */
-					/**********************************/
+		next = gTileAnimCellNext[cell];
+		prev = gTileAnimCellPrev[cell];
 
-						/* COPY THE SEGMENTS */
+		if (prev >= 0)
+			gTileAnimCellNext[prev] = next;
+		else
+			gTileAnimCellHead[oldAnim] = next;
 
-		for (seg=0; seg < numSegments; seg++)
-		{
-			Ptr		destStartPtr,srcStartPtr;
+		if (next >= 0)
+			gTileAnimCellPrev[next] = prev;
+	}
 
-			destStartPtr = destPtrs[seg];
-			srcStartPtr	= srcPtrs[seg];
+				/* LINK INTO NEW ANIM'S LIST */
 
-			height = heights[seg];						// set height
-			width = widths[seg];						// set width
+	gTileAnimCellAnim[cell] = animNum;
 
-			srcAdd = PF_BUFFER_WIDTH;					// line bytes
-			destAdd = VISIBLE_WIDTH;
+	if (animNum >= 0)
+	{
+		next = gTileAnimCellHead[animNum];
+		gTileAnimCellNext[cell] = next;
+		gTileAnimCellPrev[cell] = -1;
+		if (next >= 0)
+			gTileAnimCellPrev[next] = cell;
+		gTileAnimCellHead[animNum] = cell;
+	}
+}
 
-			do
-			{
-				destPtr = destStartPtr;
-				srcPtr = srcStartPtr;
+/**************** REBUILD TILE ANIM CELLS **********************/
+//
+// Reindexes every map cell in the window.
+//
 
-				memcpy(destPtr, srcPtr, width);
+static void RebuildTileAnimCells(void)
+{
+long	numCells,x,y;
 
-				srcStartPtr += srcAdd;									// next line
-				destStartPtr += destAdd;
+	numCells = PF_TILE_HEIGHT * PF_TILE_WIDTH;
 
-			} while (--height);
+	if (numCells != gNumTileAnimCells)									// (re)allocate if playfield size changed
+	{
+		if (gTileAnimCellAnim)
+		{
+			DisposePtr((Ptr) gTileAnimCellAnim);
+			DisposePtr((Ptr) gTileAnimCellNext);
+			DisposePtr((Ptr) gTileAnimCellPrev);
 		}
+
+		gTileAnimCellAnim = (int16_t*) NewPtr(numCells * sizeof(int16_t));
+		gTileAnimCellNext = (int16_t*) NewPtr(numCells * sizeof(int16_t));
+		gTileAnimCellPrev = (int16_t*) NewPtr(numCells * sizeof(int16_t));
+		GAME_ASSERT(gTileAnimCellAnim && gTileAnimCellNext && gTileAnimCellPrev);
+		gNumTileAnimCells = numCells;
 	}
-}
 
+	memset(gTileAnimCellAnim, 0xFF, numCells * sizeof(int16_t));
+	memset(gTileAnimCellHead, 0xFF, sizeof(gTileAnimCellHead));
+	gTileAnimCellsValid = true;
 
+	if (gPlayfield == nil)
+		return;
 
+	for (y = 0; y < PF_TILE_HEIGHT; y++)
+		for (x = 0; x < PF_TILE_WIDTH; x++)
+			SetTileAnimCell(gScrollRow+y, gScrollCol+x);
+}
 
 /**************** UPDATE TILE ANIMATION **********************/
 // Source port note: moved from TileAnim.c
+//
+// Source port note: the original scanned the whole window for each anim's base tile
+// whenever the anim ticked. Now each anim walks the list of cells where its base tile
+// is visible (see SetTileAnimCell).
+//
 
 void UpdateTileAnimation(void)
 {
-unsigned long	row;
 unsigned short	newTile;
-uint16_t	targetTile,*intPtr,*basePtr;
-register long	col;
-register long	x,y,animNum;
-unsigned long 	origRow,origCol;
+long	animNum,listAnim,cell,y;
 
-	origRow = gScrollRow % PF_TILE_HEIGHT;									// calc row in buffer
-	origCol = gScrollCol % PF_TILE_WIDTH;									// calc col in buffer
+	if (!gTileAnimCellsValid)
+		RebuildTileAnimCells();
 
 	for (animNum = 0; animNum < gNumTileAnims; animNum++)
 	{
@@ -1600,42 +2011,232 @@ unsigned long 	origRow,origCol;
 		{
 			gTileAnims[animNum].count = 0x100;								// reset counter
 
-						/* SCAN VISIBLE AREA FOR TARGET TILE */
+						/* REDRAW CELLS SHOWING THE TARGET TILE */
 
-			targetTile = gTileAnims[animNum].defPtr->baseTile;				// get target basetile
 			newTile = gTileAnims[animNum].defPtr->tileNums[gTileAnims[animNum].index];	// get tile to draw
 
-			basePtr = (unsigned short *)&gPlayfield[gScrollRow][gScrollCol]; // get ptr to start of scan
+			listAnim = gTileAnimOfBaseTile[gTileAnims[animNum].defPtr->baseTile & TILENUM_MASK];
+			if (listAnim >= 0
+				&& gTileAnims[listAnim].defPtr->baseTile == gTileAnims[animNum].defPtr->baseTile)
+			{
+				for (cell = gTileAnimCellHead[listAnim]; cell >= 0; cell = gTileAnimCellNext[cell])
+					DrawATile_Simple(newTile, cell / PF_TILE_WIDTH, cell % PF_TILE_WIDTH);
+			}
 
-			row = origRow;													// get modable row
+			y = ++gTileAnims[animNum].index;								// increment index
+			if (y  >= gTileAnims[animNum].defPtr->numFrames)				// see if at end of sequence
+				gTileAnims[animNum].index = 0;
+		}
+	}
+}
 
-			y = 0;
-			do
-			{
-				intPtr = basePtr;											// get ptr to start of horiz scan
-				col = origCol;
-				x = PF_TILE_WIDTH;
 
-				do
-				{
-					if ((*intPtr++ & TILENUM_MASK) == targetTile)
-						DrawATile_Simple(newTile,row,col);
+#pragma mark - Dithering filter cache
 
-					if (++col >= PF_TILE_WIDTH)								// see if column wrap
-						col = 0;
-				} while (--x);
+/****************** FORGET PLAYFIELD TILE CELLS *******************/
+//
+// Call when the tiles that were drawn into the PF buffer can't be identified anymore.
+//
 
-				if (++row >= (unsigned long) PF_TILE_HEIGHT)				// see if row wrap
-					row = 0;
+static void ForgetPlayfieldTileCells(void)
+{
+	if (gPFTileCells)
+		memset(gPFTileCells, 0xFF, PF_TILE_HEIGHT * PF_TILE_WIDTH * sizeof(int16_t));
 
-				basePtr += gPlayfieldTileWidth;								// next row in map
-			} while (++y < PF_TILE_HEIGHT);
+	if (gPlayfieldFramebufferRows)
+		memset(gPlayfieldFramebufferRows, 0, VISIBLE_HEIGHT);
+}
 
+/****************** SET PLAYFIELD TILE CELL *******************/
 
-			y = ++gTileAnims[animNum].index;								// increment index
-			if (y  >= gTileAnims[animNum].defPtr->numFrames)				// see if at end of sequence
-				gTileAnims[animNum].index = 0;
+static void SetPlayfieldTileCell(long row, long col, int xlate)
+{
+	if (!gPFTileCells)
+		return;
+
+	GAME_ASSERT(row >= 0 && row < PF_TILE_HEIGHT);
+	GAME_ASSERT(col >= 0 && col < PF_TILE_WIDTH);
+
+	if (xlate < 0 || xlate >= gNumTileDefinitions)
+		xlate = -1;
+
+	gPFTileCells[row * PF_TILE_WIDTH + col] = xlate;
+}
+
+/****************** MARK PLAYFIELD SPRITE CELLS *******************/
+//
+// Remembers which cells of the PF buffer a sprite was drawn over.
+// x,y are PF buffer coords; the area may wrap around the edges of the buffer.
+//
+
+void MarkPlayfieldSpriteCells(long x, long y, long width, long height)
+{
+	if (!gPFSpriteCells || width <= 0 || height <= 0)
+		return;
+
+	long numCols = ((x & (TILE_SIZE-1)) + width + TILE_SIZE - 1) >> TILE_SIZE_SH;
+	long numRows = ((y & (TILE_SIZE-1)) + height + TILE_SIZE - 1) >> TILE_SIZE_SH;
+
+	if (numCols > PF_TILE_WIDTH)
+		numCols = PF_TILE_WIDTH;
+	if (numRows > PF_TILE_HEIGHT)
+		numRows = PF_TILE_HEIGHT;
+
+	long row = (y >> TILE_SIZE_SH) % PF_TILE_HEIGHT;
+
+	for (long i = 0; i < numRows; i++)
+	{
+		long col = (x >> TILE_SIZE_SH) % PF_TILE_WIDTH;
+
+		for (long j = 0; j < numCols; j++)
+		{
+			gPFSpriteCells[row * PF_TILE_WIDTH + col] = 1;
+
+			if (++col >= PF_TILE_WIDTH)
+				col = 0;
 		}
+
+		if (++row >= PF_TILE_HEIGHT)
+			row = 0;
 	}
 }
 
+/****************** CLEAR PLAYFIELD SPRITE CELLS *******************/
+
+void ClearPlayfieldSpriteCells(void)
+{
+	if (gPFSpriteCells)
+		memset(gPFSpriteCells, 0, PF_TILE_HEIGHT * PF_TILE_WIDTH);
+}
+
+/****************** SNAPSHOT DISPLAYED TILE CELLS *******************/
+//
+// Called by DisplayPlayfield: remembers which tile each part of the window shows,
+// so that the dithering filter can reuse the tiles' precomputed smear flags
+// (the PF buffer may have changed by the time the framebuffer gets converted).
+//
+
+static void SnapshotDisplayedTileCells(long left, long top)
+{
+	if (!gPFTileCells || !gPlayfieldFramebufferRows)
+		return;
+
+	long numCells = PF_TILE_HEIGHT * PF_TILE_WIDTH;
+
+	if (gNumDisplayedTileCells != numCells)
+	{
+		if (gDisplayedTileCells != nil)
+			DisposePtr((Ptr) gDisplayedTileCells);
+		gDisplayedTileCells = (int16_t*) NewPtr(numCells * sizeof(int16_t));
+		GAME_ASSERT(gDisplayedTileCells);
+		gNumDisplayedTileCells = numCells;
+	}
+
+	for (long i = 0; i < numCells; i++)
+	{
+		gDisplayedTileCells[i] = gPFSpriteCells[i] ? -1 : gPFTileCells[i];
+	}
+
+	gDisplayedLeft = left;
+	gDisplayedTop = top;
+
+	long endRow = PF_WINDOW_TOP + PF_WINDOW_HEIGHT;
+	if (endRow > VISIBLE_HEIGHT)
+		endRow = VISIBLE_HEIGHT;
+
+	for (long y = PF_WINDOW_TOP; y < endRow; y++)
+	{
+		gPlayfieldFramebufferRows[y] = 1;
+	}
+}
+
+/****************** LATCH PLAYFIELD DITHER CACHE *******************/
+//
+// Called on the main thread when a frame is handed to the converter threads.
+// The converter threads may still be working on that frame while the next DisplayPlayfield runs,
+// so GetPlayfieldRowDitherCache reads this copy instead of the live tile cells.
+//
+
+void LatchPlayfieldDitherCache(void)
+{
+	gLatchedDitherCacheValid = false;
+
+	if (!gTileDitherRows || !gDisplayedTileCells || !gPlayfieldFramebufferRows)
+		return;
+
+	if (gNumLatchedTileCells != gNumDisplayedTileCells)
+	{
+		if (gLatchedTileCells != nil)
+			DisposePtr((Ptr) gLatchedTileCells);
+		gLatchedTileCells = (int16_t*) NewPtr(gNumDisplayedTileCells * sizeof(int16_t));
+		GAME_ASSERT(gLatchedTileCells);
+		gNumLatchedTileCells = gNumDisplayedTileCells;
+	}
+
+	if (gNumLatchedPlayfieldRows != VISIBLE_HEIGHT)
+	{
+		if (gLatchedPlayfieldRows != nil)
+			DisposePtr((Ptr) gLatchedPlayfieldRows);
+		gLatchedPlayfieldRows = (uint8_t*) NewPtr(VISIBLE_HEIGHT);
+		GAME_ASSERT(gLatchedPlayfieldRows);
+		gNumLatchedPlayfieldRows = VISIBLE_HEIGHT;
+	}
+
+	memcpy(gLatchedTileCells, gDisplayedTileCells, gNumDisplayedTileCells * sizeof(int16_t));
+	memcpy(gLatchedPlayfieldRows, gPlayfieldFramebufferRows, VISIBLE_HEIGHT);
+	gLatchedLeft = gDisplayedLeft;
+	gLatchedTop = gDisplayedTop;
+	gLatchedDitherCacheValid = true;
+}
+
+/****************** GET PLAYFIELD ROW DITHER CACHE *******************/
+//
+// For a framebuffer row that DisplayPlayfield drew, fills in bitmasks of the pixels
+// whose dither smear flags are known in advance (interior pixels of whole tiles that
+// no sprite was drawn over), and of the pixels among those that get smeared.
+// Returns false if nothing is known about the row.
+//
+// Called from the converter threads. Reads the state saved by LatchPlayfieldDitherCache.
+//
+
+static inline void OrBits32(uint64_t* words, int x, uint32_t bits)
+{
+	int shift = x & 63;
+
+	words[x >> 6] |= (uint64_t) bits << shift;
+
+	if (shift > 32)
+		words[(x >> 6) + 1] |= (uint64_t) bits >> (64 - shift);
+}
+
+Boolean GetPlayfieldRowDitherCache(int y, uint64_t* knownBits, uint64_t* knownSmearBits)
+{
+	if (!gLatchedDitherCacheValid || !gLatchedPlayfieldRows[y])
+		return false;
+
+	int numWords = (VISIBLE_WIDTH + 63) >> 6;
+	memset(knownBits, 0, numWords * sizeof(uint64_t));
+	memset(knownSmearBits, 0, numWords * sizeof(uint64_t));
+
+	int pfY = PositiveModulo(gLatchedTop + y - PF_WINDOW_TOP, PF_BUFFER_HEIGHT);
+	const int16_t* cells = gLatchedTileCells + (pfY >> TILE_SIZE_SH) * PF_TILE_WIDTH;
+	int tileRow = pfY & (TILE_SIZE-1);
+
+	// Only whole tiles: a tile cut off by the window edge may be missing the pixels that its flags depend on
+	int firstWholeTile = (TILE_SIZE - (gLatchedLeft & (TILE_SIZE-1))) & (TILE_SIZE-1);
+
+	for (int x = firstWholeTile; x + TILE_SIZE <= PF_WINDOW_WIDTH; x += TILE_SIZE)
+	{
+		int pfX = (gLatchedLeft + x) % PF_BUFFER_WIDTH;
+		int tile = cells[pfX >> TILE_SIZE_SH];
+
+		if (tile < 0)											// unknown tile or sprite over it
+			continue;
+
+		const TileDitherRow* tileDither = &gTileDitherRows[tile * TILE_SIZE + tileRow];
+		OrBits32(knownBits,			PF_WINDOW_LEFT + x,	tileDither->known);
+		OrBits32(knownSmearBits,	PF_WINDOW_LEFT + x,	tileDither->smear);
+	}
+
+	return true;
+}